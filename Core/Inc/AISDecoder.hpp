@@ -0,0 +1,330 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file AISDecoder.hpp
+ * @brief Decoders for all 27 message types of Rec. ITU-R M.1371.
+ * @details Every field is read straight out of the RXPacket through a MessageLayout into a plain struct,
+ *          with no allocation and no floating point. Values keep their on-air units (e.g. 1/10000 minute
+ *          for coordinates, 1/10 knot for speed), including the "not available" codes.
+ *
+ *          Variable length parts (binary data, safety text) are not copied. Their bit position and length
+ *          are recorded instead, so they can be read from the packet later if they are needed at all.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef AISDECODER_HPP_
+#define AISDECODER_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "RXPacket.hpp"
+
+// Binary data or text that is left in the packet
+typedef struct {
+  uint16_t pos;                 // First bit
+  uint16_t bits;                // Length in bits (6 per character for text)
+} AISPayloadRef;
+
+typedef struct {
+  uint16_t a;                   // Dimension to bow (m)
+  uint16_t b;                   // Dimension to stern (m)
+  uint8_t  c;                   // Dimension to port (m)
+  uint8_t  d;                   // Dimension to starboard (m)
+} AISDimensions;
+
+// Messages 1, 2 and 3
+typedef struct {
+  uint8_t  navStatus;
+  int8_t   rot;                 // Raw ROT indicator, -128 is not available
+  uint16_t sog;                 // 1/10 knot, 1023 is not available
+  uint8_t  accuracy;
+  int32_t  lon;                 // 1/10000 minute, 181 degrees is not available
+  int32_t  lat;                 // 1/10000 minute, 91 degrees is not available
+  uint16_t cog;                 // 1/10 degree, 3600 is not available
+  uint16_t heading;             // Degrees, 511 is not available
+  uint8_t  second;
+  uint8_t  maneuver;
+  uint8_t  raim;
+  uint32_t radio;
+} AISPositionReportA;
+
+// Messages 4 and 11
+typedef struct {
+  uint16_t year;
+  uint8_t  month;
+  uint8_t  day;
+  uint8_t  hour;
+  uint8_t  minute;
+  uint8_t  second;
+  uint8_t  accuracy;
+  int32_t  lon;
+  int32_t  lat;
+  uint8_t  epfd;
+  uint8_t  raim;
+  uint32_t radio;
+} AISBaseStationReport;
+
+// Message 5
+typedef struct {
+  uint8_t  aisVersion;
+  uint32_t imo;
+  char     callsign[8];
+  char     name[21];
+  uint8_t  shipType;
+  AISDimensions dimensions;
+  uint8_t  epfd;
+  uint8_t  month;               // ETA
+  uint8_t  day;
+  uint8_t  hour;
+  uint8_t  minute;
+  uint8_t  draught;             // 1/10 m
+  char     destination[21];
+  uint8_t  dte;
+} AISStaticVoyageData;
+
+// Messages 6, 8, 25 and 26. Unaddressed messages have a destination of 0.
+typedef struct {
+  uint8_t  sequence;
+  uint32_t destination;
+  uint8_t  retransmit;
+  uint8_t  structured;          // Whether dac and fid are present
+  uint16_t dac;
+  uint8_t  fid;
+  uint32_t radio;               // Message 26 only
+  AISPayloadRef data;
+} AISBinaryMessage;
+
+// Messages 7 and 13
+typedef struct {
+  uint8_t  count;
+  uint32_t mmsi[4];
+  uint8_t  sequence[4];
+} AISAcknowledgement;
+
+// Message 9
+typedef struct {
+  uint16_t altitude;            // m, 4095 is not available
+  uint16_t sog;                 // Knots, 1023 is not available
+  uint8_t  accuracy;
+  int32_t  lon;
+  int32_t  lat;
+  uint16_t cog;
+  uint8_t  second;
+  uint8_t  dte;
+  uint8_t  assigned;
+  uint8_t  raim;
+  uint32_t radio;
+} AISSARAircraftReport;
+
+// Messages 10, 12 and 14. Broadcasts have a destination of 0.
+typedef struct {
+  uint8_t  sequence;
+  uint32_t destination;
+  uint8_t  retransmit;
+  AISPayloadRef text;
+} AISSafetyMessage;
+
+// Message 15
+typedef struct {
+  uint8_t  count;
+  uint32_t mmsi[3];
+  uint8_t  messageType[3];
+  uint16_t slotOffset[3];
+} AISInterrogation;
+
+// Message 16
+typedef struct {
+  uint8_t  count;
+  uint32_t mmsi[2];
+  uint16_t offset[2];
+  uint16_t increment[2];
+} AISAssignmentCommand;
+
+// Message 17
+typedef struct {
+  int32_t  lon;                 // 1/10 minute
+  int32_t  lat;
+  AISPayloadRef data;
+} AISDGNSSBroadcast;
+
+// Messages 18 and 19
+typedef struct {
+  uint16_t sog;
+  uint8_t  accuracy;
+  int32_t  lon;
+  int32_t  lat;
+  uint16_t cog;
+  uint16_t heading;
+  uint8_t  second;
+  uint8_t  cs;                  // Message 18 only
+  uint8_t  display;
+  uint8_t  dsc;
+  uint8_t  band;
+  uint8_t  msg22;
+  uint8_t  assigned;
+  uint8_t  raim;
+  uint32_t radio;               // Message 18 only
+  char     name[21];            // Message 19 only
+  uint8_t  shipType;
+  AISDimensions dimensions;
+  uint8_t  epfd;
+  uint8_t  dte;
+} AISPositionReportB;
+
+// Message 20
+typedef struct {
+  uint8_t  count;
+  uint16_t offset[4];
+  uint8_t  number[4];
+  uint8_t  timeout[4];
+  uint16_t increment[4];
+} AISDataLinkManagement;
+
+// Message 21
+typedef struct {
+  uint8_t  aidType;
+  char     name[35];            // Name and name extension
+  uint8_t  accuracy;
+  int32_t  lon;
+  int32_t  lat;
+  AISDimensions dimensions;
+  uint8_t  epfd;
+  uint8_t  second;
+  uint8_t  offPosition;
+  uint8_t  raim;
+  uint8_t  virtualAid;
+  uint8_t  assigned;
+} AISAidToNavigationReport;
+
+// Message 22. When addressed, the area holds the two destination MMSIs instead.
+typedef struct {
+  uint16_t channelA;
+  uint16_t channelB;
+  uint8_t  txrx;
+  uint8_t  power;
+  uint8_t  addressed;
+  int32_t  neLon;               // 1/10 minute
+  int32_t  neLat;
+  int32_t  swLon;
+  int32_t  swLat;
+  uint32_t destination[2];
+  uint8_t  bandA;
+  uint8_t  bandB;
+  uint8_t  zoneSize;
+} AISChannelManagement;
+
+// Message 23
+typedef struct {
+  int32_t  neLon;               // 1/10 minute
+  int32_t  neLat;
+  int32_t  swLon;
+  int32_t  swLat;
+  uint8_t  stationType;
+  uint8_t  shipType;
+  uint8_t  txrx;
+  uint8_t  interval;
+  uint8_t  quiet;
+} AISGroupAssignment;
+
+// Message 24
+typedef struct {
+  uint8_t  part;                // 0 for A, 1 for B
+  char     name[21];            // Part A
+  uint8_t  shipType;            // Part B from here on
+  char     vendor[8];
+  char     callsign[8];
+  AISDimensions dimensions;     // Unless this is an auxiliary craft
+  uint32_t mothership;          // Auxiliary craft (MMSI 98XXXYYYY) only
+  uint8_t  epfd;
+} AISStaticDataReport;
+
+// Message 27
+typedef struct {
+  uint8_t  accuracy;
+  uint8_t  raim;
+  uint8_t  navStatus;
+  int32_t  lon;                 // 1/10 minute
+  int32_t  lat;
+  uint8_t  sog;                 // Knots
+  uint16_t cog;                 // Degrees
+  uint8_t  gnss;
+} AISLongRangeReport;
+
+typedef struct {
+  uint8_t  type;
+  uint8_t  repeat;
+  uint32_t mmsi;
+  union {
+    AISPositionReportA        positionA;
+    AISBaseStationReport      baseStation;
+    AISStaticVoyageData       staticVoyage;
+    AISBinaryMessage          binary;
+    AISAcknowledgement        ack;
+    AISSARAircraftReport      sar;
+    AISSafetyMessage          safety;
+    AISInterrogation          interrogation;
+    AISAssignmentCommand      assignment;
+    AISDGNSSBroadcast         dgnss;
+    AISPositionReportB        positionB;
+    AISDataLinkManagement     dataLink;
+    AISAidToNavigationReport  aton;
+    AISChannelManagement      channel;
+    AISGroupAssignment        group;
+    AISStaticDataReport       staticData;
+    AISLongRangeReport        longRange;
+  };
+} AISDecodedMessage;
+
+class AISDecoder
+{
+public:
+  // Fails for unknown types and packets that are too short for their type
+  static bool decode(const RXPacket &packet, AISDecodedMessage &msg);
+
+  // Copies the text of a safety message, up to size - 1 characters
+  static void text(const RXPacket &packet, const AISPayloadRef &ref, char *s, size_t size);
+
+private:
+  static bool decodePositionA(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeBaseStation(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeStaticVoyage(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeAddressedBinary(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeAcknowledgement(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeBroadcastBinary(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeSARAircraft(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeSafety(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeInterrogation(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeAssignment(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeDGNSS(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodePositionB(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeExtendedPositionB(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeDataLink(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeAidToNavigation(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeChannelManagement(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeGroupAssignment(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeStaticData(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeSlotBinary(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+  static bool decodeLongRange(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg);
+};
+
+#endif /* AISDECODER_HPP_ */
@@ -37,6 +37,8 @@
 #include <string>
 #include "StationData.h"
 
+class HDLCEncoder;
+
 // These are the AIS messages that this unit will actually work with
 
 /**
@@ -104,50 +106,6 @@ protected:
   uint8_t mType;    /**< AIS message type. */
   uint8_t mRI;      /**< Repeat indicator. */
   uint32_t mMMSI;   /**< MMSI (Maritime Mobile Service Identity). */
-
-protected:
-  void appendCRC(uint8_t *buff, uint16_t &size);
-  void addBits(uint8_t *buff, uint16_t &size, uint32_t value, uint8_t numBits);
-  void putBits(uint8_t *buff, uint32_t value, uint8_t numBits);
-  void addString(uint8_t *buff, uint16_t &size, const std::string &name, uint8_t maxChars);
-  void finalize(uint8_t *buff, uint16_t &size, TXPacket &packet);
-
-private:
-  void bitStuff(uint8_t *buff, uint16_t &size);
-  void constructHDLCFrame(uint8_t *buff, uint16_t &size);
-  void nrziEncode(uint8_t *buff, uint16_t &size, TXPacket &packet);
-  void payloadToBytes(uint8_t *bitVector, uint16_t numBits, uint8_t *bytes);
-  void reverseEachByte(uint8_t *bitVector, uint16_t numBits);
-};
-
-/**
- * @brief Class for handling AIS message 15 (interrogation).
- * @details This message type is received from shore stations and decoded.
- */
-class AISMessage15: public AISMessage
-{
-public:
-  /**
-   * @brief Structure for storing interrogation target details.
-   */
-  typedef struct {
-    uint32_t mmsi;       /**< MMSI of the target station. */
-    uint8_t  messageType; /**< Interrogation message type. */
-  } InterrogationTarget;
-
-  InterrogationTarget targets[3]; /**< Array of interrogation targets. */
-
-  /**
-   * @brief Constructor for AISMessage15.
-   */
-  AISMessage15();
-
-  /**
-   * @brief Decodes a received packet containing AIS message 15.
-   * @param packet The RXPacket containing the received AIS message 15 data.
-   * @return True if decoding was successful, false otherwise.
-   */
-  bool decode(const RXPacket &packet);
 };
 
 /**
@@ -174,6 +132,24 @@ public:
    * @param packet The TXPacket to store the encoded message.
    */
   void encode(const StationData &data, TXPacket &packet);
+
+  /**
+   * @brief Encodes the fields that only depend on the station (type, repeat indicator, MMSI and spare bits).
+   * @details The encoder can then serve as a template for many reports from the same station.
+   * @param data The station data to be included in the message.
+   * @param frame The encoder for the template frame.
+   */
+  void encodePrefix(const StationData &data, HDLCEncoder &frame);
+
+  /**
+   * @brief Encodes AIS message 18 into a transmit packet, starting from a template made by encodePrefix().
+   * @param prefix The template.
+   * @param packet The TXPacket to store the encoded message.
+   */
+  void encode(const HDLCEncoder &prefix, TXPacket &packet);
+
+private:
+  void encodeReport(HDLCEncoder &frame);
 };
 
 /**
@@ -216,32 +192,4 @@ public:
   void encode(const StationData &data, TXPacket &packet);
 };
 
-/*
- *   @brief AIS_peyload class defind and inheritance AISMessage class in public mode
- *
- *
- * */
-
-class AIS_peyload :public AISMessage
-{
-	  typedef struct {
-	    uint32_t mmsi;       /**< MMSI of the target station. */
-	    uint8_t  messageType; /**< Interrogation message type. */
-	  } InterrogationTarget;
-
-	  InterrogationTarget targets[3]; /**< Array of interrogation targets. */
-
-	/*
-	 *
-	 *
-	 *  this  constrator and deconstractor AIS_peyload
-	 */
-
-	AIS_peyload();
-	~AIS_peyload();
-
-	void encode(const StationData &data, TXPacket &packet);
-	bool decode(const RXPacket &packet);
-};
-
 #endif /* AISMESSAGES_HPP_ */
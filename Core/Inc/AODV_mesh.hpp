@@ -108,22 +108,6 @@ public:
   virtual bool decode(const RXPacket &packet);
 
   virtual void encode(const AODV_rreq_t &station, TXPacket &packet);
-
-
-
-protected:
-  void appendCRC(uint8_t *buff, uint16_t &size);
-  void addBits(uint8_t *buff, uint16_t &size, uint32_t value, uint8_t numBits);
-  void putBits(uint8_t *buff, uint32_t value, uint8_t numBits);
-  void addString(uint8_t *buff, uint16_t &size, const std::string &name, uint8_t maxChars);
-  void finalize(uint8_t *buff, uint16_t &size, TXPacket &packet);
-
-private:
-  void bitStuff(uint8_t *buff, uint16_t &size);
-  void constructHDLCFrame(uint8_t *buff, uint16_t &size);
-  void nrziEncode(uint8_t *buff, uint16_t &size, TXPacket &packet);
-  void payloadToBytes(uint8_t *bitVector, uint16_t numBits, uint8_t *bytes);
-  void reverseEachByte(uint8_t *bitVector, uint16_t numBits);
 };
 
 class AODVMessageRREP : public AODVMessage
@@ -0,0 +1,162 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file ByteRingBuffer.hpp
+ * @brief Single producer / single consumer byte ring for feeding a DMA engine.
+ * @details The producer appends whole lines from thread context. The consumer (a DMA completion interrupt)
+ *          drains the ring in contiguous chunks so each chunk can be handed to the DMA controller as-is.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef BYTERINGBUFFER_HPP_
+#define BYTERINGBUFFER_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+/**
+ * @brief Fixed-size byte ring with statistics.
+ * @tparam SIZE Capacity in bytes. Must be a power of 2.
+ */
+template<size_t SIZE>
+class ByteRingBuffer
+{
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "ByteRingBuffer size must be a power of 2");
+
+public:
+  ByteRingBuffer()
+  : mHead(0), mTail(0), mBytesQueued(0), mBytesDropped(0), mWritesDropped(0), mHighWater(0)
+  {
+  }
+
+  /**
+   * @brief Appends a block of bytes (producer side).
+   * @details The block is either queued in full or dropped in full, so a congested link
+   *          never emits a truncated NMEA sentence.
+   * @return True if the block was queued.
+   */
+  bool write(const uint8_t *data, size_t len)
+  {
+    uint32_t head = mHead.load(std::memory_order_relaxed);
+    uint32_t tail = mTail.load(std::memory_order_acquire);
+    uint32_t used = head - tail;
+
+    if ( len > SIZE - used )
+      {
+        mBytesDropped += len;
+        ++mWritesDropped;
+        return false;
+      }
+
+    uint32_t offset = head & (SIZE - 1);
+    size_t first = SIZE - offset;
+    if ( first > len )
+      first = len;
+
+    memcpy(mBuffer + offset, data, first);
+    memcpy(mBuffer, data + first, len - first);
+
+    mHead.store(head + len, std::memory_order_release);
+
+    mBytesQueued += len;
+    used += len;
+    if ( used > mHighWater )
+      mHighWater = used;
+
+    return true;
+  }
+
+  /**
+   * @brief Returns the longest contiguous run of queued bytes (consumer side).
+   * @param data Receives a pointer to the first byte of the run
+   * @return Number of bytes in the run, 0 if the ring is empty
+   */
+  size_t peekContiguous(const uint8_t *&data) const
+  {
+    uint32_t tail = mTail.load(std::memory_order_relaxed);
+    uint32_t head = mHead.load(std::memory_order_acquire);
+    uint32_t used = head - tail;
+    if ( used == 0 )
+      return 0;
+
+    uint32_t offset = tail & (SIZE - 1);
+    data = mBuffer + offset;
+    return used < SIZE - offset ? used : SIZE - offset;
+  }
+
+  /**
+   * @brief Releases bytes previously obtained through peekContiguous() (consumer side).
+   */
+  void consume(size_t len)
+  {
+    mTail.store(mTail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+  }
+
+  inline bool empty() const
+  {
+    return used() == 0;
+  }
+
+  inline size_t used() const
+  {
+    return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+  }
+
+  inline size_t capacity() const
+  {
+    return SIZE;
+  }
+
+  inline uint32_t bytesQueued() const
+  {
+    return mBytesQueued;
+  }
+
+  inline uint32_t bytesDropped() const
+  {
+    return mBytesDropped;
+  }
+
+  inline uint32_t writesDropped() const
+  {
+    return mWritesDropped;
+  }
+
+  inline uint32_t highWater() const
+  {
+    return mHighWater;
+  }
+
+private:
+  uint8_t mBuffer[SIZE];
+  std::atomic<uint32_t> mHead;    // Only advanced by the producer
+  std::atomic<uint32_t> mTail;    // Only advanced by the consumer
+  uint32_t mBytesQueued;
+  uint32_t mBytesDropped;
+  uint32_t mWritesDropped;
+  uint32_t mHighWater;
+};
+
+#endif /* BYTERINGBUFFER_HPP_ */
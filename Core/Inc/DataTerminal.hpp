@@ -24,6 +24,9 @@
 #include <vector>
 #include <string>
 #include "config.h"
+#if TERMINAL_DMA_TX
+#include "ByteRingBuffer.hpp"
+#endif
 
 using namespace std;
 
@@ -42,15 +45,30 @@ public:
 #else
   void write(const char* line);
 #endif
+
+  void reportStats();
+
+#if TERMINAL_DMA_TX
+  void onTXComplete();
+#endif
 private:
   DataTerminal();
   void processCommand(const char*);
 
   void _write(const char* s);
+#if TERMINAL_DMA_TX
+  void queue(const char* s);
+  void startTransfer();
+#endif
 private:
   char mCmdBuffer[64];
   size_t mCmdBuffPos;
   vector<string> mCmdTokens;
+#if TERMINAL_DMA_TX
+  ByteRingBuffer<TERMINAL_TX_BUFFER_SIZE> mTXBuffer;
+  volatile uint16_t mTXLength;     // Bytes currently owned by the DMA engine, 0 when idle
+  volatile uint32_t mBytesSent;
+#endif
 };
 #endif
 
@@ -21,13 +21,41 @@
 #ifndef EVENTQUEUE_HPP_
 #define EVENTQUEUE_HPP_
 
-#include <map>
-#include "CircularQueue.hpp"
+#include "LockFreeQueue.hpp"
 #include "Events.hpp"
 
 
 using namespace std;
 
+// Maximum number of consumers that can observe any single event type
+#define MAX_CONSUMERS_PER_EVENT   8
+
+/*
+ * Events are queued in priority lanes, so a flood of low value events (GPS chatter, debug output)
+ * can never crowd out decoded AIS packets. Lanes are drained in order, highest priority first.
+ */
+typedef enum {
+  LANE_CRITICAL = 0,      // AIS packets, interrogations, clock ticks
+  LANE_CONTROL,           // Commands, fixes, proprietary output and anything not listed elsewhere
+  LANE_BULK,              // Raw GPS sentences, debug messages, RSSI samples
+  EVENT_LANE_COUNT
+} EventLane;
+
+// Interrupt pool entries that only critical lane events may take
+#define CRITICAL_EVENT_RESERVE    6
+
+typedef enum {
+  DROP_NEWEST,            // A full lane rejects the incoming event
+  DROP_OLDEST             // A full lane evicts its oldest event to make room (freshest data wins)
+} DropPolicy;
+
+typedef struct {
+  uint32_t pushed;
+  uint32_t dropped;       // Rejected by a full lane (DROP_NEWEST)
+  uint32_t evicted;       // Pushed out of a full lane (DROP_OLDEST)
+  uint32_t refused;       // Never allocated, to keep pool headroom for the critical lane
+} LaneStats;
+
 class EventQueue
 {
 public:
@@ -38,7 +66,7 @@ public:
   /*
    * Consumer registration
    */
-  void addObserver(EventConsumer *c, uint32_t eventMask);
+  void addObserver(EventConsumer *c, EventMask eventMask);
 
   /*
    * Consumer de-registration
@@ -54,11 +82,29 @@ public:
    * This method must be called repeatedly by an RTOS task or main() (never an ISR)
    */
   void dispatch();
+
+  /*
+   * Lane bookkeeping, also used by the EventPool to apply backpressure
+   */
+  EventLane laneFor(EventType type);
+  void countRefused(EventType type);
+
+  /*
+   * Emits one $PAIEVQ sentence per lane
+   */
+  void reportStats();
 private:
   EventQueue();
-  CircularQueue<Event*> mISRQueue;
-  CircularQueue<Event*> mTaskQueue;
-  map<EventConsumer *, uint32_t> mConsumers;
+  void dispatch(Event *e);
+private:
+  // Any context may push into (and evict from) any lane, so the lanes must be multi-producer/multi-consumer
+  MPMCQueue<Event*, 32> mLanes[EVENT_LANE_COUNT];
+  LaneStats mLaneStats[EVENT_LANE_COUNT];
+  uint8_t mLaneOf[EVENT_TYPE_COUNT];
+
+  // One consumer list per event bit, in registration order. No heap, no mask tests at dispatch time.
+  EventConsumer *mConsumers[EVENT_TYPE_COUNT][MAX_CONSUMERS_PER_EVENT];
+  uint8_t mConsumerCount[EVENT_TYPE_COUNT];
 };
 
 #endif /* EVENTQUEUE_HPP_ */
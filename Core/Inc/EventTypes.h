@@ -22,12 +22,16 @@
 #define EVENTTYPES_H_
 
 
+#include <stdint.h>
+
 /*
- * Various events that flow through the system. Their identifiers form a bit mask for quick filtering,
- * which means we are limited to 32 distinct events.
+ * Various events that flow through the system. Their identifiers form a bit mask for quick filtering.
+ * The mask is 64 bits wide, so we are limited to 64 distinct events. Every event must own exactly one bit.
  */
 
-typedef enum {
+typedef uint64_t EventMask;
+
+typedef enum : uint64_t {
     UNKNOWN_EVENT        =   0x00000,         // Invalid, not a real event id
     GPS_NMEA_SENTENCE    =   0x00001,         // A NMEA sentence was received from the GPS.
     GPS_FIX_EVENT        =   0x00002,         // The GPS obtained a fix.
@@ -39,12 +43,20 @@ typedef enum {
     DFU_EVENT            =   0x00080,         // Enter DFU mode
     COMMAND_EVENT        =   0x00100,         // An unparsed request (raw format)
     RSSI_SAMPLE_EVENT    =   0x00200,         // An RSSI sample (very high frequency event)
-	AODV_REQUEST		 =	 0x00400,		  // AODV Request
-	AODV_ACK 			 =   0x00800,         // AODV Request Acknowledgment
-	AODV_ERROR 			 =	 0x00820          // AODV Request Error
+    AODV_REQUEST         =   0x00400,         // AODV Request
+    AODV_ACK             =   0x00800,         // AODV Request Acknowledgment
+    AODV_ERROR           =   0x01000,         // AODV Request Error
+
+    LAST_EVENT           =   AODV_ERROR       // Must always alias the highest event bit
 }
 EventType;
 
+// Number of distinct event ids, i.e. the number of rows in the dispatch table
+#define EVENT_TYPE_COUNT          (__builtin_ctzll(LAST_EVENT) + 1)
+
+// Index of an event id in the dispatch table
+#define EVENT_TYPE_INDEX(t)       __builtin_ctzll(t)
+
 
 
 #endif /* EVENTTYPES_H_ */
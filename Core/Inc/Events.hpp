@@ -22,6 +22,7 @@
 #define EVENTS_HPP_
 
 #include "EventTypes.h"
+#include "config.h"
 #include <time.h>
 #include <cstring>
 #include "NMEASentence.hpp"
@@ -90,6 +91,13 @@ public:
   // This is an object, so it can't be a member of the union ...
   RXPacket *rxPacket;
 
+#if EVENT_LATENCY_TRACING
+  // DWT cycle counter stamps
+  uint32_t allocCycles;
+  uint32_t pushCycles;
+  uint32_t dispatchCycles;
+#endif
+
   union {
     NMEABuffer nmeaBuffer;
     GPSFix gpsFix;
@@ -126,13 +134,15 @@ public:
   uint32_t maxUtilization();
   RXPacket *newRXPacket();
   void releaseRXPacket(RXPacket *);
+  void reportStats();
 private:
   EventPool();
+  template<typename P> void reportPool(const char *name, P &pool);
 
 private:
-  ObjectPool<Event>     mISRPool;
-  ObjectPool<Event>     mThreadPool;
-  ObjectPool<RXPacket>  mRXPool;
+  ObjectPool<Event, 25>     mISRPool;
+  ObjectPool<Event, 10>     mThreadPool;
+  ObjectPool<RXPacket, 20>  mRXPool;
 };
 
 #endif /* EVENTS_HPP_ */
@@ -0,0 +1,109 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file HDLCDecoder.hpp
+ * @brief NRZI and HDLC decoding of raw RFIC data levels, 8 bits at a time.
+ * @details The bit clock interrupt only samples the data pin and packs the levels into bytes.
+ *          This class turns those bytes into RXPackets outside the interrupt. Most bytes take a fast path:
+ *          the NRZI decode of all 8 bits is a single XOR, and a 5-ones run detector over the bit window
+ *          proves that no flag, stuffed bit or abort can occur in them, so the byte goes straight to the packet.
+ *          Bytes that may contain one of those fall back to the exact per-bit state machine, so the output
+ *          is identical to decoding every bit in the interrupt.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef HDLCDECODER_HPP_
+#define HDLCDECODER_HPP_
+
+#include <stdint.h>
+#include "config.h"
+#include "RXPacket.hpp"
+
+typedef enum
+{
+  FRAME_ABORT_STUFFING,     // 7 or more consecutive ones
+  FRAME_ABORT_OVERSIZE      // No end flag within MAX_AIS_RX_PACKET_SIZE bits
+} FrameAbortReason;
+
+/**
+ * @brief Receives framing notifications from an HDLCDecoder.
+ * @details bitsLeft is the number of levels of the current byte that follow the bit which triggered the call.
+ */
+class HDLCDecoderListener
+{
+public:
+  virtual ~HDLCDecoderListener() {}
+
+  // The training sequence and start flag were found
+  virtual void onFrameStart(uint8_t bitsLeft) = 0;
+
+  // The end flag was found. The listener takes the packet and must install another one with setPacket().
+  // When resync is set, the flag may also start a colliding frame, which is decoded next (onFrameStart() follows).
+  virtual void onFrameEnd(uint8_t bitsLeft, bool resync) = 0;
+
+  // The frame was abandoned. The packet still holds what was received, and is cleared right after this.
+  virtual void onFrameAbort(FrameAbortReason reason) = 0;
+};
+
+class HDLCDecoder
+{
+public:
+  HDLCDecoder(HDLCDecoderListener *listener);
+
+  void setPacket(RXPacket *packet);
+
+  // Starts scanning for a new frame and clears the current packet
+  void reset();
+
+  // Decodes 8 consecutive data levels. The MSB is the earliest one.
+  void decode(uint8_t levels);
+
+  inline bool inPacket() const
+  {
+    return mState == IN_PACKET;
+  }
+
+private:
+  typedef enum
+  {
+    PREAMBLE_SYNC,
+    IN_PACKET
+  } State;
+
+  void decodeBit(uint8_t level, uint8_t bitsLeft);
+  int8_t syncErrors() const;
+  bool trainingComplete() const;
+  void addBit(uint8_t bit);
+
+private:
+  HDLCDecoderListener *mListener;
+  RXPacket *mPacket;
+  volatile State mState;
+  uint32_t mWindow;         // Last 32 NRZI-decoded bits, newest in the LSB
+  uint8_t mLastLevel;       // 0xff when the next level has no predecessor
+  uint8_t mOnes;            // Consecutive ones within the packet
+  uint8_t mDataBits;        // Number of de-stuffed bits in mData
+  uint8_t mData;
+};
+
+#endif /* HDLCDECODER_HPP_ */
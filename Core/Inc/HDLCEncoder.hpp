@@ -0,0 +1,82 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file HDLCEncoder.hpp
+ * @brief Single pass AIS frame encoder, from message fields to NRZI levels in a TXPacket.
+ * @details Fields are packed into bytes as they are added. Every completed byte goes through the CRC
+ *          with one table lookup, then through bit stuffing and NRZI encoding and straight into the packet.
+ *          Most bytes cannot contain a run of 5 ones, and those are stuffed and NRZI encoded as a whole with
+ *          a few shifts and XORs. The others are stuffed one bit at a time.
+ *
+ *          The ramp up bits, training sequence and start flag are written by the constructor, the CRC,
+ *          end flag and ramp down bits by finish(). The result is the same as building the frame one bit
+ *          per byte, reversing, stuffing, framing and NRZI encoding it in separate passes.
+ *
+ *          An encoder can be kept after its first few fields as a template. Another encoder picks up from it
+ *          with a copy of its frame, so frames that always start with the same fields only encode the rest.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef HDLCENCODER_HPP_
+#define HDLCENCODER_HPP_
+
+#include <stdint.h>
+#include "TXPacket.hpp"
+
+class HDLCEncoder
+{
+public:
+  // Starts a frame in an empty packet
+  HDLCEncoder(TXPacket &packet);
+
+  // Carries on from a template. The packet gets a copy of the template's frame so far.
+  HDLCEncoder(TXPacket &packet, const HDLCEncoder &prefix);
+
+  // Appends the numBits least significant bits of value, most significant first
+  void addBits(uint32_t value, uint8_t numBits);
+
+  // Appends a string as 6-bit characters, padded with '@' (0) to maxChars
+  void addString(const char *value, uint8_t maxChars);
+
+  // Number of payload bits added so far
+  uint16_t size() const;
+
+  // Appends the CRC and closes the frame. The payload must be a whole number of bytes.
+  void finish();
+
+private:
+  void addByte(uint8_t byte);
+  void stuffByte(uint8_t byte);
+  void sendLevels(uint32_t bits, uint8_t count);
+
+private:
+  TXPacket *mPacket;
+  uint64_t mBits;           // Payload bits that don't make up a byte yet, newest in the LSB
+  uint8_t mNumBits;
+  uint16_t mSize;
+  uint16_t mCRC;
+  uint8_t mOnes;            // Consecutive ones sent since the start flag
+  uint8_t mLevel;           // Last NRZI level
+};
+
+#endif /* HDLCENCODER_HPP_ */
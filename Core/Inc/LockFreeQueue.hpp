@@ -0,0 +1,308 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file LockFreeQueue.hpp
+ * @brief Fixed-capacity lock-free ring queues that are safe to share between interrupts and the main loop.
+ * @details Two flavors are provided:
+ *          - SPSCQueue: exactly one producer context and one consumer context.
+ *          - MPMCQueue: any number of producers and consumers, including interrupts of different
+ *            priorities preempting each other (Vyukov's bounded queue with per-cell sequence numbers).
+ *
+ *          Capacity is a compile-time power of 2, storage is embedded in the object (no heap) and indices
+ *          wrap with a mask. Ordering relies on std::atomic acquire/release, which GCC lowers to
+ *          LDREX/STREX and DMB on the Cortex-M4. Neither queue ever spins waiting on another context:
+ *          a push or pop that would have to wait for a preempted context reports full or empty instead.
+ *
+ *          Every queue keeps a high-water mark and an overflow (rejected push) count.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef LOCKFREEQUEUE_HPP_
+#define LOCKFREEQUEUE_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief Rounds a requested element count up to a valid queue capacity (power of 2).
+ */
+constexpr size_t queueCapacityFor(size_t n)
+{
+  size_t c = 2;
+  while ( c < n )
+    c <<= 1;
+  return c;
+}
+
+/**
+ * @brief Single producer / single consumer ring.
+ * @tparam T Element type (should be cheap to copy, typically a pointer)
+ * @tparam N Capacity. Must be a power of 2.
+ */
+template<typename T, size_t N>
+class SPSCQueue
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Queue capacity must be a power of 2");
+
+public:
+  SPSCQueue()
+  : mHead(0), mTail(0), mHighWater(0), mOverflows(0)
+  {
+  }
+
+  /**
+   * @brief Appends an element (producer context only).
+   * @return False if the queue was full
+   */
+  bool push(const T &element)
+  {
+    uint32_t head = mHead.load(std::memory_order_relaxed);
+    uint32_t tail = mTail.load(std::memory_order_acquire);
+    if ( head - tail >= N )
+      {
+        ++mOverflows;
+        return false;
+      }
+
+    mBuffer[head & (N - 1)] = element;
+    mHead.store(head + 1, std::memory_order_release);
+
+    if ( head + 1 - tail > mHighWater )
+      mHighWater = head + 1 - tail;
+
+    return true;
+  }
+
+  /**
+   * @brief Removes the oldest element (consumer context only).
+   * @return False if the queue was empty
+   */
+  bool pop(T &element)
+  {
+    uint32_t tail = mTail.load(std::memory_order_relaxed);
+    uint32_t head = mHead.load(std::memory_order_acquire);
+    if ( head == tail )
+      return false;
+
+    element = mBuffer[tail & (N - 1)];
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Removes up to max elements with a single index update (consumer context only).
+   * @return Number of elements copied into out
+   */
+  size_t popBatch(T *out, size_t max)
+  {
+    uint32_t tail = mTail.load(std::memory_order_relaxed);
+    uint32_t head = mHead.load(std::memory_order_acquire);
+    size_t count = head - tail;
+    if ( count > max )
+      count = max;
+
+    for ( size_t i = 0; i < count; ++i )
+      out[i] = mBuffer[(tail + i) & (N - 1)];
+
+    mTail.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  inline bool empty() const
+  {
+    return size() == 0;
+  }
+
+  inline size_t size() const
+  {
+    return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity()
+  {
+    return N;
+  }
+
+  inline uint32_t highWater() const
+  {
+    return mHighWater;
+  }
+
+  inline uint32_t overflows() const
+  {
+    return mOverflows;
+  }
+
+private:
+  T mBuffer[N];
+  std::atomic<uint32_t> mHead;
+  std::atomic<uint32_t> mTail;
+  uint32_t mHighWater;      // Only written by the producer
+  uint32_t mOverflows;      // Only written by the producer
+};
+
+/**
+ * @brief Multiple producer / multiple consumer ring. Also the one to use for MPSC.
+ * @tparam T Element type (should be cheap to copy, typically a pointer)
+ * @tparam N Capacity. Must be a power of 2.
+ */
+template<typename T, size_t N>
+class MPMCQueue
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "Queue capacity must be a power of 2");
+
+public:
+  MPMCQueue()
+  : mEnqueuePos(0), mDequeuePos(0), mHighWater(0), mOverflows(0)
+  {
+    for ( uint32_t i = 0; i < N; ++i )
+      mCells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Appends an element. Safe from any context.
+   * @return False if the queue was full (or its next cell is still being drained by a preempted consumer)
+   */
+  bool push(const T &element)
+  {
+    uint32_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    for ( ;; )
+      {
+        Cell &cell = mCells[pos & (N - 1)];
+        int32_t diff = (int32_t)(cell.sequence.load(std::memory_order_acquire) - pos);
+        if ( diff == 0 )
+          {
+            if ( mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+              {
+                cell.data = element;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                updateHighWater(pos + 1 - mDequeuePos.load(std::memory_order_relaxed));
+                return true;
+              }
+          }
+        else if ( diff < 0 )
+          {
+            mOverflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+          }
+        else
+          {
+            pos = mEnqueuePos.load(std::memory_order_relaxed);
+          }
+      }
+  }
+
+  /**
+   * @brief Removes the oldest published element. Safe from any context.
+   * @return False if the queue was empty (or its oldest cell is still being filled by a preempted producer)
+   */
+  bool pop(T &element)
+  {
+    uint32_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    for ( ;; )
+      {
+        Cell &cell = mCells[pos & (N - 1)];
+        int32_t diff = (int32_t)(cell.sequence.load(std::memory_order_acquire) - (pos + 1));
+        if ( diff == 0 )
+          {
+            if ( mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+              {
+                element = cell.data;
+                cell.sequence.store(pos + N, std::memory_order_release);
+                return true;
+              }
+          }
+        else if ( diff < 0 )
+          {
+            return false;
+          }
+        else
+          {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+          }
+      }
+  }
+
+  /**
+   * @brief Removes up to max elements.
+   * @return Number of elements copied into out
+   */
+  size_t popBatch(T *out, size_t max)
+  {
+    size_t count = 0;
+    while ( count < max && pop(out[count]) )
+      ++count;
+
+    return count;
+  }
+
+  inline bool empty() const
+  {
+    return size() == 0;
+  }
+
+  inline size_t size() const
+  {
+    int32_t n = (int32_t)(mEnqueuePos.load(std::memory_order_acquire) - mDequeuePos.load(std::memory_order_acquire));
+    return n > 0 ? n : 0;
+  }
+
+  static constexpr size_t capacity()
+  {
+    return N;
+  }
+
+  inline uint32_t highWater() const
+  {
+    return mHighWater.load(std::memory_order_relaxed);
+  }
+
+  inline uint32_t overflows() const
+  {
+    return mOverflows.load(std::memory_order_relaxed);
+  }
+
+private:
+  void updateHighWater(uint32_t n)
+  {
+    uint32_t hw = mHighWater.load(std::memory_order_relaxed);
+    while ( n > hw && n <= N && !mHighWater.compare_exchange_weak(hw, n, std::memory_order_relaxed) )
+      ;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<uint32_t> sequence;
+    T data;
+  };
+
+  Cell mCells[N];
+  std::atomic<uint32_t> mEnqueuePos;
+  std::atomic<uint32_t> mDequeuePos;
+  std::atomic<uint32_t> mHighWater;
+  std::atomic<uint32_t> mOverflows;
+};
+
+#endif /* LOCKFREEQUEUE_HPP_ */
@@ -0,0 +1,167 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file MessageLayout.hpp
+ * @brief Compile time description of message payloads, shared by the AIS, AODV and arbitrary TX messages.
+ * @details A MessageLayout is the list of a payload's fields, in the order they go on air. Each field type knows
+ *          its width and how to put a value into an HDLCEncoder and get one out of an RXPacket, so the layout
+ *          yields both the encoder and the decoder of the payload:
+ *
+ *            typedef MessageLayout<UField<6>, UField<2>, UField<30>, StringField<20>> Layout;
+ *            static_assert(Layout::BITS == 160, "...");
+ *            Layout::encode(frame, type, ri, mmsi, name);
+ *            uint32_t mmsi = Layout::decode<2>(packet);
+ *
+ *          The total length and every field offset are compile time constants, and encode() takes exactly one
+ *          value per field, so a missing or extra field is a compile error rather than a bad frame on air.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef MESSAGELAYOUT_HPP_
+#define MESSAGELAYOUT_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tuple>
+#include "HDLCEncoder.hpp"
+#include "RXPacket.hpp"
+
+// An unsigned integer
+template<uint8_t Width>
+struct UField
+{
+  static_assert(Width > 0 && Width <= 32, "Fields are 1 to 32 bits wide");
+  static constexpr uint16_t width = Width;
+  typedef uint32_t value_type;
+
+  static inline void put(HDLCEncoder &frame, uint32_t value)
+  {
+    frame.addBits(value, Width);
+  }
+
+  static inline uint32_t get(const RXPacket &packet, uint16_t pos)
+  {
+    return packet.bits(pos, Width);
+  }
+};
+
+// A two's complement integer
+template<uint8_t Width>
+struct SField
+{
+  static_assert(Width > 1 && Width <= 32, "Signed fields are 2 to 32 bits wide");
+  static constexpr uint16_t width = Width;
+  typedef int32_t value_type;
+
+  static inline void put(HDLCEncoder &frame, int32_t value)
+  {
+    frame.addBits(value, Width);
+  }
+
+  static inline int32_t get(const RXPacket &packet, uint16_t pos)
+  {
+    return (int32_t)(packet.bits(pos, Width) << (32 - Width)) >> (32 - Width);
+  }
+};
+
+// Up to Chars 6-bit characters, padded with '@'
+template<uint8_t Chars>
+struct StringField
+{
+  static_assert(Chars > 0, "Strings have at least one character");
+  static constexpr uint16_t width = Chars * 6;
+  typedef const char *value_type;
+
+  static inline void put(HDLCEncoder &frame, const char *value)
+  {
+    frame.addString(value, Chars);
+  }
+
+  // Writes up to Chars characters plus a terminating 0. The padding is dropped.
+  static void get(const RXPacket &packet, uint16_t pos, char *s)
+  {
+    uint8_t c = 0;
+    for ( ; c < Chars; ++c, pos += 6 )
+      {
+        uint8_t v = packet.bits(pos, 6);
+        if ( v == 0 )
+          break;
+        s[c] = v < 32 ? v + 64 : v;
+      }
+
+    s[c] = 0;
+  }
+};
+
+// Bit offset of a field, or the total length when index is the number of fields
+template<typename... Fields>
+constexpr uint16_t messageLayoutOffset(size_t index)
+{
+  const uint16_t widths[] = { 0, Fields::width... };
+  uint16_t offset = 0;
+  for ( size_t i = 0; i < index; ++i )
+    offset += widths[i + 1];
+
+  return offset;
+}
+
+template<typename... Fields>
+struct MessageLayout
+{
+  static constexpr size_t FIELDS = sizeof...(Fields);
+  static constexpr uint16_t BITS = messageLayoutOffset<Fields...>(sizeof...(Fields));
+
+  template<size_t I>
+  using Field = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+  template<size_t I>
+  static constexpr uint16_t offset()
+  {
+    static_assert(I < sizeof...(Fields), "No such field");
+    return messageLayoutOffset<Fields...>(I);
+  }
+
+  // Appends every field to the frame, in layout order
+  static inline void encode(HDLCEncoder &frame, typename Fields::value_type... values)
+  {
+    // Braced initializers are evaluated left to right
+    int expand[] = { 0, (Fields::put(frame, values), 0)... };
+    (void)expand;
+  }
+
+  template<size_t I>
+  static inline typename Field<I>::value_type decode(const RXPacket &packet)
+  {
+    return Field<I>::get(packet, offset<I>());
+  }
+
+  // String fields are decoded into a buffer that holds all of their characters and the terminating 0
+  template<size_t I, size_t N>
+  static inline void decode(const RXPacket &packet, char (&s)[N])
+  {
+    static_assert(N > Field<I>::width / 6, "The buffer is too short for the string");
+    Field<I>::get(packet, offset<I>(), s);
+  }
+};
+
+#endif /* MESSAGELAYOUT_HPP_ */
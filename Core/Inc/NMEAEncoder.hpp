@@ -36,6 +36,7 @@ public:
 
   void encode(RXPacket &packet, vector<string> &sentences);
 private:
+  uint8_t armor(const RXPacket &packet, uint16_t pos, uint16_t numBits, char *out);
   uint8_t nmeaCRC(const char* buff);
 private:
   uint8_t mSequence;
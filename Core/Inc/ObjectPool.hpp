@@ -26,63 +26,169 @@ using namespace std;
 
 #include "printf_serial.h"
 #include "_assert.h"
-#include "CircularQueue.hpp"
 #include "Utils.hpp"
+#include "config.h"
+#include <atomic>
+#include <new>
+#include <string.h>
 
-
-template<typename T> class ObjectPool
+/*
+ * Fixed capacity object pool. All objects live inside the pool itself, so a statically allocated
+ * pool ends up in .bss and nothing is taken from the heap.
+ *
+ * The free list is a Treiber stack of slot indices. Its head packs a 16 bit generation tag
+ * with the index, so a get() that is preempted between reading the head and swapping it
+ * can't be fooled by another context recycling the same slot (ABA). get() and put() are safe
+ * from any interrupt priority as well as the main loop.
+ *
+ * With POOL_POISONING defined, returned objects are destroyed and filled with a marker pattern.
+ * get() checks that the pattern is intact (catching writes through stale pointers) and constructs
+ * a fresh object. put() catches double frees.
+ */
+template<typename T, uint32_t SIZE> class ObjectPool
 {
+  static_assert(SIZE > 0 && SIZE < 0xffff, "Pool size out of range");
+
 public:
 
-  ObjectPool<T>(uint32_t size)
-    : mQueue(size)
+  ObjectPool()
+    : mFreeHead(0), mInUse(0), mHighWater(0), mAllocFailures(0)
   {
-    mSize = size;
-    mUtilization = 0;
-    mMaxUtilization = 0;
-
-    //printf_serial_now("ObjectPool @%p\r\n", this);
-    for ( uint32_t i = 0; i < mSize; ++i )
+    for ( uint32_t i = 0; i < SIZE; ++i )
       {
-        T *p = new T();
-        ASSERT_VALID_PTR(p);
-        mQueue.push(p);
-        //printf_serial_now("\t@%p\r\n", p);
+#ifdef POOL_POISONING
+        memset(mStorage[i], POISON_BYTE, sizeof(T));
+#else
+        new (slot(i)) T();
+#endif
+        mNext[i] = (i + 1 < SIZE) ? i + 1 : NIL;
       }
   }
 
   T *get()
   {
-    T *result = nullptr;
-    mQueue.pop(result);
+    uint32_t head = mFreeHead.load(std::memory_order_acquire);
+    uint32_t next;
+    do
+      {
+        uint16_t index = head & 0xffff;
+        if ( index == NIL )
+          {
+            mAllocFailures.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+          }
+
+        next = ((head + 0x10000) & 0xffff0000) | mNext[index];
+      }
+    while ( !mFreeHead.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire) );
+
+    T *result = slot(head & 0xffff);
+
+    uint32_t inUse = mInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t hw = mHighWater.load(std::memory_order_relaxed);
+    while ( inUse > hw && !mHighWater.compare_exchange_weak(hw, inUse, std::memory_order_relaxed) )
+      ;
+
+#ifdef POOL_POISONING
+    ASSERT(isPoisoned(result));
+    new (result) T();
+#endif
+
     return result;
   }
 
   void put(T* o)
   {
-    mQueue.push(o);
+    uint32_t index = indexOf(o);
+    ASSERT(index < SIZE);
+    if ( index >= SIZE )
+      return;
+
+#ifdef POOL_POISONING
+    ASSERT(!isPoisoned(o));
+    o->~T();
+    memset((void*)o, POISON_BYTE, sizeof(T));
+#endif
+
+    uint32_t head = mFreeHead.load(std::memory_order_relaxed);
+    uint32_t next;
+    do
+      {
+        mNext[index] = head & 0xffff;
+        next = ((head + 0x10000) & 0xffff0000) | index;
+      }
+    while ( !mFreeHead.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_relaxed) );
+
+    mInUse.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  bool owns(const T *o)
+  {
+    return indexOf(o) < SIZE;
   }
 
   uint32_t maxUtilization()
   {
-    return mMaxUtilization;
+    return mHighWater.load(std::memory_order_relaxed);
   }
 
   uint32_t utilization()
   {
-    return mUtilization;
+    return mInUse.load(std::memory_order_relaxed);
+  }
+
+  uint32_t allocFailures()
+  {
+    return mAllocFailures.load(std::memory_order_relaxed);
   }
 
   uint32_t size()
   {
-    return mSize;
+    return SIZE;
+  }
+
+  uint32_t available()
+  {
+    return SIZE - utilization();
+  }
+
+private:
+  static const uint16_t NIL = 0xffff;
+  static const uint8_t POISON_BYTE = 0xDB;
+
+  inline T *slot(uint32_t i)
+  {
+    return reinterpret_cast<T*>(mStorage[i]);
+  }
+
+  inline uint32_t indexOf(const T *o)
+  {
+    uintptr_t offset = (uintptr_t)o - (uintptr_t)mStorage;
+    if ( (uintptr_t)o < (uintptr_t)mStorage || offset % sizeof(T) != 0 )
+      return SIZE;
+
+    return offset / sizeof(T);
+  }
+
+#ifdef POOL_POISONING
+  bool isPoisoned(const T *o)
+  {
+    const uint8_t *p = (const uint8_t*)o;
+    for ( size_t i = 0; i < sizeof(T); ++i )
+      if ( p[i] != POISON_BYTE )
+        return false;
+
+    return true;
   }
+#endif
 
 private:
-  uint32_t          mSize;
-  uint32_t          mUtilization;
-  uint32_t          mMaxUtilization;
-  CircularQueue<T*> mQueue;
+  alignas(T) uint8_t    mStorage[SIZE][sizeof(T)];
+  uint16_t              mNext[SIZE];
+  std::atomic<uint32_t> mFreeHead;      // Generation tag (high 16 bits), free slot index (low 16 bits)
+  std::atomic<uint32_t> mInUse;
+  std::atomic<uint32_t> mHighWater;
+  std::atomic<uint32_t> mAllocFailures;
 };
 
 #endif /* OBJECTPOOL_HPP_ */
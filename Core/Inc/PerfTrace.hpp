@@ -0,0 +1,174 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file PerfTrace.hpp
+ * @brief Event latency tracing based on the Cortex-M4 DWT cycle counter.
+ * @details When EVENT_LATENCY_TRACING is defined in config.h, every Event is stamped when it is allocated,
+ *          when it is pushed and when its dispatch begins. Each consumer's processEvent() is timed as well.
+ *          The results are kept in log2 histograms (in microseconds) per event type and per consumer,
+ *          and the "perf?" command dumps them as $PAIPRF sentences. The receiver's bit clock interrupt, the
+ *          RSSI reads in it and RXPacket::addByte() in the HDLC decoder are timed too, to keep an eye on the time
+ *          they take away from everything else, and so are the encoding of every transmitted message and the
+ *          decoding and NMEA encoding of every received one. The bit clock interrupt and addByte() are far below a microsecond,
+ *          so their mean and max are reported in cycles.
+ *
+ *          When the switch is off, the PERF_* macros expand to nothing and none of this is compiled.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef PERFTRACE_HPP_
+#define PERFTRACE_HPP_
+
+#include "config.h"
+
+#if EVENT_LATENCY_TRACING
+
+#include "Events.hpp"
+#include "main.h"
+
+// Bucket 0 holds latencies under 2us, bucket k holds [2^k, 2^(k+1)) us and the last one holds everything above
+#define PERF_HISTOGRAM_BUCKETS        14
+
+// Consumers are tracked in a small table, in order of first appearance
+#define PERF_MAX_CONSUMERS            12
+
+typedef struct {
+  uint32_t count;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint16_t buckets[PERF_HISTOGRAM_BUCKETS];   // Saturating
+} LatencyHistogram;
+
+class PerfTrace : public EventConsumer
+{
+public:
+  static PerfTrace &instance();
+
+  // Starts the cycle counter. Must be called before any event is allocated.
+  void init();
+
+  static inline uint32_t now()
+  {
+    return DWT->CYCCNT;
+  }
+
+  // All of these are only called from the dispatch loop
+  void consumerDone(EventConsumer *c, uint32_t enterCycles);
+  void eventDone(const Event &e);
+
+  // The receiver's bit clock interrupt, from the pin read to the captured byte. Only called from there.
+  void bitClock(uint32_t cycles);
+
+  // RSSI reads in the bit clock interrupt. Only called from there.
+  void rssiRead(uint32_t cycles);
+
+  // RXPacket::addByte() in the HDLC decoder, once per received byte
+  void byteAdd(uint32_t cycles);
+
+  // Message encoding, from the first field to the padded TXPacket
+  void txEncode(uint32_t cycles);
+
+  // Message decoding, from a valid RXPacket to its fields
+  void rxDecode(uint32_t cycles);
+
+  // Turning a valid RXPacket into !AIVDM sentences
+  void rxNMEA(uint32_t cycles);
+
+  void reset();
+
+  // The report is paced over a few clock ticks, so it does not exhaust the event pool
+  void reportStats();
+
+  void processEvent(const Event &e);
+private:
+  PerfTrace();
+  void record(LatencyHistogram &h, uint32_t cycles);
+  bool emit(const char *kind, uint32_t id, const char *metric, const LatencyHistogram &h, bool cycles = false);
+  void reportNext();
+
+private:
+  enum {
+    FILL,         // newEvent() -> push()
+    WAIT,         // push() -> dispatch
+    TOTAL,        // newEvent() -> last consumer done
+    METRIC_COUNT
+  };
+
+  LatencyHistogram  mEvents[EVENT_TYPE_COUNT][METRIC_COUNT];
+  LatencyHistogram  mConsumerRuns[PERF_MAX_CONSUMERS];
+  LatencyHistogram  mBitClocks;
+  LatencyHistogram  mRSSIReads;
+  LatencyHistogram  mByteAdds;
+  LatencyHistogram  mTXEncodes;
+  LatencyHistogram  mRXDecodes;
+  LatencyHistogram  mRXNMEA;
+  EventConsumer     *mConsumers[PERF_MAX_CONSUMERS];
+  uint8_t           mConsumerCount;
+  uint32_t          mUntracked;
+  uint32_t          mCyclesPerUs;
+  int16_t           mReportCursor;
+};
+
+#define PERF_STAMP_ALLOC(e)             (e)->allocCycles = PerfTrace::now()
+#define PERF_STAMP_PUSH(e)              (e)->pushCycles = PerfTrace::now()
+#define PERF_STAMP_DISPATCH(e)          (e)->dispatchCycles = PerfTrace::now()
+#define PERF_CONSUMER_ENTER()           uint32_t __perfEnter = PerfTrace::now()
+#define PERF_CONSUMER_EXIT(c)           PerfTrace::instance().consumerDone(c, __perfEnter)
+#define PERF_EVENT_DONE(e)              PerfTrace::instance().eventDone(*(e))
+#define PERF_BITCLOCK_ENTER()           uint32_t __perfBitClock = PerfTrace::now()
+#define PERF_BITCLOCK_EXIT()            PerfTrace::instance().bitClock(PerfTrace::now() - __perfBitClock)
+#define PERF_RSSI_ENTER()               uint32_t __perfRSSI = PerfTrace::now()
+#define PERF_RSSI_EXIT()                PerfTrace::instance().rssiRead(PerfTrace::now() - __perfRSSI)
+#define PERF_ADDBYTE_ENTER()            uint32_t __perfAddByte = PerfTrace::now()
+#define PERF_ADDBYTE_EXIT()             PerfTrace::instance().byteAdd(PerfTrace::now() - __perfAddByte)
+#define PERF_ENCODE_ENTER()             uint32_t __perfEncode = PerfTrace::now()
+#define PERF_ENCODE_EXIT()              PerfTrace::instance().txEncode(PerfTrace::now() - __perfEncode)
+#define PERF_DECODE_ENTER()             uint32_t __perfDecode = PerfTrace::now()
+#define PERF_DECODE_EXIT()              PerfTrace::instance().rxDecode(PerfTrace::now() - __perfDecode)
+#define PERF_NMEA_ENTER()               uint32_t __perfNMEA = PerfTrace::now()
+#define PERF_NMEA_EXIT()                PerfTrace::instance().rxNMEA(PerfTrace::now() - __perfNMEA)
+
+#else
+
+#define PERF_STAMP_ALLOC(e)
+#define PERF_STAMP_PUSH(e)
+#define PERF_STAMP_DISPATCH(e)
+#define PERF_CONSUMER_ENTER()
+#define PERF_CONSUMER_EXIT(c)
+#define PERF_EVENT_DONE(e)
+#define PERF_BITCLOCK_ENTER()
+#define PERF_BITCLOCK_EXIT()
+#define PERF_RSSI_ENTER()
+#define PERF_RSSI_EXIT()
+#define PERF_ADDBYTE_ENTER()
+#define PERF_ADDBYTE_EXIT()
+#define PERF_ENCODE_ENTER()
+#define PERF_ENCODE_EXIT()
+#define PERF_DECODE_ENTER()
+#define PERF_DECODE_EXIT()
+#define PERF_NMEA_ENTER()
+#define PERF_NMEA_EXIT()
+
+#endif
+
+#endif /* PERFTRACE_HPP_ */
@@ -23,6 +23,9 @@
 
 #include <inttypes.h>
 #include <stm32l4xx_hal.h>
+#include "config.h"
+
+class TXPacket;
 
 
 typedef enum
@@ -51,20 +54,29 @@ public:
   bool isResponsive();
 
   void setXOTrimValue(uint8_t value);
+
+  // Bring-up steps, so RadioManager can reset and configure both ICs concurrently
+  void holdInReset();
+  void releaseReset();
+  bool checkPOR();
+  bool isReady();
+  void startConfiguration();
+  bool continueConfiguration();
+  bool poweredUp();
 protected:
   virtual void configure();
   bool sendCmd(uint8_t cmd, void* params, uint8_t paramLen, void* result, uint8_t resultLen);
   bool sendCmdNoWait(uint8_t cmd, void* params, uint8_t paramLen);
-  bool isInitialized();
-  bool powerOnReset();
   bool isReceiving();
   uint8_t readRSSI();
   bool checkStatus();
   virtual void configureGPIOsForRX() = 0;
+#if TX_FIFO_MODE
+  void loadTXFIFO(TXPacket *p);
+  void startFIFOTX(TXPacket *p);
+#endif
 private:
-  bool readSPIResponse(void *data, uint8_t len);
-  inline void spiOn();
-  inline void spiOff();
+  void configureFastRSSI();
 protected:
   GPIO_TypeDef        *mSDNP;            // The MCU GPIO assigned to SDN for this IC (GPIOA, GPIOB or GPIOC)
   GPIO_TypeDef        *mCSPort;          // The MCU GPIO assigned to CS for this IC
@@ -77,9 +89,14 @@ protected:
   uint8_t             mLastNRZIBit;
   BitState            mBitState;
   uint32_t            mChipID;
-  bool                mCTSPending = false;
   uint16_t            mPartNumber;
   bool                mPORSuccess = false;
+  const uint8_t       *mConfigCursor = nullptr;   // Next line of the configuration, while it is being sent
+  const uint8_t       *mConfigDelta = nullptr;    // The chip specific properties, sent after RADIO_CONFIG_BASE
+  uint8_t             mConfigPart = 0;
+  uint8_t             mLastCommand = 0;
+  bool                mPoweredUp = false;
+  bool                mConfigStreamed = false;    // Sent by continueConfiguration(), so the next configure() skips it
 };
 
 #endif /* RFIC_HPP_ */
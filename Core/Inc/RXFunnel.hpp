@@ -0,0 +1,95 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file RXFunnel.hpp
+ * @brief Per-channel receive funnel counters and a map of the last 2250 time slots.
+ * @details Every stage a received frame goes through (or gets lost at) is counted per channel designation,
+ *          from the preamble detection down to the CRC check. Separately, each slot of the last minute on
+ *          channels A and B is marked with 2 bits: a good frame started in it and/or a failed one did.
+ *
+ *          Counting is a single increment and marking is a single atomic OR, so both are cheap enough for
+ *          the decoder and the SOTDMA timer interrupt. "rxfunnel?" reports the counters as $PAIRXF sentences
+ *          and "rxmap?" dumps the slot map as $PAIRXM sentences, a few per second.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef RXFUNNEL_HPP_
+#define RXFUNNEL_HPP_
+
+#include <stdint.h>
+#include "Events.hpp"
+#include "AISChannels.h"
+
+#define RX_FUNNEL_SLOTS                 2250
+
+// Channels A, B and anything else
+#define RX_FUNNEL_CHANNELS              3
+
+// Channels A and B only
+#define RX_FUNNEL_MAP_CHANNELS          2
+
+typedef enum
+{
+  RX_FUNNEL_PREAMBLE,           // Training sequence and start flag found
+  RX_FUNNEL_STUFFING_ABORT,     // 7 consecutive ones inside a frame
+  RX_FUNNEL_OVERSIZE_ABORT,     // No end flag within MAX_AIS_RX_PACKET_SIZE bits
+  RX_FUNNEL_RUNT,               // Ended with fewer than 32 bits
+  RX_FUNNEL_CRC_FAIL,
+  RX_FUNNEL_CRC_PASS,
+  RX_FUNNEL_POOL_DROP,          // Complete, but there was no event or queue space for it
+  RX_FUNNEL_STAGE_COUNT
+} RXFunnelStage;
+
+class RXFunnel : public EventConsumer
+{
+public:
+  static RXFunnel &instance();
+
+  void init();
+
+  // Each stage is only ever counted from one context (decoder or main loop)
+  void count(VHFChannel channel, RXFunnelStage stage);
+
+  // Marks the slot in which a frame started. Safe from any context.
+  void markSlot(VHFChannel channel, uint32_t slot, bool good);
+
+  // Forgets the previous minute's marks as the slot begins (SOTDMA timer interrupt)
+  void clearSlot(VHFChannel channel, uint32_t slot);
+
+  void reportStats();
+
+  // The map is paced over a few clock ticks, so it does not exhaust the event pool
+  void reportMap();
+
+  void processEvent(const Event &e);
+private:
+  RXFunnel();
+  void reportNextMapChunk();
+
+private:
+  uint32_t  mCounters[RX_FUNNEL_CHANNELS][RX_FUNNEL_STAGE_COUNT];
+  uint8_t   mSlotMap[RX_FUNNEL_MAP_CHANNELS][(RX_FUNNEL_SLOTS * 2 + 7) / 8];
+  int16_t   mMapCursor;
+};
+
+#endif /* RXFUNNEL_HPP_ */
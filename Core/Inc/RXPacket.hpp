@@ -51,11 +51,27 @@ public:
   void addByte(uint8_t byte);
 
   uint16_t size() const;
+
+  // Message bits, without the CRC if it has not been discarded yet
+  uint16_t payloadSize() const;
   uint8_t bit(uint16_t pos) const;
   uint32_t bits(uint16_t pos, uint8_t count) const;
 
   uint16_t crc() const;
   bool checkCRC() const;
+
+#if RX_CRC_CORRECTION
+  typedef enum
+  {
+    CRC_UNCORRECTABLE,
+    CRC_CORRECTED_1_BIT,
+    CRC_CORRECTED_2_BITS,
+    CRC_OVER_BUDGET
+  } CRCCorrection;
+
+  // Tries to fix a packet that failed the CRC, within a budget of syndrome table comparisons
+  CRCCorrection correctCRC(uint16_t budget);
+#endif
   bool isBad() const;
   void reset();
 
@@ -68,21 +84,35 @@ public:
   uint32_t slot() const;
   uint8_t rssi() const;
   void setRSSI(uint8_t);
+
+  // Number of training sequence bits that were wrong when the packet was detected
+  uint8_t syncErrors() const;
+  void setSyncErrors(uint8_t errors);
+
+  // Set when the packet was detected inside another one, i.e. it collided with an earlier (weaker) frame
+  bool collision() const;
+  void setCollision(bool collision);
 private:
   void addBit(uint8_t bit);
-  void addBitCRC(uint8_t bit);
+#if RX_CRC_CORRECTION
+  void flipReceivedBit(uint16_t index);
+  bool refreshCRC();
+#endif
 private:
   struct
   {
-    uint8_t mPacket[MAX_AIS_RX_PACKET_SIZE/8+1];
+    uint8_t mPacket[MAX_AIS_RX_PACKET_SIZE/8+4];    // Slack for a word load at the last byte
     uint16_t mSize;
     uint16_t mCRC;
+    bool mCRCDiscarded;
     mutable uint8_t mType;
     mutable uint8_t mRI;
     mutable uint32_t mMMSI;
     uint32_t mSlot;
     VHFChannel mChannel;
     uint8_t mRSSI;
+    uint8_t mSyncErrors;
+    bool mCollision;
   }
   mState;
 };
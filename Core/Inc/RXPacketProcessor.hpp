@@ -29,13 +29,20 @@
 class RXPacketProcessor : public EventConsumer
 {
 public:
-  RXPacketProcessor ();
-  virtual ~RXPacketProcessor ();
+  static RXPacketProcessor &instance();
 
+  void init();
   void processEvent(const Event &e);
 
+  // Emits a $PAIRXS sentence with the packet counters
+  void reportStats();
+
 private:
+  RXPacketProcessor ();
+  virtual ~RXPacketProcessor ();
+
   void ensureChannelIsTracked(VHFChannel ch);
+  bool validate(RXPacket &packet);
 
 private:
   class PacketStats
@@ -46,12 +53,27 @@ private:
       good = 0;
       bad = 0;
       invalid = 0;
+      corrected1 = 0;
+      corrected2 = 0;
+      overBudget = 0;
+      tolerantGood = 0;
+      tolerantBad = 0;
+      collisions = 0;
+      captured = 0;
     }
     uint32_t good;
-    uint32_t bad;
+    uint32_t bad;           // Failed the CRC and could not be corrected
     uint32_t invalid;
+    uint32_t corrected1;    // Recovered by flipping 1 bit
+    uint32_t corrected2;    // Recovered by flipping 2 bits
+    uint32_t overBudget;    // Correction was not attempted (or not completed) due to the CPU budget
+    uint32_t tolerantGood;  // Detected with training sequence errors and passed the CRC
+    uint32_t tolerantBad;   // Detected with training sequence errors and failed the CRC
+    uint32_t collisions;    // Detected inside an earlier frame
+    uint32_t captured;      // Detected inside an earlier frame and passed the CRC
   };
 
+  PacketStats mStats;
   NMEAEncoder mEncoder;
   std::vector<std::string> mSentences;
   StationData mStationData;
@@ -0,0 +1,232 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file RadioConfigDelta.hpp
+ * @brief Compile time checks and delta encoding of the WDS generated RF IC configuration arrays.
+ * @details A configuration array is a sequence of lines [length][command][parameters...], terminated by 0.
+ *          radioConfigValid() checks that framing at compile time: every line fits in a single SPI command
+ *          and every SET_PROPERTY line agrees with its own property count.
+ *
+ *          The chips' arrays mostly set the same properties to the same values, so they are stored as deltas against
+ *          RADIO_CONFIG_BASE (radio_config_base.h). A delta holds the chip's commands up to and including its last
+ *          non-property command (patch, POWER_UP, GPIO_PIN_CFG etc.) verbatim, then a 0, then only the properties
+ *          that follow and aren't in the base with the same value, then another 0. The chip is configured with the
+ *          first part, the base and the second part, in that order, which leaves it in the same state as the
+ *          original array did. radioConfigHasBase() guarantees the base doesn't set anything the original didn't.
+ *
+ *          All of this is evaluated by the compiler, so only the deltas and the base end up in flash.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef RADIOCONFIGDELTA_HPP_
+#define RADIOCONFIGDELTA_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "EZRadioPRO.h"
+#include "radio_config_base.h"
+
+// Longest line, including the command. The SPI engine sends up to 16 bytes per command.
+#define RADIO_CONFIG_MAX_LINE          16
+
+// A SET_PROPERTY command can set up to 12 consecutive properties of a group
+#define RADIO_CONFIG_MAX_PROPERTIES    12
+
+static constexpr uint8_t RADIO_CONFIG_BASE[] = RADIO_CONFIG_BASE_ARRAY;
+
+template<size_t N>
+constexpr bool radioConfigValid(const uint8_t (&cfg)[N])
+{
+  size_t i = 0;
+  while ( i < N && cfg[i] )
+    {
+      uint8_t count = cfg[i];
+      if ( count > RADIO_CONFIG_MAX_LINE || i + count >= N )
+        return false;
+
+      if ( cfg[i+1] == SET_PROPERTY &&
+           (count < 5 || cfg[i+3] != count - 4 || cfg[i+3] > RADIO_CONFIG_MAX_PROPERTIES) )
+        return false;
+
+      i += count + 1;
+    }
+
+  // The terminating 0 must be the last byte
+  return i == N - 1;
+}
+
+// Offset of the first line after the last non-property command
+constexpr size_t radioConfigTail(const uint8_t *cfg)
+{
+  size_t tail = 0;
+  for ( size_t i = 0; cfg[i]; i += cfg[i] + 1 )
+    {
+      if ( cfg[i+1] != SET_PROPERTY )
+        tail = i + cfg[i] + 1;
+    }
+
+  return tail;
+}
+
+// Offset of the second part of a delta
+constexpr size_t radioConfigDeltaProperties(const uint8_t *delta)
+{
+  size_t i = 0;
+  while ( delta[i] )
+    i += delta[i] + 1;
+
+  return i + 1;
+}
+
+// The last value a property is set to from the line at offset 'from' onwards, or -1 if it isn't
+constexpr int16_t radioConfigProperty(const uint8_t *cfg, size_t from, uint8_t group, uint8_t property)
+{
+  int16_t value = -1;
+  for ( size_t i = from; cfg[i]; i += cfg[i] + 1 )
+    {
+      const uint8_t *line = cfg + i + 1;
+      if ( line[0] == SET_PROPERTY && line[1] == group && property >= line[3] && property < line[3] + line[2] )
+        value = line[4 + property - line[3]];
+    }
+
+  return value;
+}
+
+// True if the base only sets properties that the tail of the array sets to the same value
+constexpr bool radioConfigHasBase(const uint8_t *cfg)
+{
+  size_t tail = radioConfigTail(cfg);
+  for ( size_t i = 0; RADIO_CONFIG_BASE[i]; i += RADIO_CONFIG_BASE[i] + 1 )
+    {
+      const uint8_t *line = RADIO_CONFIG_BASE + i + 1;
+      for ( uint8_t p = 0; p < line[2]; ++p )
+        {
+          if ( radioConfigProperty(cfg, tail, line[1], line[3] + p) != line[4 + p] )
+            return false;
+        }
+    }
+
+  return true;
+}
+
+struct RadioConfigSize
+{
+  size_t size = 0;
+
+  constexpr void put(uint8_t)
+  {
+    ++size;
+  }
+};
+
+template<size_t N>
+struct RadioConfigBlob
+{
+  uint8_t bytes[N] = {};
+  size_t size = 0;
+
+  constexpr void put(uint8_t b)
+  {
+    bytes[size++] = b;
+  }
+};
+
+template<typename Sink>
+constexpr void radioConfigPutProperties(Sink &sink, uint8_t group, uint8_t start, uint8_t count, const uint8_t *values)
+{
+  sink.put(count + 4);
+  sink.put(SET_PROPERTY);
+  sink.put(group);
+  sink.put(count);
+  sink.put(start);
+  for ( uint8_t i = 0; i < count; ++i )
+    sink.put(values[i]);
+}
+
+template<typename Sink>
+constexpr void radioConfigEncodeDelta(const uint8_t *cfg, Sink &sink)
+{
+  size_t tail = radioConfigTail(cfg);
+  for ( size_t i = 0; i < tail; ++i )
+    sink.put(cfg[i]);
+  sink.put(0);
+
+  // Properties that remain are packed into runs of consecutive ones, in their original order
+  uint8_t group = 0, start = 0, count = 0;
+  uint8_t values[RADIO_CONFIG_MAX_PROPERTIES] = {};
+
+  for ( size_t i = tail; cfg[i]; i += cfg[i] + 1 )
+    {
+      const uint8_t *line = cfg + i + 1;
+      size_t next = i + cfg[i] + 1;
+      for ( uint8_t p = 0; p < line[2]; ++p )
+        {
+          uint8_t property = line[3] + p;
+          uint8_t value = line[4 + p];
+
+          // Only the last setting counts, and the base may already take care of it
+          if ( radioConfigProperty(cfg, next, line[1], property) >= 0 ||
+               radioConfigProperty(RADIO_CONFIG_BASE, 0, line[1], property) == value )
+            continue;
+
+          if ( count && (line[1] != group || property != start + count || count == RADIO_CONFIG_MAX_PROPERTIES) )
+            {
+              radioConfigPutProperties(sink, group, start, count, values);
+              count = 0;
+            }
+
+          if ( count == 0 )
+            {
+              group = line[1];
+              start = property;
+            }
+
+          values[count++] = value;
+        }
+    }
+
+  if ( count )
+    radioConfigPutProperties(sink, group, start, count, values);
+
+  sink.put(0);
+}
+
+static_assert(radioConfigValid(RADIO_CONFIG_BASE) && radioConfigTail(RADIO_CONFIG_BASE) == 0,
+    "RADIO_CONFIG_BASE must only have SET_PROPERTY lines");
+
+constexpr size_t radioConfigDeltaSize(const uint8_t *cfg)
+{
+  RadioConfigSize s;
+  radioConfigEncodeDelta(cfg, s);
+  return s.size;
+}
+
+template<size_t N>
+constexpr RadioConfigBlob<N> radioConfigDelta(const uint8_t *cfg)
+{
+  RadioConfigBlob<N> blob;
+  radioConfigEncodeDelta(cfg, blob);
+  return blob;
+}
+
+#endif /* RADIOCONFIGDELTA_HPP_ */
@@ -25,7 +25,7 @@
 #include "Transceiver.hpp"
 #include "GPS.hpp"
 #include "TXPacket.hpp"
-#include "CircularQueue.hpp"
+#include "LockFreeQueue.hpp"
 #include "EventQueue.hpp"
 #include "AISChannels.h"
 
@@ -39,6 +39,10 @@ public:
   void start();
   void stop();
   void onBitClock(uint8_t ic);
+  void decodeCapturedBits();
+  void onRXSamples(const uint8_t *samples, uint16_t count);
+  void onSlotBit();
+  void onTXTimer();
   void timeSlotStarted(uint32_t slotNumber);
 
   void scheduleTransmission(TXPacket *p);
@@ -54,7 +58,18 @@ public:
 
   void setXOTrimValue(uint8_t value);
 
+  void reportBootTiming();
 private:
+  typedef enum
+  {
+    BOOT_RESET,       // SDN pulse until both chips signal POR completion
+    BOOT_PATCH,       // Until both chips have processed POWER_UP (and the patch before it)
+    BOOT_CONFIG,      // The rest of the configuration arrays
+    BOOT_FIRST_RX,    // START_RX on both chips until both are ready
+    BOOT_TOTAL,
+    BOOT_PHASE_COUNT
+  } BootPhase;
+
   RadioManager();
   void spiOff();
   void configureInterrupts();
@@ -65,8 +80,10 @@ private:
   bool mInitializing;
   time_t mUTC = 0;
   time_t mStartTime = 0;
+  uint32_t mBootStart;
+  uint32_t mBootCycles[BOOT_PHASE_COUNT];
 
-  CircularQueue<TXPacket*>  mTXQueue;
+  SPSCQueue<TXPacket*, MAX_TX_PACKETS_IN_QUEUE>  mTXQueue;
 };
 
 #endif /* RADIOMANAGER_HPP_ */
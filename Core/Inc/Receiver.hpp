@@ -25,10 +25,18 @@
 #include "RadioState.hpp"
 #include "RFIC.hpp"
 #include "AISChannels.h"
+#include "HDLCDecoder.hpp"
+#include "LockFreeQueue.hpp"
 
+// 8 data levels captured by the bit clock interrupt, tagged with their position in time
+typedef struct {
+  uint32_t slot;            // 0xffffffff if unknown
+  uint8_t slotBit;          // Slot bit number of the last level, saturated at 255
+  uint8_t generation;       // Bumped on every RX restart, so stale levels are never decoded as part of a new frame
+  uint8_t levels;           // MSB first
+} CapturedBits;
 
-
-class Receiver : public RFIC
+class Receiver : public RFIC, public HDLCDecoderListener
 {
 public:
   Receiver(GPIO_TypeDef *sdnPort,
@@ -49,29 +57,42 @@ public:
   virtual void onBitClock();
   virtual void timeSlotStarted(uint32_t slot);
   void switchToChannel(VHFChannel channel);
-protected:
-  typedef enum
-  {
-    NO_ACTION,
-    RESTART_RX,
-    RETRIEVE_RSSI
-  } Action;
 
+  // Runs at a lower priority than the bit clock, see bsp_trigger_rx_decoder()
+  void decodeCapturedBits();
+
+  // Alternatives to onBitClock() when the data pin is sampled by DMA (RX_DMA_SAMPLING)
+  void captureSamples(const uint8_t *samples, uint16_t count);
+  void sampleSlotRSSI();
+
+  void onFrameStart(uint8_t bitsLeft);
+  void onFrameEnd(uint8_t bitsLeft, bool resync);
+  void onFrameAbort(FrameAbortReason reason);
+protected:
   void startListening(VHFChannel channel, bool reconfigGPIOs);
-  bool addBit(uint8_t bit);
+  void captureBit(uint8_t level);
   void resetBitScanner();
-  uint8_t reportRSSI();
+  void sampleCCA();
+  void reportRSSI(uint8_t rssi);
   void pushPacket();
-  Action processNRZIBit(uint8_t level);
   virtual void configureGPIOsForRX();
 protected:
+  // Owned by the decoder
   RXPacket *mRXPacket = nullptr;
-  uint16_t mBitWindow;
-  uint8_t mLastNRZIBit;
-  uint32_t mBitCount;
-  uint32_t mOneBitCount;
-  BitState mBitState;
-  uint8_t mRXByte;
+  HDLCDecoder mDecoder;
+  uint8_t mDecodeGeneration;
+  VHFChannel mDecodeChannel;
+  CapturedBits mDecodeBits;
+
+  // Owned by the bit clock interrupt
+  SPSCQueue<CapturedBits, 32> mCapture;
+  uint8_t mCaptureLevels;
+  uint8_t mCaptureCount;
+  volatile uint8_t mGeneration;
+  volatile uint8_t mSlotRSSI;         // Sampled at CCA_SLOT_BIT
+  volatile uint8_t mCCARSSI;          // The loudest of the CCA samples in this slot
+
+  volatile bool mSwitchRequested;
   VHFChannel mChannel;
   int mSlotBitNumber;
   VHFChannel mNextChannel;
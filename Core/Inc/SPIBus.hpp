@@ -0,0 +1,142 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file SPIBus.hpp
+ * @brief Queued DMA transactions with the RF ICs on the shared SPI bus.
+ * @details Any context can submit a transaction for either chip: a command with its parameters, optionally
+ *          followed by waiting for CTS and reading the response, or by clocking the response out right away
+ *          (fast response registers, FIFOs). Transactions run one at a time in submission order, each one
+ *          with its own chip select, so nothing can interleave with a command in progress.
+ *
+ *          The engine only runs at the highest interrupt priority: DMA completion drives it from one transfer
+ *          to the next (CTS is polled back to back, up to SPI_MAX_CTS_POLLS times) and a software interrupt starts it when it's idle.
+ *          That makes it safe to wait for a transaction from the main loop and from any other interrupt.
+ *          Completion callbacks run at that priority too, so they must be short.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef SPIBUS_HPP_
+#define SPIBUS_HPP_
+
+#include <stdint.h>
+#include <stm32l4xx_hal.h>
+#include "LockFreeQueue.hpp"
+
+// Command byte plus parameters
+#define SPI_MAX_COMMAND             16
+
+#define SPI_MAX_RESPONSE            16
+
+#define SPI_QUEUE_SIZE              8
+
+// Chips that can have a command outstanding at the same time (see post())
+#define SPI_MAX_DEVICES             2
+
+// A CTS poll takes about 2.5us with SPI1 at 10 MHz, so a chip that hasn't reported CTS after about 5ms
+// fails the transaction instead of keeping the bus (and the highest interrupt priority) forever
+#define SPI_MAX_CTS_POLLS           2000
+
+typedef void(*spi_callback)(void *context);
+
+typedef struct
+{
+  GPIO_TypeDef    *csPort;
+  uint16_t        csPin;
+  uint8_t         txLen;
+  uint8_t         resultLen;
+  uint8_t         tx[SPI_MAX_COMMAND];
+  uint8_t         *result;
+  bool            waitCTS;
+  bool            deferCTS;     // The next command to this chip waits for CTS instead
+  volatile bool   *done;
+  volatile bool   *ok;          // False if the chip never reported CTS
+  spi_callback    callback;
+  void            *context;
+} SPITransaction;
+
+class SPIBus
+{
+public:
+  static SPIBus &instance();
+
+  /*
+   * Queues a transaction and returns right away. With waitCTS, the response is read with READ_CMD_BUFFER
+   * once the chip is ready, and later transactions wait for that as well. Without it, the response bytes
+   * follow the command directly. The result buffer must stay valid until the callback (if any) fires.
+   */
+  void submit(GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params, uint8_t paramLen,
+      void *result, uint8_t resultLen, bool waitCTS, spi_callback callback = nullptr, void *context = nullptr);
+
+  /*
+   * Same as submit(), but returns when the transaction is complete. Never call this at the highest priority.
+   * Returns false if the chip never reported CTS, in which case there is no response.
+   */
+  bool execute(GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params, uint8_t paramLen,
+      void *result, uint8_t resultLen, bool waitCTS);
+
+  /*
+   * Queues a command that completes as soon as it has been clocked out. The bus doesn't wait for the chip to
+   * process it: the next transaction to this chip that waits for CTS polls for it before its own command.
+   * Fast response registers and FIFOs don't need CTS, so they can still be accessed in the meantime.
+   */
+  void post(GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params, uint8_t paramLen);
+
+  // Both run at the highest interrupt priority
+  void onTransferComplete();
+  void onTrigger();
+private:
+  typedef enum
+  {
+    IDLE,
+    PRE_CTS_POLL,
+    COMMAND,
+    CTS_POLL,
+    RESPONSE
+  } Phase;
+
+  SPIBus();
+  void prepare(SPITransaction &t, GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params,
+      uint8_t paramLen, void *result, uint8_t resultLen, bool waitCTS);
+  void enqueue(const SPITransaction &t);
+  void startNext();
+  void sendCommand();
+  void pollCTS(Phase phase);
+  bool takeCTSPending();
+  void setCTSPending();
+  void readResponse();
+  void finish(bool ok);
+
+private:
+  MPMCQueue<SPITransaction, SPI_QUEUE_SIZE> mQueue;
+  SPITransaction mCurrent;
+  Phase mPhase;
+  uint16_t mCTSPolls;
+  uint8_t mScratch[SPI_MAX_COMMAND];
+  struct
+  {
+    GPIO_TypeDef  *csPort;
+    uint16_t      csPin;
+  } mCTSPending[SPI_MAX_DEVICES];     // Chips that haven't reported CTS after a post(), only touched by the engine
+};
+
+#endif /* SPIBUS_HPP_ */
@@ -0,0 +1,88 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file SlotMap.hpp
+ * @brief Occupancy of the 2250 slots of the VHF data link on channels A and B over the last few frames.
+ * @details Two bitsets are kept per channel and frame: slots that carried a frame with a good CRC and slots
+ *          whose RSSI at CCA_SLOT_BIT was more than TX_CCA_HEADROOM above the noise floor. The last
+ *          SLOT_MAP_FRAMES frames are kept in a ring, and a slot's bits for the current frame are cleared as the
+ *          slot begins, so every slot always reflects its last SLOT_MAP_FRAMES occurrences.
+ *
+ *          A slot is free when none of those occurrences was marked. The transceiver uses findFreeSlot()
+ *          to pick the slot it transmits in.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef SLOTMAP_HPP_
+#define SLOTMAP_HPP_
+
+#include <stdint.h>
+#include "config.h"
+#include "AISChannels.h"
+
+#define SLOT_MAP_SLOTS                  2250
+#define SLOT_MAP_WORDS                  ((SLOT_MAP_SLOTS + 31) / 32)
+
+// Channels A and B
+#define SLOT_MAP_CHANNELS               2
+
+class SlotMap
+{
+public:
+  static SlotMap &instance();
+
+  // Called once at the start of every slot from the SOTDMA timer interrupt
+  void slotStarted(uint32_t slot);
+
+  // A frame of the given size (in bits, including the CRC) with a good CRC started in the slot
+  void markDecoded(VHFChannel channel, uint32_t slot, uint16_t bits);
+
+  // The RSSI sampled at CCA_SLOT_BIT of the slot. Safe from any context.
+  void markEnergy(VHFChannel channel, uint32_t slot, uint8_t rssi);
+
+  bool isFree(VHFChannel channel, uint32_t slot) const;
+
+  /*
+   * Returns the free slot closest to near, no more than before slots earlier or after slots later (wrapping
+   * around the frame). On a tie, the later slot wins. Returns -1 if there is no such slot.
+   */
+  int16_t findFreeSlot(VHFChannel channel, uint32_t near, uint16_t before, uint16_t after) const;
+
+  // The slot in progress, or 0xffffffff before the SOTDMA timer has started
+  inline uint32_t currentSlot() const
+  {
+    return mSlot;
+  }
+
+private:
+  SlotMap();
+  void mark(uint32_t (*bitset)[SLOT_MAP_CHANNELS][SLOT_MAP_WORDS], VHFChannel channel, uint32_t slot);
+
+private:
+  uint32_t mDecoded[SLOT_MAP_FRAMES][SLOT_MAP_CHANNELS][SLOT_MAP_WORDS];
+  uint32_t mEnergy[SLOT_MAP_FRAMES][SLOT_MAP_CHANNELS][SLOT_MAP_WORDS];
+  volatile uint32_t mSlot;
+  volatile uint8_t mFrame;
+};
+
+#endif /* SLOTMAP_HPP_ */
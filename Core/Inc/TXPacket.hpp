@@ -32,6 +32,12 @@ public:
   ~TXPacket();
 
   void addBit(uint8_t bit);
+
+  // Appends the count least significant bits, LSB first
+  void addBits(uint32_t bits, uint8_t count);
+
+  // Copies the encoded bits and message type of another packet. The channel and target slot stay as they are.
+  void copyFrame(const TXPacket &source);
   void pad();
   uint16_t size();
 
@@ -43,6 +49,10 @@ public:
   void setTimestamp(time_t t);
   time_t timestamp();
 
+  // The slot to transmit in, or -1 for the first slot with a clear channel
+  void setTargetSlot(int16_t slot);
+  int16_t targetSlot();
+
   void setMessageType(const char*);
   const char *messageType();
 
@@ -52,12 +62,20 @@ public:
   void configureForTesting(VHFChannel channel, uint16_t numBits);
   bool canRampDown();
   bool isTestPacket();
+
+  // The whole frame, for the RF IC's TX FIFO. The first bit on air is the LSB of the first byte.
+  const uint8_t *data();
+  uint8_t dataSize();
+
+  // The bit during which canRampDown() becomes true
+  uint16_t rampDownBit();
 private:
   uint8_t mPacket[MAX_AIS_TX_PACKET_SIZE/8+1];
   uint16_t mSize;
   uint16_t mPosition;
   VHFChannel mChannel;
   time_t mTimestamp;
+  volatile int16_t mTargetSlot;
   char mMessageType[4];
   bool mTestPacket = false;
 };
@@ -71,8 +89,9 @@ public:
 
   TXPacket *newTXPacket(VHFChannel channel);
   void deleteTXPacket(TXPacket*);
+  void reportStats();
 private:
-  ObjectPool<TXPacket> *mPool;
+  ObjectPool<TXPacket, 4> mPool;
 };
 
 
@@ -15,6 +15,8 @@
 #include "Configuration.hpp"
 #include "AODV_mesh.hpp"
 #include "arbitrary_tx.hpp"
+#include "TXPacket.hpp"
+#include "HDLCEncoder.hpp"
 
 
 
@@ -34,11 +36,15 @@ public:
 
   void reportTXStatus();
   bool isTXAllowed();
+
+  // Picks up new station data and drops the frames encoded from the old one
+  void reloadStationData();
 private:
   TXScheduler ();
   virtual ~TXScheduler ();
   time_t positionReportTimeInterval();
   void sendNMEASentence(const char *sentence);
+  void encodeStaticFrames();
 private:
   VHFChannel mPositionReportChannel;
   VHFChannel mStaticDataChannel;
@@ -49,6 +55,13 @@ private:
   StationData mStationData = {0};
   AODV_rreq_t AODVRREQrequest = {0};
   GPSFix mLastGPSFix;
+
+  // Frames that only depend on mStationData. 24A and 24B are complete, 18 is a template up to the SOG field.
+  bool mStaticFramesValid = false;
+  TXPacket mMsg24AFrame;
+  TXPacket mMsg24BFrame;
+  TXPacket mMsg18Frame;
+  HDLCEncoder mMsg18Prefix;
 };
 
 #endif /* TXSCHEDULER_HPP_ */
@@ -41,6 +41,7 @@ public:
 
 
   void onBitClock();
+  void onTXTimer();
   void timeSlotStarted(uint32_t slot);
   void assignTXPacket(TXPacket *p);
   TXPacket *assignedTXPacket();
@@ -53,13 +54,21 @@ protected:
   virtual void configureGPIOsForRX();
 private:
   void startTransmitting();
+  void finishTransmitting();
+#if TX_FIFO_MODE
+  void onFIFOTXEvent();
+#endif
   void configureGPIOsForTX();
   void setTXPower(const pa_params &params);
   void reportTXEvent();
+  void targetFreeSlot(TXPacket *p);
 private:
   TXPacket    *mTXPacket;
   time_t      mUTC;
   time_t      mLastTXTime;
+#if TX_FIFO_MODE
+  volatile bool mTXEnding;    // The clock pin reports RX_STATE now, so its next rising edge ends the transmission
+#endif
   //map<VHFChannel, uint8_t> mNoiseFloorCache;
 };
 
@@ -39,14 +39,22 @@ public:
   static uint16_t crc16(uint8_t* data, uint16_t len);
   static uint16_t reverseBits(uint16_t data);
 
+  // Reflected CRC-16 (X.25) lookup table for byte at a time updates
+  static const uint16_t CRC16_X25_TABLE[256];
+
   // NMEA-specific
   static float latitudeFromNMEA(const string &decimal, const string &hemisphere);
   static float longitudeFromNMEA(const string &decimal, const string &hemisphere);
   static uint32_t coordinateToUINT32(double value);
   static float coordinateFromUINT32(uint32_t aisCoordinate, uint8_t numBits);
 
+  // Characters of the 6-bit payload armoring used by !AIVDM sentences, indexed by value
+  static const char SIX_BIT_ARMOR[65];
+
   // ARM-specific utilities
   static bool inISR();
+  static uint32_t disableInterrupts();            // Returns the previous mask for restoreInterrupts()
+  static void restoreInterrupts(uint32_t mask);
   static void completeNMEA(char *buff);
 
 };
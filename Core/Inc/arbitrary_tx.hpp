@@ -18,12 +18,7 @@
 #include "StationData.h"
 #include "EventTypes.h"
 #include "Events.hpp"
-#include"TXScheduler.hpp"
-
-
-// Constants
-
-#define MAX_AODV_TX_PACKET_SIZE 256 //definition of max packet size
+#include "AODV_mesh.hpp"
 
 
 // AODV Route Table Entry
@@ -33,7 +28,13 @@
 typedef struct
 {
     char msg;               // AODV message type (AODV_REQUEST)
-                 // Source longitude
+    uint8_t reserved;
+    uint8_t hop_count;          // Number of hops from the source
+    uint8_t req_id;            // Request ID
+    uint32_t source_mmsi;         // Source MMSI
+    uint32_t dest_mmsi;           // Destination MMSI
+    float latitude;            // Source latitude
+    float longitude;           // Source longitude
 } arbitrary_tx_t;
 
 // AODV Acknowledgement (RREP) message format
@@ -84,22 +85,6 @@ public:
   virtual bool decode(const arbitrary_tx_t &packet);
 
   virtual void encode(const arbitrary_tx_t & station, TXPacket & packet);
-
-
-
-protected:
-  void appendCRC(uint8_t *buff, uint16_t &size);
-  void addBits(uint8_t *buff, uint16_t &size, uint32_t value, uint8_t numBits);
-  void putBits(uint8_t *buff, uint32_t value, uint8_t numBits);
-  void addString(uint8_t *buff, uint16_t &size, const std::string &name, uint8_t maxChars);
-  void finalize(uint8_t *buff, uint16_t &size, TXPacket &packet);
-
-private:
-  void bitStuff(uint8_t *buff, uint16_t &size);
-  void constructHDLCFrame(uint8_t *buff, uint16_t &size);
-  void nrziEncode(uint8_t *buff, uint16_t &size, TXPacket &packet);
-  void payloadToBytes(uint8_t *bitVector, uint16_t numBits, uint8_t *bytes);
-  void reverseEachByte(uint8_t *bitVector, uint16_t numBits);
 };
 
 class arbitory : public arb_msg
@@ -41,6 +41,9 @@ void bsp_write_char(const char c);
 void bsp_write_string(const char *s);
 void bsp_set_rx_mode();
 void bsp_set_tx_mode();
+
+// For transmission from the RF IC's FIFO: the PA is biased, but the data pin remains an input
+void bsp_set_fifo_tx_mode();
 void bsp_start_wdt();
 void bsp_refresh_wdt();
 uint32_t bsp_get_system_clock();
@@ -100,9 +103,37 @@ void bsp_stop_sotdma_timer();
 uint32_t bsp_get_sotdma_timer_value();
 void bsp_set_sotdma_timer_value(uint32_t v);
 
+// Non-blocking terminal output. The callback fires (in interrupt context) when a transfer has completed.
+bool bsp_start_terminal_tx(const uint8_t *data, uint16_t len);
+void bsp_set_terminal_tx_callback(irq_callback cb);
+
+// Software interrupt for decoding captured RX bits, below the bit clock priority
+void bsp_set_rx_decoder_callback(irq_callback cb);
+void bsp_trigger_rx_decoder();
+
+// RX sampling by DMA. Each sample is the low byte of the RX data port's input register, latched on a clock edge.
+typedef void(*rx_samples_cb)(const uint8_t *samples, uint16_t count);
+void bsp_set_rx_samples_callback(rx_samples_cb cb);
+void bsp_start_rx_sampling();
+
+// Fires once per SOTDMA slot, when the given bit of the slot is due
+void bsp_set_slot_bit_callback(irq_callback cb, uint8_t bit);
+
 // Encapsulates the SPI bus
 uint8_t bsp_tx_spi_byte(uint8_t b);
 
+// Full duplex DMA transfers on the SPI bus. Both callbacks run at the highest interrupt priority:
+// one when a transfer has completed, the other whenever bsp_trigger_spi() is called.
+bool bsp_start_spi_transfer(const uint8_t *tx, uint8_t *rx, uint16_t len);
+void bsp_set_spi_transfer_callback(irq_callback cb);
+void bsp_set_spi_trigger_callback(irq_callback cb);
+void bsp_trigger_spi();
+
+// One-shot timer for the events of a transmission from the RF IC's FIFO
+void bsp_set_tx_timer_callback(irq_callback cb);
+void bsp_start_tx_timer(uint32_t us);
+void bsp_stop_tx_timer();
+
 
 
 extern const char *BSP_HW_REV;
@@ -51,6 +51,31 @@
 // As a class B transponder, we never transmit anything bigger than 240 bits.
 #define MAX_AIS_TX_PACKET_SIZE       256
 
+// Terminal output is queued in a ring and drained by DMA instead of busy-waiting on the USART.
+// The ring size must be a power of 2. When the ring is full, whole sentences are dropped (and counted).
+#define TERMINAL_DMA_TX                1
+#define TERMINAL_TX_BUFFER_SIZE     1024
+
+// Sample the receiver's data pin by DMA on its clock edges (TIM2 input capture) instead of one interrupt per bit.
+// Blocks of 128 bits are handed to the same decoder as the interrupt path. The transceiver is not affected.
+#ifndef RX_DMA_SAMPLING
+#define RX_DMA_SAMPLING                0
+#endif
+
+// A packet starts with an exact HDLC flag preceded by the last 4 training bits, or by the last RX_PREAMBLE_BITS
+// training bits with up to RX_PREAMBLE_TOLERANCE of them wrong. Set the tolerance to 0 for the exact 4 bit match only.
+#define RX_PREAMBLE_BITS              12
+#define RX_PREAMBLE_TOLERANCE          1
+
+// Try to repair received packets that fail the CRC by flipping 1 bit, or 2 bits no more than RX_CRC_CORRECTION_SPAN apart.
+// The budget caps the number of syndrome table comparisons per packet. Repaired packets are counted by "rxstats?".
+// This weakens the CRC: a few percent of badly corrupted packets get "repaired" into the wrong message, so it is off by default.
+#ifndef RX_CRC_CORRECTION
+#define RX_CRC_CORRECTION              0
+#endif
+#define RX_CRC_CORRECTION_SPAN         4
+#define RX_CRC_CORRECTION_BUDGET    4096
+
 // Maximum allowed backlog in TX queue
 #define MAX_TX_PACKETS_IN_QUEUE        4
 
@@ -81,9 +106,48 @@
 // It takes the Si4463 a few bits' time to switch from RX to TX, so I arbitrarily picked the 12th bit instead.
 #define CCA_SLOT_BIT                  11
 
+// Read the RSSI from fast response register A (one 2 byte SPI transaction) instead of GET_MODEM_STATUS,
+// which polls for CTS and takes 85us or more in the bit clock interrupt.
+// FRR_A is set to report the latched RSSI, with latching turned off. Whether that tracks the current RSSI the way
+// GET_MODEM_STATUS does has not been checked on hardware, so this is off, and so are multiple CCA samples.
+#ifndef FAST_RSSI
+#define FAST_RSSI                      0
+#endif
+
+// Number of RSSI samples for clear channel assessment, CCA_SAMPLE_SPACING bits apart and ending at CCA_SLOT_BIT.
+// The channel is clear only if the loudest of them is. Without FAST_RSSI, there is only time for one.
+#if FAST_RSSI
+#define CCA_SAMPLES                    4
+#else
+#define CCA_SAMPLES                    1
+#endif
+#define CCA_SAMPLE_SPACING             3
+
+// Number of past frames (minutes) the slot map remembers. Each one takes about 1.1KB of RAM.
+#define SLOT_MAP_FRAMES                3
+
+// Transmissions target a slot that has been free in all remembered frames, at least SLOT_MAP_TX_LEAD slots
+// ahead and within SLOT_MAP_TX_RANGE slots after that. If there isn't one, any clear channel slot will do.
+#define SLOT_MAP_TX_LEAD               2
+#define SLOT_MAP_TX_RANGE             75
+
+// Transmit from the transceiver's TX FIFO instead of clocking every bit out in the bit clock interrupt.
+// The frame is loaded as soon as the packet is assigned. During transmission, the only interrupts are for the
+// last byte leaving the FIFO, the PA bias ramp down and the return to RX.
+// Off until the RF output has been checked on a scope against bit clocked transmissions.
+#ifndef TX_FIFO_MODE
+#define TX_FIFO_MODE                   0
+#endif
+
 // Extra debugging using halting assertions
 //#define DEV_MODE                       1
 
+// Fill pooled objects with a marker pattern while they are free, to catch use-after-free and double free
+//#define POOL_POISONING                 1
+
+// Timestamp every event with the DWT cycle counter and keep latency histograms, reported by "perf?"
+//#define EVENT_LATENCY_TRACING          1
+
 #define BOOTMODE_ADDRESS              0x20009C00
 #define DFU_FLAG_MAGIC                0xa191feed
 #define CLI_FLAG_MAGIC                0x209a388d
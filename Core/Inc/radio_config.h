@@ -27,10 +27,12 @@
 /**
  * This allows us to avoid including auto-generated configuration headers for different chips
  * which redefine the same symbols and cause conflicts.
+ *
+ * Each array is a delta against RADIO_CONFIG_BASE, as described in RadioConfigDelta.hpp.
  */
 
-uint8_t* get_si4467_config_array();
-uint8_t* get_si4463_config_array();
-uint8_t* get_si4460_config_array();
+const uint8_t* get_si4467_config_array();
+const uint8_t* get_si4463_config_array();
+const uint8_t* get_si4460_config_array();
 
 #endif /* RADIO_CONFIG_H_ */
@@ -0,0 +1,73 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file radio_config_base.h
+ * @brief The properties shared by the Si4460, Si4463 and Si4467 configurations.
+ * @details These are the properties that all three WDS generated arrays (radio_config_si4460.h,
+ *          radio_config_Si4463_nonstd_preamble.h and radio_config_si4467.h) set to the same value after their
+ *          last non-property command. Each chip's array is stored as a delta against this one (see RadioConfigDelta.hpp),
+ *          and a build fails if a chip's array stops agreeing with it. Same framing as the WDS arrays, terminated by 0.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef RADIO_CONFIG_BASE_H_
+#define RADIO_CONFIG_BASE_H_
+
+#define RADIO_CONFIG_BASE_ARRAY { \
+        0x05, 0x11, 0x00, 0x01, 0x01, 0x00, \
+        0x05, 0x11, 0x01, 0x01, 0x00, 0x00, \
+        0x08, 0x11, 0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, \
+        0x05, 0x11, 0x10, 0x01, 0x02, 0x00, \
+        0x08, 0x11, 0x10, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00, \
+        0x09, 0x11, 0x11, 0x05, 0x00, 0x01, 0xCC, 0xCC, 0x00, 0x00, \
+        0x08, 0x11, 0x12, 0x04, 0x01, 0x01, 0x08, 0xFF, 0xFF, \
+        0x05, 0x11, 0x12, 0x01, 0x06, 0x02, \
+        0x10, 0x11, 0x12, 0x0C, 0x08, 0x00, 0x00, 0x00, 0x40, 0x40, 0x00, 0x40, 0x04, 0x00, 0x00, 0x00, 0x00, \
+        0x10, 0x11, 0x12, 0x0C, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+        0x10, 0x11, 0x12, 0x0C, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+        0x0D, 0x11, 0x12, 0x09, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+        0x10, 0x11, 0x20, 0x0C, 0x00, 0x03, 0x00, 0x07, 0x05, 0xDC, 0x00, 0x05, 0xC9, 0xC3, 0x80, 0x00, 0x01, \
+        0x05, 0x11, 0x20, 0x01, 0x0C, 0xF7, \
+        0x0C, 0x11, 0x20, 0x08, 0x18, 0x01, 0x80, 0x08, 0x02, 0x80, 0x00, 0x70, 0x20, \
+        0x0D, 0x11, 0x20, 0x09, 0x22, 0x00, 0x62, 0x05, 0x3E, 0x2D, 0x02, 0x9D, 0x00, 0xC2, \
+        0x05, 0x11, 0x20, 0x01, 0x2C, 0x54, \
+        0x09, 0x11, 0x20, 0x05, 0x2E, 0x81, 0x01, 0x02, 0x13, 0x80, \
+        0x07, 0x11, 0x20, 0x03, 0x38, 0x11, 0x15, 0x15, \
+        0x09, 0x11, 0x20, 0x05, 0x3C, 0x1A, 0x20, 0x00, 0x00, 0x28, \
+        0x05, 0x11, 0x20, 0x01, 0x42, 0x84, \
+        0x06, 0x11, 0x20, 0x02, 0x45, 0x8F, 0x00, \
+        0x05, 0x11, 0x20, 0x01, 0x48, 0x01, \
+        0x05, 0x11, 0x20, 0x01, 0x4A, 0xFF, \
+        0x05, 0x11, 0x20, 0x01, 0x4C, 0x00, \
+        0x05, 0x11, 0x20, 0x01, 0x4E, 0x40, \
+        0x05, 0x11, 0x20, 0x01, 0x51, 0x0D, \
+        0x10, 0x11, 0x21, 0x0C, 0x00, 0xCC, 0xA1, 0x30, 0xA0, 0x21, 0xD1, 0xB9, 0xC9, 0xEA, 0x05, 0x12, 0x11, \
+        0x10, 0x11, 0x21, 0x0C, 0x0C, 0x0A, 0x04, 0x15, 0xFC, 0x03, 0x00, 0xCC, 0xA1, 0x30, 0xA0, 0x21, 0xD1, \
+        0x10, 0x11, 0x21, 0x0C, 0x18, 0xB9, 0xC9, 0xEA, 0x05, 0x12, 0x11, 0x0A, 0x04, 0x15, 0xFC, 0x03, 0x00, \
+        0x0B, 0x11, 0x23, 0x07, 0x00, 0x2C, 0x0E, 0x0B, 0x04, 0x0C, 0x73, 0x03, \
+        0x10, 0x11, 0x30, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+        0x0C, 0x11, 0x40, 0x08, 0x00, 0x3F, 0x0C, 0xCC, 0xCC, 0x14, 0x7B, 0x20, 0xFA, \
+        0x00 \
+ }
+
+#endif /* RADIO_CONFIG_BASE_H_ */
@@ -0,0 +1,1022 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include <string.h>
+#include "AISDecoder.hpp"
+#include "MessageLayout.hpp"
+#include "_assert.h"
+
+/* Refer to Rec. ITU-R M.1371-4, Annex 8 */
+
+typedef MessageLayout<
+    UField<6>,          // Message type
+    UField<2>,          // Repeat indicator
+    UField<30>          // MMSI
+  > MessageHeader;
+
+// Messages 1, 2 and 3
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<4>,          // Navigational status
+    SField<8>,          // Rate of turn
+    UField<10>,         // SOG
+    UField<1>,          // Position accuracy
+    SField<28>,         // Longitude
+    SField<27>,         // Latitude
+    UField<12>,         // COG
+    UField<9>,          // True heading
+    UField<6>,          // Time stamp
+    UField<2>,          // Special manoeuvre indicator
+    UField<3>,          // Spare
+    UField<1>,          // RAIM
+    UField<19>          // Communication state
+  > PositionReportA;
+
+static_assert(PositionReportA::BITS == 168, "Message 1 is 168 bits");
+
+// Messages 4 and 11
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<14>,         // UTC year
+    UField<4>,          // UTC month
+    UField<5>,          // UTC day
+    UField<5>,          // UTC hour
+    UField<6>,          // UTC minute
+    UField<6>,          // UTC second
+    UField<1>,          // Position accuracy
+    SField<28>,         // Longitude
+    SField<27>,         // Latitude
+    UField<4>,          // EPFD type
+    UField<10>,         // Spare
+    UField<1>,          // RAIM
+    UField<19>          // Communication state
+  > BaseStationReport;
+
+static_assert(BaseStationReport::BITS == 168, "Message 4 is 168 bits");
+
+// Message 5
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // AIS version
+    UField<30>,         // IMO number
+    StringField<7>,     // Call sign
+    StringField<20>,    // Name
+    UField<8>,          // Type of ship and cargo
+    UField<9>,          // Dimension A
+    UField<9>,          // Dimension B
+    UField<6>,          // Dimension C
+    UField<6>,          // Dimension D
+    UField<4>,          // EPFD type
+    UField<4>,          // ETA month
+    UField<5>,          // ETA day
+    UField<5>,          // ETA hour
+    UField<6>,          // ETA minute
+    UField<8>,          // Maximum present static draught
+    StringField<20>,    // Destination
+    UField<1>,          // DTE
+    UField<1>           // Spare
+  > StaticVoyageData;
+
+static_assert(StaticVoyageData::BITS == 424, "Message 5 is 424 bits");
+
+// Message 6, followed by the binary data
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Sequence number
+    UField<30>,         // Destination ID
+    UField<1>,          // Retransmit flag
+    UField<1>,          // Spare
+    UField<10>,         // DAC
+    UField<6>           // FI
+  > AddressedBinary;
+
+// Messages 7 and 13, followed by 1 to 4 destinations
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>           // Spare
+  > Acknowledgement;
+
+typedef MessageLayout<
+    UField<30>,         // Destination ID
+    UField<2>           // Sequence number
+  > AcknowledgedMessage;
+
+// Message 8, followed by the binary data
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Spare
+    UField<10>,         // DAC
+    UField<6>           // FI
+  > BroadcastBinary;
+
+// Message 9
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<12>,         // Altitude
+    UField<10>,         // SOG
+    UField<1>,          // Position accuracy
+    SField<28>,         // Longitude
+    SField<27>,         // Latitude
+    UField<12>,         // COG
+    UField<6>,          // Time stamp
+    UField<8>,          // Regional reserved
+    UField<1>,          // DTE
+    UField<3>,          // Spare
+    UField<1>,          // Assigned mode flag
+    UField<1>,          // RAIM
+    UField<20>          // Communication state selector and communication state
+  > SARAircraftReport;
+
+static_assert(SARAircraftReport::BITS == 168, "Message 9 is 168 bits");
+
+// Messages 10 and 12. Message 12 is followed by the text.
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Sequence number (spare in message 10)
+    UField<30>,         // Destination ID
+    UField<1>,          // Retransmit flag (spare in message 10)
+    UField<1>           // Spare
+  > AddressedSafety;
+
+// Message 14, followed by the text
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>           // Spare
+  > BroadcastSafety;
+
+// Message 15. Shorter variants end after the first or second requested message.
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Spare
+    UField<30>,         // Destination ID 1
+    UField<6>,          // Message ID 1.1
+    UField<12>,         // Slot offset 1.1
+    UField<2>,          // Spare
+    UField<6>,          // Message ID 1.2
+    UField<12>,         // Slot offset 1.2
+    UField<2>,          // Spare
+    UField<30>,         // Destination ID 2
+    UField<6>,          // Message ID 2.1
+    UField<12>,         // Slot offset 2.1
+    UField<2>           // Spare
+  > Interrogation;
+
+static_assert(Interrogation::BITS == 160, "Message 15 is up to 160 bits");
+
+// Message 16. The shorter variant ends after station A.
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Spare
+    UField<30>,         // Destination ID A
+    UField<12>,         // Offset A
+    UField<10>,         // Increment A
+    UField<30>,         // Destination ID B
+    UField<12>,         // Offset B
+    UField<10>          // Increment B
+  > AssignmentCommand;
+
+static_assert(AssignmentCommand::BITS == 144, "Message 16 is up to 144 bits");
+
+// Message 17, followed by the DGNSS data
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Spare
+    SField<18>,         // Longitude
+    SField<17>,         // Latitude
+    UField<5>           // Spare
+  > DGNSSBroadcast;
+
+// Message 18
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<8>,          // Regional reserved
+    UField<10>,         // SOG
+    UField<1>,          // Position accuracy
+    SField<28>,         // Longitude
+    SField<27>,         // Latitude
+    UField<12>,         // COG
+    UField<9>,          // True heading
+    UField<6>,          // Time stamp
+    UField<2>,          // Regional reserved
+    UField<1>,          // Class B unit flag
+    UField<1>,          // Class B display flag
+    UField<1>,          // Class B DSC flag
+    UField<1>,          // Class B band flag
+    UField<1>,          // Class B message 22 flag
+    UField<1>,          // Mode flag
+    UField<1>,          // RAIM
+    UField<20>          // Communication state selector and communication state
+  > PositionReportB;
+
+static_assert(PositionReportB::BITS == 168, "Message 18 is 168 bits");
+
+// Message 19
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<8>,          // Regional reserved
+    UField<10>,         // SOG
+    UField<1>,          // Position accuracy
+    SField<28>,         // Longitude
+    SField<27>,         // Latitude
+    UField<12>,         // COG
+    UField<9>,          // True heading
+    UField<6>,          // Time stamp
+    UField<4>,          // Regional reserved
+    StringField<20>,    // Name
+    UField<8>,          // Type of ship and cargo
+    UField<9>,          // Dimension A
+    UField<9>,          // Dimension B
+    UField<6>,          // Dimension C
+    UField<6>,          // Dimension D
+    UField<4>,          // EPFD type
+    UField<1>,          // RAIM
+    UField<1>,          // DTE
+    UField<1>,          // Assigned mode flag
+    UField<4>           // Spare
+  > ExtendedPositionReportB;
+
+static_assert(ExtendedPositionReportB::BITS == 312, "Message 19 is 312 bits");
+
+// Message 20, followed by 1 to 4 reservations
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>           // Spare
+  > DataLinkManagement;
+
+typedef MessageLayout<
+    UField<12>,         // Offset number
+    UField<4>,          // Number of slots
+    UField<3>,          // Timeout
+    UField<11>          // Increment
+  > SlotReservation;
+
+// Message 21, optionally followed by the name extension
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<5>,          // Type of aid to navigation
+    StringField<20>,    // Name
+    UField<1>,          // Position accuracy
+    SField<28>,         // Longitude
+    SField<27>,         // Latitude
+    UField<9>,          // Dimension A
+    UField<9>,          // Dimension B
+    UField<6>,          // Dimension C
+    UField<6>,          // Dimension D
+    UField<4>,          // EPFD type
+    UField<6>,          // Time stamp
+    UField<1>,          // Off-position indicator
+    UField<8>,          // Regional reserved
+    UField<1>,          // RAIM
+    UField<1>,          // Virtual A-to-N flag
+    UField<1>,          // Assigned mode flag
+    UField<1>           // Spare
+  > AidToNavigationReport;
+
+static_assert(AidToNavigationReport::BITS == 272, "Message 21 is at least 272 bits");
+
+// Message 22, for a geographical area
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Spare
+    UField<12>,         // Channel A
+    UField<12>,         // Channel B
+    UField<4>,          // Tx/Rx mode
+    UField<1>,          // Power
+    SField<18>,         // Longitude 1 (north-east corner)
+    SField<17>,         // Latitude 1
+    SField<18>,         // Longitude 2 (south-west corner)
+    SField<17>,         // Latitude 2
+    UField<1>,          // Addressed or broadcast message indicator
+    UField<1>,          // Channel A bandwidth
+    UField<1>,          // Channel B bandwidth
+    UField<3>,          // Transitional zone size
+    UField<23>          // Spare
+  > ChannelManagement;
+
+// Message 22, addressed to up to two stations
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>, UField<12>, UField<12>, UField<4>, UField<1>,
+    UField<30>,         // Destination ID 1
+    UField<5>,          // Spare
+    UField<30>,         // Destination ID 2
+    UField<5>           // Spare
+  > AddressedChannelManagement;
+
+static_assert(ChannelManagement::BITS == 168, "Message 22 is 168 bits");
+static_assert(AddressedChannelManagement::BITS == ChannelManagement::offset<12>(),
+    "The destinations of message 22 take the place of the area");
+
+// Message 23
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Spare
+    SField<18>,         // Longitude 1 (north-east corner)
+    SField<17>,         // Latitude 1
+    SField<18>,         // Longitude 2 (south-west corner)
+    SField<17>,         // Latitude 2
+    UField<4>,          // Station type
+    UField<8>,          // Type of ship and cargo
+    UField<22>,         // Spare
+    UField<2>,          // Tx/Rx mode
+    UField<4>,          // Reporting interval
+    UField<4>,          // Quiet time
+    UField<6>           // Spare
+  > GroupAssignment;
+
+static_assert(GroupAssignment::BITS == 160, "Message 23 is 160 bits");
+
+// Message 24
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Part number
+    StringField<20>     // Name
+  > StaticDataReportA;
+
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>,          // Part number
+    UField<8>,          // Type of ship and cargo
+    StringField<7>,     // Vendor ID
+    StringField<7>,     // Call sign
+    UField<9>,          // Dimension A
+    UField<9>,          // Dimension B
+    UField<6>,          // Dimension C
+    UField<6>,          // Dimension D
+    UField<4>,          // EPFD type
+    UField<2>           // Spare
+  > StaticDataReportB;
+
+// Auxiliary craft report their mothership in place of the dimensions
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<2>, UField<8>, StringField<7>, StringField<7>,
+    UField<30>          // Mothership MMSI
+  > AuxiliaryStaticDataReportB;
+
+static_assert(StaticDataReportA::BITS == 160, "Message 24A is 160 bits");
+static_assert(StaticDataReportB::BITS == 168, "Message 24B is 168 bits");
+static_assert(AuxiliaryStaticDataReportB::BITS == StaticDataReportB::offset<11>(),
+    "The mothership MMSI takes the place of the dimensions");
+
+// Messages 25 and 26. Each of the destination and application ID is optional.
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<1>,          // Destination indicator
+    UField<1>           // Binary data flag
+  > SlotBinary;
+
+typedef MessageLayout<
+    UField<30>,         // Destination ID
+    UField<2>           // Spare
+  > SlotBinaryDestination;
+
+typedef MessageLayout<
+    UField<10>,         // DAC
+    UField<6>           // FI
+  > ApplicationID;
+
+// Message 26 ends with this
+typedef MessageLayout<
+    UField<20>          // Communication state selector and communication state
+  > SlotBinaryRadio;
+
+// Message 27
+typedef MessageLayout<
+    UField<6>, UField<2>, UField<30>,
+    UField<1>,          // Position accuracy
+    UField<1>,          // RAIM
+    UField<4>,          // Navigational status
+    SField<18>,         // Longitude
+    SField<17>,         // Latitude
+    UField<6>,          // SOG
+    UField<9>,          // COG
+    UField<1>,          // Position latency
+    UField<1>           // Spare
+  > LongRangeReport;
+
+static_assert(LongRangeReport::BITS == 96, "Message 27 is 96 bits");
+
+/**
+ * Copies count 6-bit characters starting at pos. Fields that are padded with '@' end at the first one,
+ * free text is copied as it is.
+ */
+static void decodeCharacters(const RXPacket &packet, uint16_t pos, uint8_t count, char *s, bool padded)
+{
+  uint8_t c = 0;
+  for ( ; c < count; ++c, pos += 6 )
+    {
+      uint8_t v = packet.bits(pos, 6);
+      if ( v == 0 && padded )
+        break;
+      s[c] = v < 32 ? v + 64 : v;
+    }
+
+  s[c] = 0;
+}
+
+// Everything from pos to the end of the payload
+static void payloadFrom(uint16_t pos, uint16_t size, AISPayloadRef &ref)
+{
+  ref.pos = pos;
+  ref.bits = size > pos ? size - pos : 0;
+}
+
+bool AISDecoder::decode(const RXPacket &packet, AISDecodedMessage &msg)
+{
+  memset(&msg, 0, sizeof msg);
+
+  uint16_t size = packet.payloadSize();
+  if ( size < MessageHeader::BITS )
+    return false;
+
+  msg.type = MessageHeader::decode<0>(packet);
+  msg.repeat = MessageHeader::decode<1>(packet);
+  msg.mmsi = MessageHeader::decode<2>(packet);
+
+  switch(msg.type)
+  {
+  case 1:
+  case 2:
+  case 3:
+    return decodePositionA(packet, size, msg);
+  case 4:
+  case 11:
+    return decodeBaseStation(packet, size, msg);
+  case 5:
+    return decodeStaticVoyage(packet, size, msg);
+  case 6:
+    return decodeAddressedBinary(packet, size, msg);
+  case 7:
+  case 13:
+    return decodeAcknowledgement(packet, size, msg);
+  case 8:
+    return decodeBroadcastBinary(packet, size, msg);
+  case 9:
+    return decodeSARAircraft(packet, size, msg);
+  case 10:
+  case 12:
+  case 14:
+    return decodeSafety(packet, size, msg);
+  case 15:
+    return decodeInterrogation(packet, size, msg);
+  case 16:
+    return decodeAssignment(packet, size, msg);
+  case 17:
+    return decodeDGNSS(packet, size, msg);
+  case 18:
+    return decodePositionB(packet, size, msg);
+  case 19:
+    return decodeExtendedPositionB(packet, size, msg);
+  case 20:
+    return decodeDataLink(packet, size, msg);
+  case 21:
+    return decodeAidToNavigation(packet, size, msg);
+  case 22:
+    return decodeChannelManagement(packet, size, msg);
+  case 23:
+    return decodeGroupAssignment(packet, size, msg);
+  case 24:
+    return decodeStaticData(packet, size, msg);
+  case 25:
+  case 26:
+    return decodeSlotBinary(packet, size, msg);
+  case 27:
+    return decodeLongRange(packet, size, msg);
+  default:
+    return false;
+  }
+}
+
+void AISDecoder::text(const RXPacket &packet, const AISPayloadRef &ref, char *s, size_t size)
+{
+  ASSERT(size > 0);
+  size_t count = ref.bits / 6;
+  if ( count > size - 1 )
+    count = size - 1;
+
+  decodeCharacters(packet, ref.pos, count, s, false);
+}
+
+bool AISDecoder::decodePositionA(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef PositionReportA L;
+  if ( size < L::BITS )
+    return false;
+
+  AISPositionReportA &r = msg.positionA;
+  r.navStatus = L::decode<3>(packet);
+  r.rot = L::decode<4>(packet);
+  r.sog = L::decode<5>(packet);
+  r.accuracy = L::decode<6>(packet);
+  r.lon = L::decode<7>(packet);
+  r.lat = L::decode<8>(packet);
+  r.cog = L::decode<9>(packet);
+  r.heading = L::decode<10>(packet);
+  r.second = L::decode<11>(packet);
+  r.maneuver = L::decode<12>(packet);
+  r.raim = L::decode<14>(packet);
+  r.radio = L::decode<15>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeBaseStation(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef BaseStationReport L;
+  if ( size < L::BITS )
+    return false;
+
+  AISBaseStationReport &r = msg.baseStation;
+  r.year = L::decode<3>(packet);
+  r.month = L::decode<4>(packet);
+  r.day = L::decode<5>(packet);
+  r.hour = L::decode<6>(packet);
+  r.minute = L::decode<7>(packet);
+  r.second = L::decode<8>(packet);
+  r.accuracy = L::decode<9>(packet);
+  r.lon = L::decode<10>(packet);
+  r.lat = L::decode<11>(packet);
+  r.epfd = L::decode<12>(packet);
+  r.raim = L::decode<14>(packet);
+  r.radio = L::decode<15>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeStaticVoyage(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef StaticVoyageData L;
+  if ( size < L::BITS )
+    return false;
+
+  AISStaticVoyageData &r = msg.staticVoyage;
+  r.aisVersion = L::decode<3>(packet);
+  r.imo = L::decode<4>(packet);
+  L::decode<5>(packet, r.callsign);
+  L::decode<6>(packet, r.name);
+  r.shipType = L::decode<7>(packet);
+  r.dimensions.a = L::decode<8>(packet);
+  r.dimensions.b = L::decode<9>(packet);
+  r.dimensions.c = L::decode<10>(packet);
+  r.dimensions.d = L::decode<11>(packet);
+  r.epfd = L::decode<12>(packet);
+  r.month = L::decode<13>(packet);
+  r.day = L::decode<14>(packet);
+  r.hour = L::decode<15>(packet);
+  r.minute = L::decode<16>(packet);
+  r.draught = L::decode<17>(packet);
+  L::decode<18>(packet, r.destination);
+  r.dte = L::decode<19>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeAddressedBinary(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef AddressedBinary L;
+  if ( size < L::BITS )
+    return false;
+
+  AISBinaryMessage &r = msg.binary;
+  r.sequence = L::decode<3>(packet);
+  r.destination = L::decode<4>(packet);
+  r.retransmit = L::decode<5>(packet);
+  r.structured = 1;
+  r.dac = L::decode<7>(packet);
+  r.fid = L::decode<8>(packet);
+  payloadFrom(L::BITS, size, r.data);
+  return true;
+}
+
+bool AISDecoder::decodeAcknowledgement(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef AcknowledgedMessage E;
+  uint16_t pos = Acknowledgement::BITS;
+  if ( size < pos + E::BITS )
+    return false;
+
+  AISAcknowledgement &r = msg.ack;
+  for ( ; r.count < 4 && size >= pos + E::BITS; ++r.count, pos += E::BITS )
+    {
+      r.mmsi[r.count] = E::Field<0>::get(packet, pos + E::offset<0>());
+      r.sequence[r.count] = E::Field<1>::get(packet, pos + E::offset<1>());
+    }
+
+  return true;
+}
+
+bool AISDecoder::decodeBroadcastBinary(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef BroadcastBinary L;
+  if ( size < L::BITS )
+    return false;
+
+  AISBinaryMessage &r = msg.binary;
+  r.structured = 1;
+  r.dac = L::decode<4>(packet);
+  r.fid = L::decode<5>(packet);
+  payloadFrom(L::BITS, size, r.data);
+  return true;
+}
+
+bool AISDecoder::decodeSARAircraft(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef SARAircraftReport L;
+  if ( size < L::BITS )
+    return false;
+
+  AISSARAircraftReport &r = msg.sar;
+  r.altitude = L::decode<3>(packet);
+  r.sog = L::decode<4>(packet);
+  r.accuracy = L::decode<5>(packet);
+  r.lon = L::decode<6>(packet);
+  r.lat = L::decode<7>(packet);
+  r.cog = L::decode<8>(packet);
+  r.second = L::decode<9>(packet);
+  r.dte = L::decode<11>(packet);
+  r.assigned = L::decode<13>(packet);
+  r.raim = L::decode<14>(packet);
+  r.radio = L::decode<15>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeSafety(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  AISSafetyMessage &r = msg.safety;
+  if ( msg.type == 14 )
+    {
+      if ( size < BroadcastSafety::BITS )
+        return false;
+
+      payloadFrom(BroadcastSafety::BITS, size, r.text);
+    }
+  else
+    {
+      typedef AddressedSafety L;
+      if ( size < L::BITS )
+        return false;
+
+      r.destination = L::decode<4>(packet);
+      if ( msg.type == 12 )
+        {
+          r.sequence = L::decode<3>(packet);
+          r.retransmit = L::decode<5>(packet);
+          payloadFrom(L::BITS, size, r.text);
+        }
+    }
+
+  // Whole characters only
+  r.text.bits -= r.text.bits % 6;
+  return true;
+}
+
+bool AISDecoder::decodeInterrogation(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef Interrogation L;
+
+  // The trailing spare bits of each variant may be missing
+  if ( size < L::offset<7>() )
+    return false;
+
+  AISInterrogation &r = msg.interrogation;
+  r.mmsi[0] = L::decode<4>(packet);
+  r.messageType[0] = L::decode<5>(packet);
+  r.slotOffset[0] = L::decode<6>(packet);
+  r.count = 1;
+
+  if ( size >= L::offset<10>() )
+    {
+      r.mmsi[1] = r.mmsi[0];
+      r.messageType[1] = L::decode<8>(packet);
+      r.slotOffset[1] = L::decode<9>(packet);
+      r.count = 2;
+    }
+
+  if ( size >= L::offset<14>() )
+    {
+      r.mmsi[2] = L::decode<11>(packet);
+      r.messageType[2] = L::decode<12>(packet);
+      r.slotOffset[2] = L::decode<13>(packet);
+      r.count = 3;
+    }
+
+  return true;
+}
+
+bool AISDecoder::decodeAssignment(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef AssignmentCommand L;
+  if ( size < L::offset<7>() )
+    return false;
+
+  AISAssignmentCommand &r = msg.assignment;
+  r.mmsi[0] = L::decode<4>(packet);
+  r.offset[0] = L::decode<5>(packet);
+  r.increment[0] = L::decode<6>(packet);
+  r.count = 1;
+
+  if ( size >= L::BITS )
+    {
+      r.mmsi[1] = L::decode<7>(packet);
+      r.offset[1] = L::decode<8>(packet);
+      r.increment[1] = L::decode<9>(packet);
+      r.count = 2;
+    }
+
+  return true;
+}
+
+bool AISDecoder::decodeDGNSS(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef DGNSSBroadcast L;
+  if ( size < L::BITS )
+    return false;
+
+  AISDGNSSBroadcast &r = msg.dgnss;
+  r.lon = L::decode<4>(packet);
+  r.lat = L::decode<5>(packet);
+  payloadFrom(L::BITS, size, r.data);
+  return true;
+}
+
+bool AISDecoder::decodePositionB(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef PositionReportB L;
+  if ( size < L::BITS )
+    return false;
+
+  AISPositionReportB &r = msg.positionB;
+  r.sog = L::decode<4>(packet);
+  r.accuracy = L::decode<5>(packet);
+  r.lon = L::decode<6>(packet);
+  r.lat = L::decode<7>(packet);
+  r.cog = L::decode<8>(packet);
+  r.heading = L::decode<9>(packet);
+  r.second = L::decode<10>(packet);
+  r.cs = L::decode<12>(packet);
+  r.display = L::decode<13>(packet);
+  r.dsc = L::decode<14>(packet);
+  r.band = L::decode<15>(packet);
+  r.msg22 = L::decode<16>(packet);
+  r.assigned = L::decode<17>(packet);
+  r.raim = L::decode<18>(packet);
+  r.radio = L::decode<19>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeExtendedPositionB(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef ExtendedPositionReportB L;
+  if ( size < L::BITS )
+    return false;
+
+  AISPositionReportB &r = msg.positionB;
+  r.sog = L::decode<4>(packet);
+  r.accuracy = L::decode<5>(packet);
+  r.lon = L::decode<6>(packet);
+  r.lat = L::decode<7>(packet);
+  r.cog = L::decode<8>(packet);
+  r.heading = L::decode<9>(packet);
+  r.second = L::decode<10>(packet);
+  L::decode<12>(packet, r.name);
+  r.shipType = L::decode<13>(packet);
+  r.dimensions.a = L::decode<14>(packet);
+  r.dimensions.b = L::decode<15>(packet);
+  r.dimensions.c = L::decode<16>(packet);
+  r.dimensions.d = L::decode<17>(packet);
+  r.epfd = L::decode<18>(packet);
+  r.raim = L::decode<19>(packet);
+  r.dte = L::decode<20>(packet);
+  r.assigned = L::decode<21>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeDataLink(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef SlotReservation E;
+  uint16_t pos = DataLinkManagement::BITS;
+  if ( size < pos + E::BITS )
+    return false;
+
+  AISDataLinkManagement &r = msg.dataLink;
+  for ( ; r.count < 4 && size >= pos + E::BITS; ++r.count, pos += E::BITS )
+    {
+      r.offset[r.count] = E::Field<0>::get(packet, pos + E::offset<0>());
+      r.number[r.count] = E::Field<1>::get(packet, pos + E::offset<1>());
+      r.timeout[r.count] = E::Field<2>::get(packet, pos + E::offset<2>());
+      r.increment[r.count] = E::Field<3>::get(packet, pos + E::offset<3>());
+    }
+
+  return true;
+}
+
+bool AISDecoder::decodeAidToNavigation(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef AidToNavigationReport L;
+  if ( size < L::BITS )
+    return false;
+
+  AISAidToNavigationReport &r = msg.aton;
+  r.aidType = L::decode<3>(packet);
+  r.accuracy = L::decode<5>(packet);
+  r.lon = L::decode<6>(packet);
+  r.lat = L::decode<7>(packet);
+  r.dimensions.a = L::decode<8>(packet);
+  r.dimensions.b = L::decode<9>(packet);
+  r.dimensions.c = L::decode<10>(packet);
+  r.dimensions.d = L::decode<11>(packet);
+  r.epfd = L::decode<12>(packet);
+  r.second = L::decode<13>(packet);
+  r.offPosition = L::decode<14>(packet);
+  r.raim = L::decode<16>(packet);
+  r.virtualAid = L::decode<17>(packet);
+  r.assigned = L::decode<18>(packet);
+
+  // The name extension only follows a name that uses all 20 characters
+  L::decode<4>(packet, r.name);
+  uint8_t extension = (size - L::BITS) / 6;
+  if ( extension > sizeof r.name - 21 )
+    extension = sizeof r.name - 21;
+  if ( strlen(r.name) == 20 )
+    decodeCharacters(packet, L::BITS, extension, r.name + 20, true);
+
+  return true;
+}
+
+bool AISDecoder::decodeChannelManagement(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef ChannelManagement L;
+  typedef AddressedChannelManagement A;
+  if ( size < L::BITS )
+    return false;
+
+  AISChannelManagement &r = msg.channel;
+  r.channelA = L::decode<4>(packet);
+  r.channelB = L::decode<5>(packet);
+  r.txrx = L::decode<6>(packet);
+  r.power = L::decode<7>(packet);
+  r.addressed = L::decode<12>(packet);
+  r.bandA = L::decode<13>(packet);
+  r.bandB = L::decode<14>(packet);
+  r.zoneSize = L::decode<15>(packet);
+
+  if ( r.addressed )
+    {
+      r.destination[0] = A::decode<8>(packet);
+      r.destination[1] = A::decode<10>(packet);
+    }
+  else
+    {
+      r.neLon = L::decode<8>(packet);
+      r.neLat = L::decode<9>(packet);
+      r.swLon = L::decode<10>(packet);
+      r.swLat = L::decode<11>(packet);
+    }
+
+  return true;
+}
+
+bool AISDecoder::decodeGroupAssignment(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef GroupAssignment L;
+  if ( size < L::BITS )
+    return false;
+
+  AISGroupAssignment &r = msg.group;
+  r.neLon = L::decode<4>(packet);
+  r.neLat = L::decode<5>(packet);
+  r.swLon = L::decode<6>(packet);
+  r.swLat = L::decode<7>(packet);
+  r.stationType = L::decode<8>(packet);
+  r.shipType = L::decode<9>(packet);
+  r.txrx = L::decode<11>(packet);
+  r.interval = L::decode<12>(packet);
+  r.quiet = L::decode<13>(packet);
+  return true;
+}
+
+bool AISDecoder::decodeStaticData(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  AISStaticDataReport &r = msg.staticData;
+  if ( size < StaticDataReportA::offset<4>() )
+    return false;
+
+  r.part = StaticDataReportA::decode<3>(packet);
+  switch(r.part)
+  {
+  case 0:
+    {
+      typedef StaticDataReportA L;
+      if ( size < L::BITS )
+        return false;
+
+      L::decode<4>(packet, r.name);
+      return true;
+    }
+  case 1:
+    {
+      typedef StaticDataReportB L;
+      if ( size < L::BITS )
+        return false;
+
+      r.shipType = L::decode<4>(packet);
+      L::decode<5>(packet, r.vendor);
+      L::decode<6>(packet, r.callsign);
+
+      // Auxiliary craft are 98XXXYYYY, where XXX is the MID
+      if ( msg.mmsi / 10000000 == 98 )
+        {
+          r.mothership = AuxiliaryStaticDataReportB::decode<7>(packet);
+        }
+      else
+        {
+          r.dimensions.a = L::decode<7>(packet);
+          r.dimensions.b = L::decode<8>(packet);
+          r.dimensions.c = L::decode<9>(packet);
+          r.dimensions.d = L::decode<10>(packet);
+        }
+
+      r.epfd = L::decode<11>(packet);
+      return true;
+    }
+  default:
+    return false;
+  }
+}
+
+bool AISDecoder::decodeSlotBinary(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef SlotBinary L;
+  uint16_t end = size;
+  if ( msg.type == 26 )
+    {
+      if ( size < L::BITS + SlotBinaryRadio::BITS )
+        return false;
+
+      end -= SlotBinaryRadio::BITS;
+    }
+
+  if ( end < L::BITS )
+    return false;
+
+  AISBinaryMessage &r = msg.binary;
+  uint16_t pos = L::BITS;
+  if ( L::decode<3>(packet) )
+    {
+      if ( end < pos + SlotBinaryDestination::BITS )
+        return false;
+
+      r.destination = SlotBinaryDestination::Field<0>::get(packet, pos);
+      pos += SlotBinaryDestination::BITS;
+    }
+
+  r.structured = L::decode<4>(packet);
+  if ( r.structured )
+    {
+      if ( end < pos + ApplicationID::BITS )
+        return false;
+
+      r.dac = ApplicationID::Field<0>::get(packet, pos + ApplicationID::offset<0>());
+      r.fid = ApplicationID::Field<1>::get(packet, pos + ApplicationID::offset<1>());
+      pos += ApplicationID::BITS;
+    }
+
+  if ( msg.type == 26 )
+    r.radio = SlotBinaryRadio::Field<0>::get(packet, end);
+
+  payloadFrom(pos, end, r.data);
+  return true;
+}
+
+bool AISDecoder::decodeLongRange(const RXPacket &packet, uint16_t size, AISDecodedMessage &msg)
+{
+  typedef LongRangeReport L;
+  if ( size < L::BITS )
+    return false;
+
+  AISLongRangeReport &r = msg.longRange;
+  r.accuracy = L::decode<3>(packet);
+  r.raim = L::decode<4>(packet);
+  r.navStatus = L::decode<5>(packet);
+  r.lon = L::decode<6>(packet);
+  r.lat = L::decode<7>(packet);
+  r.sog = L::decode<8>(packet);
+  r.cog = L::decode<9>(packet);
+  r.gnss = L::decode<10>(packet);
+  return true;
+}
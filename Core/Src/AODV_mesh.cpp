@@ -17,6 +17,9 @@
 #include "Configuration.hpp"
 #include <bsp/bsp.hpp>
 #include "GPS.hpp"
+#include "HDLCEncoder.hpp"
+#include "MessageLayout.hpp"
+#include "Utils.hpp"
 
 AODVmesh& AODVmesh::instance() {
 	static AODVmesh __instance;
@@ -46,143 +49,25 @@ bool AODVMessage::decode(const RXPacket&) {
 	return false;
 }
 
-void AODVMessage::addBits(uint8_t *bitVector, uint16_t &size, uint32_t value,
-		uint8_t numBits) {
-	ASSERT(numBits > 0 && numBits <= 32);
-	uint16_t pos = size;
-	for (uint8_t bit = 0; bit < numBits; ++bit, value >>= 1) {
-		bitVector[pos + numBits - bit - 1] = value & 1;
-	}
-
-	size += numBits;
-}
-
-void AODVMessage::putBits(uint8_t *bitVector, uint32_t value, uint8_t numBits) {
-	// This is used for HDLC framing
-	uint16_t pos = 0;
-	for (uint8_t bit = 0; bit < numBits; ++bit, value >>= 1) {
-		bitVector[pos++] = value & 0x01;
-	}
-}
-
-void AODVMessage::reverseEachByte(uint8_t *bitVector, uint16_t size) {
-	ASSERT(size % 8 == 0);
-	for (uint16_t i = 0; i < size; i += 8) {
-		for (uint8_t j = 0; j < 4; ++j) {
-			swap(bitVector[i + j], bitVector[i + 7 - j]);
-		}
-	}
-}
-
-void AODVMessage::addString(uint8_t *bitVector, uint16_t &size,
-		const string &value, uint8_t maxChars) {
-	ASSERT(value.length() <= maxChars);
-	ASSERT(maxChars < 30); // There should be no application for such long strings here
-	char s[30];
-	memset(s, 0, sizeof s);
-	strncpy(s, value.c_str(), value.length());
-
-	uint8_t buffer[32];
-	for (uint8_t c = 0; c < maxChars; ++c) {
-		uint8_t byte = s[c] >= 64 ? s[c] - 64 : s[c];
-		buffer[c] = byte;
-	}
-
-	for (uint8_t c = 0; c < maxChars; ++c)
-		addBits(bitVector, size, buffer[c], 6);
-}
-
-void AODVMessage::payloadToBytes(uint8_t *bitVector, uint16_t numBits,
-		uint8_t *byteArray) {
-	for (uint16_t i = 0; i < numBits; i += 8) {
-		uint8_t byte = 0;
-		for (uint8_t b = 0; b < 8; ++b) {
-			byte |= (bitVector[i + b] << b);
-		}
-		byteArray[i / 8] = byte;
-	}
-}
-
-void AODVMessage::finalize(uint8_t *payload, uint16_t &size, TXPacket &packet) {
-	// Nothing we send exceeds 256 bits, including preambles and such. 40 bytes is more than enough.
-	uint8_t bytes[40];
-
-	// CRC-CCITT calculation
-	payloadToBytes(payload, size, bytes);
-	uint16_t crc = Utils::crc16(bytes, size / 8);
-	uint8_t crcL = crc & 0x00ff;
-	uint8_t crcH = (crc & 0xff00) >> 8;
-	addBits(payload, size, crcL, 8);
-	addBits(payload, size, crcH, 8);
-	payloadToBytes(payload, size, bytes);
-
-	// Encoding for transmission
-	reverseEachByte(payload, size);
-	bitStuff(payload, size);
-	constructHDLCFrame(payload, size);
-	nrziEncode(payload, size, packet);
-	packet.pad();
-}
-
-void AODVMessage::bitStuff(uint8_t *buff, uint16_t &size) {
-	uint16_t numOnes = 0;
-	for (uint16_t i = 0; i < size; ++i) {
-		switch (buff[i]) {
-		case 0:
-			numOnes = 0;
-			break;
-		case 1:
-			++numOnes;
-			if (numOnes == 5) {
-				// Insert a 0 right after this one
-				memmove(buff + i + 2, buff + i + 1, size - i - 1);
-				buff[i + 1] = 0;
-				++size;
-			}
-			break;
-		default:
-			ASSERT(false)
-			;
-		}
-	}
-}
-
-void AODVMessage::constructHDLCFrame(uint8_t *buff, uint16_t &size) {
-
-	// Make room for 35 bits at the front
-	memmove(buff + 35, buff, size);
-	size += 35;
-	putBits(buff, 0xFF, 3);            // 3 ramp bits. That's all we can afford.
-	putBits(buff + 3, 0b010101010101010101010101, 24); // 24 training bits (ramp will actually continue during the first 1-2)
-	putBits(buff + 27, 0x7e, 8);                          // HDLC start flag
-
-	// Now append the end marker and ramp-down bits
-	addBits(buff, size, 0x7e, 8);                       // HDLC stop flag
-	addBits(buff, size, 0x00, 3);                       // Ramp down
-}
-
-void AODVMessage::nrziEncode(uint8_t *buff, uint16_t &size, TXPacket &packet) {
-	uint8_t prevBit = 1;        // Arbitrarily starting with 1
-	packet.addBit(prevBit);
-
-	for (uint16_t i = 0; i < size; ++i) {
-		if (buff[i] == 0) {
-			packet.addBit(!prevBit);
-			prevBit = !prevBit;
-		} else {
-			packet.addBit(prevBit);
-		}
-	}
-
-	// The TXPacket is now populated with the sequence of bits that need to be sent
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 //
 // AODV RREQ Message
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+typedef MessageLayout<
+		UField<8>,		// Message Type Indicator
+		UField<8>,		// Reserved for future use
+		UField<32>,		// Source MMSI
+		UField<32>,		// Destination MMSI
+		UField<8>,		// Hop Count
+		UField<8>,		// Request Id
+		SField<32>,		// Longitude
+		SField<32>		// Latitude
+	> AODVRequest;
+
+static_assert(AODVRequest::BITS == 160, "An AODV request is 160 bits long");
+
 AODVMessageRREQ::AODVMessageRREQ() {
 }
 
@@ -202,42 +87,20 @@ void AODVMessageRREQ::encode(const AODV_rreq_t &message_packet,
 
 	AODVMessage::encode(message_packet, packet);
 
-	// TODO: Perhaps this shouldn't live on the stack?
-	uint8_t payload[MAX_AODV_TX_PACKET_SIZE];
-	uint16_t size = 0;
-	uint32_t value;
-
 	packet.setMessageType("28");
 
-	value = message_packet.type;
-	addBits(payload, size, value, 8);   // Message Type Indicator
-
-	value = message_packet.reserved;
-	addBits(payload, size, value, 8);   // Reserved for future use
-
-	value = message_packet.source_mmsi;
-	addBits(payload, size, value, 32);  // Source MMSI
-
-	value = message_packet.dest_mmsi;
-	addBits(payload, size, value, 32);  // Destination MMSI
-
-	value = message_packet.hop_count;
-	addBits(payload, size, value, 8);   // Hop Count
-
-	value = message_packet.req_id;
-	addBits(payload, size, value, 8);  // Request Id
-
-	value = Utils::coordinateToUINT32(message_packet.longitude);
-	addBits(payload, size, value, 32);  // Longitude
-
-	value = Utils::coordinateToUINT32(message_packet.latitude);
-	addBits(payload, size, value, 32);  // Latitude
-
-#if DEV_MODE
-  ASSERT(size == 160);
-#endif
-
-	finalize(payload, size, packet);
+	HDLCEncoder frame(packet);
+	AODVRequest::encode(frame,
+			message_packet.type,
+			message_packet.reserved,
+			message_packet.source_mmsi,
+			message_packet.dest_mmsi,
+			message_packet.hop_count,
+			message_packet.req_id,
+			Utils::coordinateToUINT32(message_packet.longitude),
+			Utils::coordinateToUINT32(message_packet.latitude));
+
+	frame.finish();
 }
 
 AODV_rreq_t AODVmesh::aodv_whois(const std::string &s) {
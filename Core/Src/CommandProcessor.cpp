@@ -37,6 +37,14 @@
 
 #include "RadioManager.hpp"
 
+#include "DataTerminal.hpp"
+
+#include "RXPacketProcessor.hpp"
+
+#include "RXFunnel.hpp"
+
+#include "PerfTrace.hpp"
+
 #include <stdlib.h>
 
 #include "AODV_mesh.hpp"
@@ -125,6 +133,7 @@ void CommandProcessor::processCommand(const char * buff) {
     station.magic = STATION_DATA_MAGIC;
 
     Configuration::instance().writeStationData(station);
+    TXScheduler::instance().reloadStationData();
   } else if (s.find("station?") == 0) {
     Configuration::instance().reportStationData();
   } else if (s.find("sys?") == 0) {
@@ -133,9 +142,11 @@ void CommandProcessor::processCommand(const char * buff) {
     jumpToBootloader();
   } else if (s.find("erase station") == 0) {
     Configuration::instance().eraseStationData();
+    TXScheduler::instance().reloadStationData();
     Configuration::instance().reportStationData();
   } else if (s.find("factory reset") == 0) {
     Configuration::instance().factoryReset();
+    TXScheduler::instance().reloadStationData();
     Configuration::instance().reportStationData();
   } else if (s.find("tx test") == 0) {
     fireTestPacket();
@@ -202,7 +213,29 @@ void CommandProcessor::processCommand(const char * buff) {
     Configuration::instance().setXOTrimValue(value);
   } else if (s.find("xotrim?") == 0) {
     Configuration::instance().reportXOTrimValue();
+  } else if (s.find("term?") == 0) {
+    DataTerminal::instance().reportStats();
+  } else if (s.find("evq?") == 0) {
+    EventQueue::instance().reportStats();
+  } else if (s.find("pool?") == 0) {
+    EventPool::instance().reportStats();
+    TXPacketPool::instance().reportStats();
+  } else if (s.find("rxstats?") == 0) {
+    RXPacketProcessor::instance().reportStats();
+  } else if (s.find("rxfunnel?") == 0) {
+    RXFunnel::instance().reportStats();
+  } else if (s.find("rxmap?") == 0) {
+    RXFunnel::instance().reportMap();
+  } else if (s.find("boot?") == 0) {
+    RadioManager::instance().reportBootTiming();
+  }
+#if EVENT_LATENCY_TRACING
+  else if (s.find("perf?") == 0) {
+    PerfTrace::instance().reportStats();
+  } else if (s.find("perf reset") == 0) {
+    PerfTrace::instance().reset();
   }
+#endif
 }
 
 void CommandProcessor::enterCLIMode() {
@@ -22,11 +22,16 @@
 #include "Events.hpp"
 #include "Utils.hpp"
 #include "bsp/bsp.hpp"
+#include <stdio.h>
+#include <string.h>
 
 static char __rxbuff[80];
 static uint8_t __rxpos = 0;
 
 void termInputCB(char c);
+#if TERMINAL_DMA_TX
+void termTXCompleteCB();
+#endif
 
 DataTerminal &DataTerminal::instance()
 {
@@ -37,10 +42,16 @@ DataTerminal &DataTerminal::instance()
 void DataTerminal::init()
 {
   bsp_set_terminal_input_callback(termInputCB);
+#if TERMINAL_DMA_TX
+  bsp_set_terminal_tx_callback(termTXCompleteCB);
+#endif
 }
 
 DataTerminal::DataTerminal()
 : mCmdBuffPos(0)
+#if TERMINAL_DMA_TX
+  , mTXLength(0), mBytesSent(0)
+#endif
 {
   mCmdTokens.reserve(5);
   EventQueue::instance().addObserver(this, DEBUG_EVENT|PROPR_NMEA_SENTENCE);
@@ -70,20 +81,97 @@ void DataTerminal::processEvent(const Event &e)
 
 void DataTerminal::write(const char *cls, const char* s)
 {
+#if TERMINAL_DMA_TX
+  char line[160];
+  snprintf(line, sizeof line, "[%s]%s", cls, s);
+  queue(line);
+#else
   bsp_write_char('[');
   bsp_write_string(cls);
   bsp_write_char(']');
   bsp_write_string(s);
+#endif
 }
 
 #else
 
 void DataTerminal::write(const char* s)
 {
+#if TERMINAL_DMA_TX
+  queue(s);
+#else
   bsp_write_string(s);
+#endif
+}
+#endif
+
+#if TERMINAL_DMA_TX
+
+/*
+ * Output is only ever produced from thread context, so the ring has a single producer.
+ * The DMA completion interrupt is the single consumer, and it also restarts the DMA from the ring.
+ * The idle check and the restart below read the same tail, so they run with interrupts masked.
+ */
+void DataTerminal::queue(const char *s)
+{
+  mTXBuffer.write((const uint8_t*)s, strlen(s));
+
+  uint32_t mask = Utils::disableInterrupts();
+  if ( mTXLength == 0 )
+    startTransfer();
+  Utils::restoreInterrupts(mask);
+}
+
+void DataTerminal::startTransfer()
+{
+  const uint8_t *data = nullptr;
+  size_t len = mTXBuffer.peekContiguous(data);
+  if ( len == 0 )
+    return;
+
+  if ( len > 0xffff )
+    len = 0xffff;
+
+  mTXLength = len;
+  if ( !bsp_start_terminal_tx(data, len) )
+    mTXLength = 0;
 }
+
+void DataTerminal::onTXComplete()
+{
+  mTXBuffer.consume(mTXLength);
+  mBytesSent += mTXLength;
+  mTXLength = 0;
+  startTransfer();
+}
+
+void termTXCompleteCB()
+{
+  DataTerminal::instance().onTXComplete();
+}
+
 #endif
 
+void DataTerminal::reportStats()
+{
+#if TERMINAL_DMA_TX
+  Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+  if ( !e )
+    return;
+
+  sprintf(e->nmeaBuffer.sentence, "$PAITRM,%lu,%lu,%lu,%lu,%lu,%u*",
+      mTXBuffer.bytesQueued(),
+      mBytesSent,
+      mTXBuffer.bytesDropped(),
+      mTXBuffer.writesDropped(),
+      mTXBuffer.highWater(),
+      mTXBuffer.capacity());
+
+  Utils::completeNMEA(e->nmeaBuffer.sentence);
+  EventQueue::instance().push(e);
+#endif
+}
+
 
 
 void DataTerminal::_write(const char *s)
@@ -20,10 +20,23 @@
 
 #include "EventQueue.hpp"
 #include "printf_serial.h"
-#include "printf_serial.h"
 #include "Utils.hpp"
+#include "PerfTrace.hpp"
 #include "bsp/bsp.hpp"
+#include <stdio.h>
+
+
+typedef struct {
+  EventMask types;
+  uint8_t limit;          // Soft capacity, never more than the lane's ring
+  DropPolicy policy;
+} LaneConfig;
 
+static const LaneConfig __lanes[EVENT_LANE_COUNT] = {
+    { AIS_PACKET_EVENT|INTERROGATION_EVENT|CLOCK_EVENT, 24, DROP_NEWEST },
+    { 0, 12, DROP_NEWEST },
+    { GPS_NMEA_SENTENCE|DEBUG_EVENT|RSSI_SAMPLE_EVENT, 8, DROP_OLDEST },
+};
 
 EventQueue &EventQueue::instance()
 {
@@ -32,78 +45,174 @@ EventQueue &EventQueue::instance()
 }
 
 EventQueue::EventQueue()
-  : mISRQueue(25), mTaskQueue(10)
 {
+  memset(mConsumers, 0, sizeof mConsumers);
+  memset(mConsumerCount, 0, sizeof mConsumerCount);
+  memset(mLaneStats, 0, sizeof mLaneStats);
+
+  for ( uint32_t t = 0; t < EVENT_TYPE_COUNT; ++t )
+    {
+      mLaneOf[t] = LANE_CONTROL;
+      for ( uint8_t l = 0; l < EVENT_LANE_COUNT; ++l )
+        {
+          if ( __lanes[l].types & (1ULL << t) )
+            mLaneOf[t] = l;
+        }
+    }
 }
 
 void EventQueue::init()
 {
 }
 
+EventLane EventQueue::laneFor(EventType type)
+{
+  if ( type == UNKNOWN_EVENT )
+    return LANE_CONTROL;
+
+  return (EventLane)mLaneOf[EVENT_TYPE_INDEX(type)];
+}
+
+void EventQueue::countRefused(EventType type)
+{
+  __atomic_fetch_add(&mLaneStats[laneFor(type)].refused, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Any interrupt may push while another push is in progress, so the lane counters are
+ * updated atomically. A plain increment could lose counts when one preempts another.
+ */
 bool EventQueue::push(Event *e)
 {
-  if ( Utils::inISR() )
+  EventLane l = laneFor(e->type);
+  MPMCQueue<Event*, 32> &lane = mLanes[l];
+  LaneStats &stats = mLaneStats[l];
+
+  PERF_STAMP_PUSH(e);
+
+  if ( lane.size() >= __lanes[l].limit && __lanes[l].policy == DROP_OLDEST )
     {
-      if ( !mISRQueue.push(e) )
+      Event *oldest = nullptr;
+      if ( lane.pop(oldest) )
         {
-          EventPool::instance().deleteEvent(e);
-          return false;
+          EventPool::instance().deleteEvent(oldest);
+          __atomic_fetch_add(&stats.evicted, 1, __ATOMIC_RELAXED);
         }
     }
-  else
+
+  if ( lane.size() >= __lanes[l].limit || !lane.push(e) )
     {
-      if ( !mTaskQueue.push(e) )
-        {
-          EventPool::instance().deleteEvent(e);
-          return false;
-        }
+      EventPool::instance().deleteEvent(e);
+      __atomic_fetch_add(&stats.dropped, 1, __ATOMIC_RELAXED);
+      return false;
     }
 
+  __atomic_fetch_add(&stats.pushed, 1, __ATOMIC_RELAXED);
   return true;
 }
 
-void EventQueue::addObserver(EventConsumer *c, uint32_t eventMask)
+void EventQueue::addObserver(EventConsumer *c, EventMask eventMask)
 {
-  mConsumers[c] = eventMask;
+  // Re-registering replaces the previous mask, just like it did when this was a map
+  removeObserver(c);
+
+  for ( uint32_t t = 0; t < EVENT_TYPE_COUNT; ++t )
+    {
+      if ( (eventMask & (1ULL << t)) == 0 )
+        continue;
+
+      ASSERT(mConsumerCount[t] < MAX_CONSUMERS_PER_EVENT);
+      if ( mConsumerCount[t] < MAX_CONSUMERS_PER_EVENT )
+        mConsumers[t][mConsumerCount[t]++] = c;
+    }
 }
 
 void EventQueue::removeObserver(EventConsumer *c)
 {
-  map<EventConsumer*, uint32_t>::iterator i = mConsumers.find(c);
-  if ( i == mConsumers.end() )
-    return;
+  for ( uint32_t t = 0; t < EVENT_TYPE_COUNT; ++t )
+    {
+      uint8_t j = 0;
+      for ( uint8_t i = 0; i < mConsumerCount[t]; ++i )
+        {
+          if ( mConsumers[t][i] != c )
+            mConsumers[t][j++] = mConsumers[t][i];
+        }
 
-  mConsumers.erase(i);
+      mConsumerCount[t] = j;
+    }
 }
 
 void EventQueue::dispatch()
 {
-  Event *e = nullptr;
-
-  while (mISRQueue.pop(e))
+  Event *batch[4];
+
+  /*
+   * Always go back to the highest priority lane after handling a batch,
+   * so critical events that arrive while a lower lane is being drained are served first.
+   */
+  uint8_t l = 0;
+  while ( l < EVENT_LANE_COUNT )
     {
-      for ( map<EventConsumer*, uint32_t>::iterator c = mConsumers.begin(); c != mConsumers.end(); ++c )
+      size_t count = mLanes[l].popBatch(batch, sizeof batch / sizeof batch[0]);
+      if ( count == 0 )
         {
-          if ( c->second & e->type )
-            {
-              c->first->processEvent(*e);
-            }
+          ++l;
+          continue;
         }
 
-      EventPool::instance().deleteEvent(e);
+      for ( size_t i = 0; i < count; ++i )
+        dispatch(batch[i]);
+
+      l = 0;
     }
+}
+
+void EventQueue::dispatch(Event *e)
+{
+  PERF_STAMP_DISPATCH(e);
 
-  while (mTaskQueue.pop(e))
+  if ( e->type != UNKNOWN_EVENT )
     {
-      for ( map<EventConsumer*, uint32_t>::iterator c = mConsumers.begin(); c != mConsumers.end(); ++c )
+      uint32_t t = EVENT_TYPE_INDEX(e->type);
+      ASSERT(t < EVENT_TYPE_COUNT);
+
+      EventConsumer **consumers = mConsumers[t];
+      for ( uint8_t i = 0; i < mConsumerCount[t]; ++i )
         {
-          if ( c->second & e->type )
-            {
-              c->first->processEvent(*e);
-            }
+          PERF_CONSUMER_ENTER();
+          consumers[i]->processEvent(*e);
+          PERF_CONSUMER_EXIT(consumers[i]);
         }
-
-      EventPool::instance().deleteEvent(e);
     }
+
+  PERF_EVENT_DONE(e);
+
+  EventPool::instance().deleteEvent(e);
 }
 
+
+void EventQueue::reportStats()
+{
+  static const char *names[EVENT_LANE_COUNT] = { "CRIT", "CTRL", "BULK" };
+
+  for ( uint8_t l = 0; l < EVENT_LANE_COUNT; ++l )
+    {
+      Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+      if ( !e )
+        return;
+
+      const LaneStats &s = mLaneStats[l];
+      sprintf(e->nmeaBuffer.sentence, "$PAIEVQ,%s,%u,%d,%lu,%lu,%lu,%lu,%lu*",
+          names[l],
+          mLanes[l].size(),
+          __lanes[l].limit,
+          mLanes[l].highWater(),
+          s.pushed,
+          s.dropped,
+          s.evicted,
+          s.refused);
+
+      Utils::completeNMEA(e->nmeaBuffer.sentence);
+      push(e);
+    }
+}
@@ -19,7 +19,11 @@
 
 
 #include "Events.hpp"
+#include "EventQueue.hpp"
+#include "PerfTrace.hpp"
 #include "printf_serial.h"
+#include "Utils.hpp"
+#include <stdio.h>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -60,7 +64,6 @@ EventPool &EventPool::instance()
 
 
 EventPool::EventPool()
-  : mISRPool(25), mThreadPool(10), mRXPool(20)
 {
 
 }
@@ -74,6 +77,17 @@ Event *EventPool::newEvent(EventType type)
   Event *result = nullptr;
   if ( Utils::inISR() )
     {
+      /*
+       * Backpressure: once the pool runs low, only events bound for the critical lane are allocated.
+       * Otherwise a burst of GPS sentences could leave nothing for the next AIS packet.
+       */
+      if ( mISRPool.available() <= CRITICAL_EVENT_RESERVE &&
+           EventQueue::instance().laneFor(type) != LANE_CRITICAL )
+        {
+          EventQueue::instance().countRefused(type);
+          return nullptr;
+        }
+
       result = mISRPool.get();
       if ( result )
         {
@@ -101,6 +115,7 @@ Event *EventPool::newEvent(EventType type)
     return result;
 
   ASSERT_VALID_PTR(result);
+  PERF_STAMP_ALLOC(result);
   return result;
 }
 
@@ -137,3 +152,26 @@ void EventPool::releaseRXPacket(RXPacket *packet)
   mRXPool.put(packet);
 }
 
+template<typename P> void EventPool::reportPool(const char *name, P &pool)
+{
+  Event *e = newEvent(PROPR_NMEA_SENTENCE);
+  if ( !e )
+    return;
+
+  sprintf(e->nmeaBuffer.sentence, "$PAIPOOL,%s,%lu,%lu,%lu,%lu*",
+      name,
+      pool.size(),
+      pool.utilization(),
+      pool.maxUtilization(),
+      pool.allocFailures());
+
+  Utils::completeNMEA(e->nmeaBuffer.sentence);
+  EventQueue::instance().push(e);
+}
+
+void EventPool::reportStats()
+{
+  reportPool("EVTISR", mISRPool);
+  reportPool("EVTTHR", mThreadPool);
+  reportPool("RXPKT", mRXPool);
+}
@@ -0,0 +1,244 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include "HDLCDecoder.hpp"
+#include "PerfTrace.hpp"
+
+// The start flag takes 8 bits of the window and the AIS training sequence is 24 bits long
+static_assert(RX_PREAMBLE_BITS >= 4 && RX_PREAMBLE_BITS <= 24, "RX_PREAMBLE_BITS must be between 4 and 24");
+
+HDLCDecoder::HDLCDecoder(HDLCDecoderListener *listener)
+  : mListener(listener), mPacket(nullptr)
+{
+  reset();
+}
+
+void HDLCDecoder::setPacket(RXPacket *packet)
+{
+  mPacket = packet;
+}
+
+void HDLCDecoder::reset()
+{
+  mState = PREAMBLE_SYNC;
+  mWindow = 0;
+  mLastLevel = 0xff;
+  mOnes = 0;
+  mDataBits = 0;
+  mData = 0;
+  if ( mPacket )
+    mPacket->reset();
+}
+
+void HDLCDecoder::decode(uint8_t levels)
+{
+  if ( !mPacket )
+    return;
+
+  if ( mLastLevel != 0xff )
+    {
+      // NRZI: a 1 is the absence of a transition between consecutive levels
+      uint8_t bits = ~(levels ^ ((mLastLevel << 7) | (levels >> 1)));
+      uint32_t window = (mWindow << 8) | bits;
+
+      /*
+       * Bit i of runs is set when window bits i..i+4 are all ones. A flag, a stuffed bit or an abort
+       * anywhere in this byte needs such a run starting at bits 1..8, so without one the byte is plain data.
+       */
+      uint32_t runs = window & (window >> 1);
+      runs &= runs >> 2;
+      runs &= window >> 4;
+
+      if ( (runs & 0x1fe) == 0 &&
+           (mState == PREAMBLE_SYNC || mPacket->size() + 8 < MAX_AIS_RX_PACKET_SIZE - 2) )
+        {
+          mLastLevel = levels & 0x01;
+          mWindow = window;
+
+          if ( mState == IN_PACKET )
+            {
+              // Exactly one byte completes here, the rest of the bits remain pending
+              uint16_t data = ((uint16_t)mData << 8) | bits;
+              PERF_ADDBYTE_ENTER();
+              mPacket->addByte(data >> mDataBits);
+              PERF_ADDBYTE_EXIT();
+              mData = data & ((1 << mDataBits) - 1);
+              mOnes = __builtin_ctz(~(uint32_t)bits);
+            }
+
+          return;
+        }
+    }
+
+  for ( int8_t i = 7; i >= 0 && mPacket; --i )
+    decodeBit((levels >> i) & 0x01, i);
+}
+
+/**
+ * This is the original per-bit state machine
+ */
+void HDLCDecoder::decodeBit(uint8_t level, uint8_t bitsLeft)
+{
+  if ( mLastLevel == 0xff )
+    {
+      mLastLevel = level;
+      return;
+    }
+
+  uint8_t bit = !(mLastLevel ^ level);
+
+  switch (mState) {
+  case PREAMBLE_SYNC:
+    {
+      mLastLevel = level;
+      mWindow <<= 1;
+      mWindow |= bit;
+
+      int8_t errors = syncErrors();
+      if ( errors >= 0 )
+        {
+          mState = IN_PACKET;
+          mPacket->setSyncErrors(errors);
+          mListener->onFrameStart(bitsLeft);
+        }
+
+      break;
+    }
+  case IN_PACKET:
+    {
+      if ( mOnes >= 7 || mPacket->size() >= MAX_AIS_RX_PACKET_SIZE - 2 )
+        {
+          // Start over
+          mListener->onFrameAbort(mOnes >= 7 ? FRAME_ABORT_STUFFING : FRAME_ABORT_OVERSIZE);
+          reset();
+          return;
+        }
+
+      mLastLevel = level;
+      mWindow <<= 1;
+      mWindow |= bit;
+
+      if ( (mWindow & 0x00ff) == 0x7E )
+        {
+          /*
+           * We have a complete packet. Unless its CRC is good, this flag may just as well be the start of
+           * a stronger colliding frame that has taken over the receiver, so if a complete training sequence
+           * leads up to it, decoding carries on into that frame. The listener gets both candidates.
+           */
+          int8_t errors = !mPacket->checkCRC() && trainingComplete() ? 0 : -1;
+          mListener->onFrameEnd(bitsLeft, errors >= 0);
+
+          uint32_t window = mWindow;
+          reset();
+
+          if ( errors >= 0 && mPacket )
+            {
+              mState = IN_PACKET;
+              mWindow = window;
+              mLastLevel = level;
+              mPacket->setSyncErrors(errors);
+              mPacket->setCollision(true);
+              mListener->onFrameStart(bitsLeft);
+            }
+        }
+      else
+        {
+          addBit(bit);
+        }
+
+      break;
+    }
+  }
+}
+
+/**
+ * By checking for the last few preamble bits plus the HDLC start flag, we gain enough confidence that this is not random noise.
+ * The flag must always match exactly. Right before it, either the last 4 training bits match exactly (the original test),
+ * or the last RX_PREAMBLE_BITS of them are within RX_PREAMBLE_TOLERANCE of the alternating pattern in either phase.
+ * The longer window keeps the extra false starts from noise negligible.
+ *
+ * Returns the number of training bit errors, or -1 if this is not a frame start.
+ */
+int8_t HDLCDecoder::syncErrors() const
+{
+  if ( (mWindow & 0xff) != 0x7E )
+    return -1;
+
+  uint32_t training = mWindow >> 8;
+  if ( (training & 0x0f) == 0b1010 || (training & 0x0f) == 0b0101 )
+    return 0;
+
+#if RX_PREAMBLE_TOLERANCE
+  const uint32_t mask = (1UL << RX_PREAMBLE_BITS) - 1;
+
+  // The two phases of the training sequence are complements of each other
+  uint8_t distance = __builtin_popcount((training ^ 0xaaaaaaaa) & mask);
+  if ( distance > RX_PREAMBLE_BITS / 2 )
+    distance = RX_PREAMBLE_BITS - distance;
+
+  if ( distance <= RX_PREAMBLE_TOLERANCE )
+    return distance;
+#endif
+
+  return -1;
+}
+
+/**
+ * Any flag inside a packet with a bad CRC could start a colliding frame, and a frame's own closing flag is
+ * often preceded by enough alternating bits to pass the 4 bit test. So to fork, the flag must be preceded by
+ * all of the last RX_PREAMBLE_BITS training bits without a single error, in either phase.
+ */
+bool HDLCDecoder::trainingComplete() const
+{
+  if ( (mWindow & 0xff) != 0x7E )
+    return false;
+
+  const uint32_t mask = (1UL << RX_PREAMBLE_BITS) - 1;
+  uint32_t training = (mWindow >> 8) & mask;
+  return training == (0xaaaaaaaa & mask) || training == (0x55555555 & mask);
+}
+
+void HDLCDecoder::addBit(uint8_t bit)
+{
+  if ( bit )
+    {
+      ++mOnes;
+    }
+  else
+    {
+      // Don't put stuffed bits into the packet
+      bool stuffed = mOnes == 5;
+      mOnes = 0;
+      if ( stuffed )
+        return;
+    }
+
+  mData <<= 1;
+  mData |= bit;
+  if ( ++mDataBits == 8 )
+    {
+      // Commit to the packet!
+      PERF_ADDBYTE_ENTER();
+      mPacket->addByte(mData);
+      PERF_ADDBYTE_EXIT();
+      mDataBits = 0;
+      mData = 0;
+    }
+}
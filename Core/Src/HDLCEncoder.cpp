@@ -0,0 +1,178 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include "HDLCEncoder.hpp"
+#include "Utils.hpp"
+#include "_assert.h"
+
+HDLCEncoder::HDLCEncoder(TXPacket &packet)
+  : mPacket(&packet), mBits(0), mNumBits(0), mSize(0), mCRC(0xffff), mOnes(0), mLevel(1)
+{
+  /*
+   * As a class B "CS" transponder, we don't transmit a full ramp byte because
+   * we have to listen for a few bits into each slot for Clear Channel Assessment.
+   * Also, this implementation only adds 3 bits for ramp down, just in case
+   * our TX bit clock is a little lazy. Not what the ITU standard says, but no
+   * reasonable receiver should care about ramp-down bits. It's only what goes
+   * between the 0x7E markers that counts.
+   */
+
+  // NRZI needs a starting level. Arbitrarily starting with 1.
+  mPacket->addBits(mLevel, 1);
+
+  sendLevels(0x07, 3);                                  // 3 ramp bits. That's all we can afford.
+  sendLevels(0b010101010101010101010101, 24);           // 24 training bits (ramp will actually continue during the first 1-2)
+  sendLevels(0x7e, 8);                                  // HDLC start flag
+}
+
+HDLCEncoder::HDLCEncoder(TXPacket &packet, const HDLCEncoder &prefix)
+  : HDLCEncoder(prefix)
+{
+  mPacket = &packet;
+  mPacket->copyFrame(*prefix.mPacket);
+}
+
+void HDLCEncoder::addBits(uint32_t value, uint8_t numBits)
+{
+  ASSERT(numBits > 0  && numBits <= 32);
+  if ( numBits < 32 )
+    value &= (1UL << numBits) - 1;
+
+  mBits = (mBits << numBits) | value;
+  mNumBits += numBits;
+  mSize += numBits;
+
+  while ( mNumBits >= 8 )
+    {
+      mNumBits -= 8;
+      addByte(mBits >> mNumBits);
+    }
+
+  mBits &= (1UL << mNumBits) - 1;
+}
+
+void HDLCEncoder::addString(const char *value, uint8_t maxChars)
+{
+  uint8_t c = 0;
+  for ( ; c < maxChars && value[c]; ++c )
+    {
+      // ASCII 64-95 are characters 0-31 and ASCII 32-63 are themselves
+      addBits(value[c] & 0x3f, 6);
+    }
+
+  ASSERT(value[c] == 0);
+  for ( ; c < maxChars; ++c )
+    addBits(0, 6);
+}
+
+uint16_t HDLCEncoder::size() const
+{
+  return mSize;
+}
+
+void HDLCEncoder::finish()
+{
+  ASSERT(mNumBits == 0);
+
+  // CRC-CCITT, low byte first
+  uint16_t crc = ~mCRC;
+  stuffByte(crc & 0x00ff);
+  stuffByte(crc >> 8);
+
+  // Now append the end marker and ramp-down bits
+  sendLevels(0x7e, 8);                                  // HDLC stop flag
+  sendLevels(0x00, 3);                                  // Ramp down
+  mPacket->pad();
+}
+
+/**
+ * The first field bit is the MSB of the byte, but every AIS byte is sent LSB first.
+ * That is also the order the reflected CRC consumes bits in.
+ */
+void HDLCEncoder::addByte(uint8_t byte)
+{
+  mCRC = (mCRC >> 8) ^ Utils::CRC16_X25_TABLE[(mCRC ^ byte) & 0xff];
+  stuffByte(byte);
+}
+
+void HDLCEncoder::stuffByte(uint8_t byte)
+{
+  /*
+   * Bit i of runs is set when window bits i..i+4 are all ones. The window is the byte, LSB first,
+   * preceded by the ones already sent. Without such a run nothing needs to be stuffed.
+   */
+  uint32_t window = ((uint32_t)byte << mOnes) | ((1UL << mOnes) - 1);
+  uint32_t runs = window & (window >> 1);
+  runs &= runs >> 2;
+  runs &= window >> 4;
+
+  if ( runs == 0 )
+    {
+      sendLevels(byte, 8);
+
+      // There is a 0 in the byte, so only the ones after the last one count
+      mOnes = __builtin_clz(~((uint32_t)byte << 24));
+      return;
+    }
+
+  uint32_t bits = 0;
+  uint8_t count = 0;
+  for ( uint8_t i = 0; i < 8; ++i, byte >>= 1 )
+    {
+      uint8_t bit = byte & 0x01;
+      bits |= (uint32_t)bit << count++;
+
+      if ( !bit )
+        {
+          mOnes = 0;
+        }
+      else if ( ++mOnes == 5 )
+        {
+          // Insert a 0 right after this one
+          ++count;
+          mOnes = 0;
+        }
+    }
+
+  sendLevels(bits, count);
+}
+
+/**
+ * NRZI: a 0 is a transition and a 1 keeps the level. The level after bit i is the starting level,
+ * flipped once for every 0 in bits 0..i, which is a prefix XOR of the inverted bits.
+ */
+void HDLCEncoder::sendLevels(uint32_t bits, uint8_t count)
+{
+  uint32_t levels = ~bits;
+  levels ^= levels << 1;
+  levels ^= levels << 2;
+  levels ^= levels << 4;
+  levels ^= levels << 8;
+  levels ^= levels << 16;
+
+  if ( mLevel )
+    levels = ~levels;
+
+  if ( count < 32 )
+    levels &= (1UL << count) - 1;
+
+  mPacket->addBits(levels, count);
+  mLevel = (levels >> (count - 1)) & 0x01;
+}
@@ -85,14 +85,12 @@ void NMEAEncoder::encode(RXPacket &packet, vector<string> &sentences)
         sprintf(sentence, "!AIVDM,%d,%d,,%c,", numSentences, i, AIS_CHANNELS[packet.channel()].designation);
 
       k = strlen(sentence);
-      uint16_t sentenceBits = 0;
+      uint16_t sentenceBits = numBits - pos;
+      if ( sentenceBits > MAX_SENTENCE_BITS )
+        sentenceBits = MAX_SENTENCE_BITS;
 
-      for ( ; pos < numBits && sentenceBits < MAX_SENTENCE_BITS; pos += 6, sentenceBits += 6 )
-        {
-          uint8_t nmeaByte = (uint8_t)packet.bits(pos, 6);
-          nmeaByte += (nmeaByte < 40) ? 48 : 56;
-          sentence[k++] = nmeaByte;
-        }
+      k += armor(packet, pos, sentenceBits, sentence + k);
+      pos += sentenceBits;
 
       sentence[k++] = ',';
       if ( numSentences > 1 )
@@ -114,6 +112,32 @@ void NMEAEncoder::encode(RXPacket &packet, vector<string> &sentences)
 
 }
 
+/**
+ * Converts numBits (a multiple of 6) of the packet to AIVDM payload characters.
+ * Every 24 bits are fetched with a single read and turn into 4 characters.
+ */
+uint8_t NMEAEncoder::armor(const RXPacket &packet, uint16_t pos, uint16_t numBits, char *out)
+{
+  const char *ARMOR = Utils::SIX_BIT_ARMOR;
+
+  uint8_t k = 0;
+  uint16_t end = pos + numBits;
+
+  for ( ; pos + 24 <= end; pos += 24 )
+    {
+      uint32_t chunk = packet.bits(pos, 24);
+      out[k++] = ARMOR[(chunk >> 18) & 0x3f];
+      out[k++] = ARMOR[(chunk >> 12) & 0x3f];
+      out[k++] = ARMOR[(chunk >> 6) & 0x3f];
+      out[k++] = ARMOR[chunk & 0x3f];
+    }
+
+  for ( ; pos < end; pos += 6 )
+    out[k++] = ARMOR[packet.bits(pos, 6)];
+
+  return k;
+}
+
 uint8_t NMEAEncoder::nmeaCRC(const char* buff)
 {
   uint8_t p = 1;
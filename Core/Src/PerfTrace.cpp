@@ -0,0 +1,298 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include "PerfTrace.hpp"
+
+#if EVENT_LATENCY_TRACING
+
+#include "EventQueue.hpp"
+#include "Utils.hpp"
+#include <stdio.h>
+
+// Sentences emitted per clock tick while a report is in progress. The thread event pool only has 10.
+#define PERF_REPORT_BATCH         6
+
+PerfTrace &PerfTrace::instance()
+{
+  static PerfTrace __instance;
+  return __instance;
+}
+
+PerfTrace::PerfTrace()
+  : mConsumerCount(0), mUntracked(0), mCyclesPerUs(1), mReportCursor(-1)
+{
+  reset();
+}
+
+void PerfTrace::init()
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  mCyclesPerUs = SystemCoreClock / 1000000;
+  if ( mCyclesPerUs == 0 )
+    mCyclesPerUs = 1;
+
+  EventQueue::instance().addObserver(this, CLOCK_EVENT);
+}
+
+void PerfTrace::reset()
+{
+  memset(mEvents, 0, sizeof mEvents);
+  memset(mConsumerRuns, 0, sizeof mConsumerRuns);
+  memset(mConsumers, 0, sizeof mConsumers);
+  memset(&mBitClocks, 0, sizeof mBitClocks);
+  memset(&mRSSIReads, 0, sizeof mRSSIReads);
+  memset(&mByteAdds, 0, sizeof mByteAdds);
+  memset(&mTXEncodes, 0, sizeof mTXEncodes);
+  memset(&mRXDecodes, 0, sizeof mRXDecodes);
+  memset(&mRXNMEA, 0, sizeof mRXNMEA);
+  mConsumerCount = 0;
+  mUntracked = 0;
+}
+
+void PerfTrace::record(LatencyHistogram &h, uint32_t cycles)
+{
+  ++h.count;
+  h.totalCycles += cycles;
+  if ( cycles > h.maxCycles )
+    h.maxCycles = cycles;
+
+  uint32_t us = cycles / mCyclesPerUs;
+  uint32_t b = us < 2 ? 0 : 31 - __builtin_clz(us);
+  if ( b >= PERF_HISTOGRAM_BUCKETS )
+    b = PERF_HISTOGRAM_BUCKETS - 1;
+
+  if ( h.buckets[b] != 0xffff )
+    ++h.buckets[b];
+}
+
+void PerfTrace::consumerDone(EventConsumer *c, uint32_t enterCycles)
+{
+  uint32_t cycles = now() - enterCycles;
+
+  uint8_t i = 0;
+  while ( i < mConsumerCount && mConsumers[i] != c )
+    ++i;
+
+  if ( i == mConsumerCount )
+    {
+      if ( mConsumerCount == PERF_MAX_CONSUMERS )
+        {
+          ++mUntracked;
+          return;
+        }
+
+      mConsumers[mConsumerCount++] = c;
+    }
+
+  record(mConsumerRuns[i], cycles);
+}
+
+void PerfTrace::eventDone(const Event &e)
+{
+  if ( e.type == UNKNOWN_EVENT )
+    return;
+
+  uint32_t t = EVENT_TYPE_INDEX(e.type);
+  record(mEvents[t][FILL], e.pushCycles - e.allocCycles);
+  record(mEvents[t][WAIT], e.dispatchCycles - e.pushCycles);
+  record(mEvents[t][TOTAL], now() - e.allocCycles);
+}
+
+void PerfTrace::bitClock(uint32_t cycles)
+{
+  record(mBitClocks, cycles);
+}
+
+void PerfTrace::rssiRead(uint32_t cycles)
+{
+  record(mRSSIReads, cycles);
+}
+
+void PerfTrace::byteAdd(uint32_t cycles)
+{
+  record(mByteAdds, cycles);
+}
+
+void PerfTrace::txEncode(uint32_t cycles)
+{
+  record(mTXEncodes, cycles);
+}
+
+void PerfTrace::rxDecode(uint32_t cycles)
+{
+  record(mRXDecodes, cycles);
+}
+
+void PerfTrace::rxNMEA(uint32_t cycles)
+{
+  record(mRXNMEA, cycles);
+}
+
+bool PerfTrace::emit(const char *kind, uint32_t id, const char *metric, const LatencyHistogram &h, bool cycles)
+{
+  Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+  if ( !e )
+    return false;
+
+  // Leave room for the checksum and line ending appended by completeNMEA()
+  const size_t limit = sizeof e->nmeaBuffer.sentence - 6;
+  char *s = e->nmeaBuffer.sentence;
+
+  size_t n = snprintf(s, limit, "$PAIPRF,%s,%.8lx,%s,%lu,%lu,%lu",
+      kind,
+      id,
+      metric,
+      h.count,
+      (uint32_t)(h.totalCycles / h.count / (cycles ? 1 : mCyclesPerUs)),
+      h.maxCycles / (cycles ? 1 : mCyclesPerUs));
+
+  for ( uint8_t b = 0; b < PERF_HISTOGRAM_BUCKETS && n < limit; ++b )
+    n += snprintf(s + n, limit - n, ",%u", h.buckets[b]);
+
+  if ( n >= limit )
+    n = limit - 1;
+
+  strcpy(s + n, "*");
+  Utils::completeNMEA(s);
+  EventQueue::instance().push(e);
+  return true;
+}
+
+void PerfTrace::reportStats()
+{
+  mReportCursor = 0;
+  reportNext();
+}
+
+void PerfTrace::reportNext()
+{
+  static const char *metrics[METRIC_COUNT] = { "FILL", "WAIT", "TOTAL" };
+  const int16_t eventEntries = EVENT_TYPE_COUNT * METRIC_COUNT;
+
+  uint8_t sent = 0;
+  while ( mReportCursor >= 0 && sent < PERF_REPORT_BATCH )
+    {
+      int16_t i = mReportCursor;
+      if ( i < eventEntries )
+        {
+          const LatencyHistogram &h = mEvents[i / METRIC_COUNT][i % METRIC_COUNT];
+          if ( h.count )
+            {
+              if ( !emit("EVT", 1UL << (i / METRIC_COUNT), metrics[i % METRIC_COUNT], h) )
+                return;
+              ++sent;
+            }
+        }
+      else if ( i < eventEntries + mConsumerCount )
+        {
+          // Consumers are identified by object address, which can be looked up in the linker map
+          uint8_t c = i - eventEntries;
+          if ( !emit("CON", (uint32_t)mConsumers[c], "RUN", mConsumerRuns[c]) )
+            return;
+          ++sent;
+        }
+      else if ( i == eventEntries + mConsumerCount )
+        {
+          if ( mBitClocks.count )
+            {
+              if ( !emit("ISR", 0, "BITCLK", mBitClocks, true) )
+                return;
+              ++sent;
+            }
+        }
+      else if ( i == eventEntries + mConsumerCount + 1 )
+        {
+          if ( mRSSIReads.count )
+            {
+              if ( !emit("ISR", 0, "RSSI", mRSSIReads) )
+                return;
+              ++sent;
+            }
+        }
+      else if ( i == eventEntries + mConsumerCount + 2 )
+        {
+          if ( mTXEncodes.count )
+            {
+              if ( !emit("TX", 0, "ENCODE", mTXEncodes) )
+                return;
+              ++sent;
+            }
+        }
+      else if ( i == eventEntries + mConsumerCount + 3 )
+        {
+          if ( mRXDecodes.count )
+            {
+              if ( !emit("RX", 0, "DECODE", mRXDecodes) )
+                return;
+              ++sent;
+            }
+        }
+      else if ( i == eventEntries + mConsumerCount + 4 )
+        {
+          if ( mByteAdds.count )
+            {
+              if ( !emit("ISR", 0, "ADDBYTE", mByteAdds, true) )
+                return;
+              ++sent;
+            }
+        }
+      else if ( i == eventEntries + mConsumerCount + 5 )
+        {
+          if ( mRXNMEA.count )
+            {
+              if ( !emit("RX", 0, "NMEA", mRXNMEA) )
+                return;
+              ++sent;
+            }
+        }
+      else
+        {
+          Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+          if ( !e )
+            return;
+
+          sprintf(e->nmeaBuffer.sentence, "$PAIPRF,END,%lu,%lu*", mCyclesPerUs, mUntracked);
+          Utils::completeNMEA(e->nmeaBuffer.sentence);
+          EventQueue::instance().push(e);
+          mReportCursor = -1;
+          return;
+        }
+
+      ++mReportCursor;
+    }
+}
+
+void PerfTrace::processEvent(const Event &e)
+{
+  switch(e.type)
+  {
+  case CLOCK_EVENT:
+    if ( mReportCursor >= 0 )
+      reportNext();
+    break;
+  default:
+    break;
+  }
+}
+
+#endif
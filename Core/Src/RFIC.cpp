@@ -19,12 +19,22 @@
 
 
 #include "RFIC.hpp"
+#include "config.h"
 #include "radio_config.h"
 #include "Utils.hpp"
 #include "EZRadioPRO.h"
 #include <string.h>
 #include "bsp/bsp.hpp"
 #include "Configuration.hpp"
+#include "SPIBus.hpp"
+#include "RadioConfigDelta.hpp"
+#include "TXPacket.hpp"
+#include "AISChannels.h"
+
+#if TX_FIFO_MODE
+// The TX FIFO is not shared with the RX FIFO
+#define TX_FIFO_SIZE          64
+#endif
 
 RFIC::RFIC(GPIO_TypeDef *sdnPort,
     uint32_t sdnPin,
@@ -48,153 +58,235 @@ RFIC::RFIC(GPIO_TypeDef *sdnPort,
   mClockPin = clockPin;
 
   mChipID = chipID;
-
-  if ( !isInitialized() )
-    {
-      mPORSuccess = powerOnReset();
-    }
-  else
-    mPORSuccess = true;
-
 }
 
 RFIC::~RFIC()
 {
 }
 
-inline void RFIC::spiOn()
+bool RFIC::isResponsive()
 {
-  HAL_GPIO_WritePin(mCSPort, mCSPin, GPIO_PIN_RESET);
+  return mPORSuccess;
 }
 
-inline void RFIC::spiOff()
+/**
+ * Blocks until the chip has responded. This is safe from the main loop and from any interrupt,
+ * since the bus is shared with the other RF IC through the SPIBus queue.
+ * Returns false if the chip never reported CTS, in which case the result is not filled in.
+ */
+bool RFIC::sendCmd(uint8_t cmd, void* params, uint8_t paramLen, void* result, uint8_t resultLen)
 {
-  HAL_GPIO_WritePin(mCSPort, mCSPin, GPIO_PIN_SET);
+  return SPIBus::instance().execute(mCSPort, mCSPin, cmd, params, paramLen, result, resultLen, true);
 }
 
-bool RFIC::isResponsive()
+/**
+ * Returns as soon as the command is queued, and the bus is free again as soon as it has been clocked out.
+ * The next command to this chip waits for its CTS first.
+ */
+bool RFIC::sendCmdNoWait(uint8_t cmd, void* params, uint8_t paramLen)
 {
-  return mPORSuccess;
+  SPIBus::instance().post(mCSPort, mCSPin, cmd, params, paramLen);
+  return true;
 }
 
-bool RFIC::sendCmd(uint8_t cmd, void* params, uint8_t paramLen, void* result, uint8_t resultLen)
+/**
+ * Unless RadioManager has just streamed the configuration array (see continueConfiguration()), it is sent here,
+ * waiting for each command to complete.
+ */
+void RFIC::configure()
 {
-  if ( mCTSPending )
+  if ( !mConfigStreamed )
     {
-      while ( readSPIResponse(NULL, 0) == false)
+      startConfiguration();
+      while ( !continueConfiguration() )
         ;
-      mCTSPending = false;
     }
+  mConfigStreamed = false;
 
-  //bsp_signal_high();
-  spiOn();
-
-  bsp_tx_spi_byte(cmd);
-
-  if ( params )
+  if ( Configuration::instance().isXOTrimmed() )
     {
-      uint8_t *b = (uint8_t*) params;
-      for ( int i = 0; i < paramLen; ++i )
-        {
-          bsp_tx_spi_byte(b[i]);
-        }
+      setXOTrimValue(Configuration::instance().getXOTrimValue());
     }
-  spiOff();
-  //bsp_signal_low();
 
-  //bsp_signal_high();
-  while ( readSPIResponse(result, resultLen) == false)
-    ;
-
-  //bsp_signal_low();
-  return true;
+#if FAST_RSSI
+  configureFastRSSI();
+#endif
 }
 
-bool RFIC::sendCmdNoWait(uint8_t cmd, void* params, uint8_t paramLen)
+void RFIC::holdInReset()
 {
-  if ( mCTSPending )
-    {
-      while ( readSPIResponse(NULL, 0) == false)
-        ;
-      mCTSPending = false;
-    }
-
-  spiOn();
-
-  bsp_tx_spi_byte(cmd);
-
-  uint8_t *b = (uint8_t*) params;
-  for ( int i = 0; i < paramLen; ++i )
-    {
-      bsp_tx_spi_byte(b[i]);
-    }
-  spiOff();
-  mCTSPending = true;
-
-  return true;
+  mPORSuccess = false;
+  mConfigCursor = nullptr;
+  mConfigStreamed = false;
+  HAL_GPIO_WritePin(mSDNP, mSDNPin, GPIO_PIN_SET);
 }
 
+void RFIC::releaseReset()
+{
+  HAL_GPIO_WritePin(mSDNP, mSDNPin, GPIO_PIN_RESET);
+}
 
-// This is borrowed from the dAISy project. Thank you Adrian :)
-bool RFIC::readSPIResponse(void *data, uint8_t length)
+/**
+ * GPIO1 (our data pin) is CTS after a power on reset, so it goes high when the chip is ready for POWER_UP
+ */
+bool RFIC::checkPOR()
 {
-  spiOn();
-  bsp_tx_spi_byte(0x44);
-  if ( bsp_tx_spi_byte(0) != 0xff )
-    {
-      spiOff();
-      return false;
-    }
+  if ( HAL_GPIO_ReadPin(mDataPort, mDataPin) == GPIO_PIN_SET )
+    mPORSuccess = true;
 
-  if ( data )
-    {
-      uint8_t* b = (uint8_t*) data;
-      uint8_t i = 0;
-      while (i < length)
-        {
-          b[i] = bsp_tx_spi_byte(0);
-          ++i;
-        }
-    }
+  return mPORSuccess;
+}
 
-  spiOff();
-  return true;
+/**
+ * A single CTS poll. It doesn't wait, so the other chip can be kept busy in the meantime.
+ */
+bool RFIC::isReady()
+{
+  uint8_t cts = 0;
+  SPIBus::instance().execute(mCSPort, mCSPin, READ_CMD_BUFFER, NULL, 0, &cts, 1, false);
+  return cts == 0xFF;
 }
 
-void RFIC::configure()
+void RFIC::startConfiguration()
 {
   PART_INFO_REPLY reply;
   sendCmd(PART_INFO, nullptr, 0, &reply, sizeof reply);
   mPartNumber = reply.PartNumberH << 8 | reply.PartNumberL;
 
-  uint8_t *radio_configuration = nullptr;
   switch(mPartNumber)
   {
   case 0x4467:
-    radio_configuration = get_si4467_config_array();
+    mConfigCursor = get_si4467_config_array();
     break;
   case 0x4460:
-    radio_configuration = get_si4460_config_array();
+    mConfigCursor = get_si4460_config_array();
     break;
   default:
-    radio_configuration = get_si4463_config_array();
+    mConfigCursor = get_si4463_config_array();
   }
 
-  uint8_t *cfg = radio_configuration;
-  while (*cfg)
-    {                              // configuration array stops with 0
-      uint8_t count = (*cfg++) - 1;           // 1st byte: number of bytes, incl. command
-      uint8_t cmd = *cfg++;                   // 2nd byte: command
-      sendCmd(cmd, cfg, count, NULL, 0);      // send bytes to chip
-      cfg += count;                           // point at next line
+  mConfigDelta = mConfigCursor + radioConfigDeltaProperties(mConfigCursor);
+  mConfigPart = 0;
+  mLastCommand = 0;
+  mPoweredUp = false;
+  mConfigStreamed = false;
+}
+
+/**
+ * Sends the next command of the configuration array once the chip has processed the previous one.
+ * Returns true when the whole array has been processed.
+ */
+bool RFIC::continueConfiguration()
+{
+  if ( !mConfigCursor )
+    return true;
+
+  if ( !isReady() )
+    return false;
+
+  // The patch (if any) comes before POWER_UP, so this is where it has been applied
+  if ( mLastCommand == POWER_UP )
+    mPoweredUp = true;
+
+  // The chip's own commands, the common properties and the chip's own properties each stop with 0
+  while ( *mConfigCursor == 0 )
+    {
+      if ( mConfigPart == 2 )
+        {
+          mConfigCursor = nullptr;
+          mConfigStreamed = true;
+          return true;
+        }
+
+      mConfigCursor = ++mConfigPart == 1 ? RADIO_CONFIG_BASE : mConfigDelta;
     }
 
-  if ( Configuration::instance().isXOTrimmed() )
+  uint8_t count = (*mConfigCursor++) - 1;     // 1st byte: number of bytes, incl. command
+  uint8_t cmd = *mConfigCursor++;             // 2nd byte: command
+  SPIBus::instance().execute(mCSPort, mCSPin, cmd, mConfigCursor, count, NULL, 0, false);
+  mConfigCursor += count;                     // point at next line
+  mLastCommand = cmd;
+
+  return false;
+}
+
+bool RFIC::poweredUp()
+{
+  return mPoweredUp;
+}
+
+/**
+ * Fast response register A reports the latched RSSI, and the RSSI is set not to latch. Fast response registers
+ * are read without a command or CTS. Not yet checked against GET_MODEM_STATUS on hardware.
+ */
+void RFIC::configureFastRSSI()
+{
+  SET_PROPERTY_PARAMS p;
+  p.Group = 0x20;
+  p.NumProperties = 1;
+  p.StartProperty = 0x4C;
+  p.Data[0] = 0x08;           // MODEM_RSSI_CONTROL: no latching
+  sendCmd(SET_PROPERTY, &p, 4, NULL, 0);
+
+  p.Group = 0x02;
+  p.NumProperties = 1;
+  p.StartProperty = 0x00;
+  p.Data[0] = 0x0A;           // FRR_CTL_A_MODE: LATCHED_RSSI
+  sendCmd(SET_PROPERTY, &p, 4, NULL, 0);
+}
+
+#if TX_FIFO_MODE
+
+/**
+ * The frame goes into the TX FIFO as soon as it is assigned, so starting the transmission from the bit clock
+ * interrupt takes no more SPI traffic than before. The FIFO's almost empty threshold (in free bytes) is set
+ * so the clock pin goes high as the byte with the ramp down bit starts going out.
+ */
+void RFIC::loadTXFIFO(TXPacket *p)
+{
+  uint8_t reset = 0x01;       // TX FIFO only
+  sendCmd(FIFO_INFO, &reset, 1, NULL, 0);
+
+  const uint8_t *data = p->data();
+  uint8_t size = p->dataSize();
+  for ( uint8_t i = 0; i < size; i += SPI_MAX_COMMAND - 1 )
     {
-      setXOTrimValue(Configuration::instance().getXOTrimValue());
+      uint8_t len = size - i < SPI_MAX_COMMAND - 1 ? size - i : SPI_MAX_COMMAND - 1;
+      SPIBus::instance().execute(mCSPort, mCSPin, WRITE_TX_FIFO, data + i, len, NULL, 0, false);
     }
+
+  if ( p->isTestPacket() )
+    return;
+
+  SET_PROPERTY_PARAMS prop;
+  prop.Group = 0x12;
+  prop.NumProperties = 1;
+  prop.StartProperty = 0x0B;  // PKT_TX_THRESHOLD
+  prop.Data[0] = TX_FIFO_SIZE - (size - 1 - p->rampDownBit() / 8);
+  sendCmd(SET_PROPERTY, &prop, 4, NULL, 0);
 }
 
+/**
+ * Sends the frame loaded by loadTXFIFO() and returns to RX when it's done.
+ */
+void RFIC::startFIFOTX(TXPacket *p)
+{
+  TX_OPTIONS options;
+  uint16_t fifoBits   = p->dataSize() * 8;
+  options.channel     = AIS_CHANNELS[p->channel()].ordinal;
+  options.condition   = 8 << 4;                           // Back to RX when done, so RX_STATE goes high
+  options.tx_len      = __REV16(p->dataSize());           // Big endian
+  options.tx_delay    = 0;
+
+  // A test packet doesn't fit in the FIFO, so the same random bytes go out as many times as it takes
+  uint16_t repeats    = p->isTestPacket() ? (p->size() + fifoBits - 1) / fifoBits - 1 : 0;
+  options.repeats     = repeats < 255 ? repeats : 255;
+
+  sendCmd(START_TX, &options, sizeof options, NULL, 0);
+}
+
+#endif
+
 void RFIC::setXOTrimValue(uint8_t value)
 {
   SET_PROPERTY_PARAMS params = {0};
@@ -212,47 +304,20 @@ uint16_t RFIC::partNumber()
   return mPartNumber;
 }
 
-bool RFIC::isInitialized()
-{
-  HAL_GPIO_WritePin(mSDNP, mSDNPin, GPIO_PIN_SET);
-  HAL_Delay(10);
-  HAL_GPIO_WritePin(mSDNP, mSDNPin, GPIO_PIN_RESET);
-  HAL_Delay(100);
-
-  CHIP_STATUS_REPLY chip_status;
-  memset(&chip_status, 0, sizeof chip_status);
-  sendCmd(GET_CHIP_STATUS, NULL, 0, &chip_status, sizeof chip_status);
-  if ( chip_status.Current & 0x08 )
-    {
-      return false;
-    }
-  else
-    {
-      return true;
-    }
-}
+#if FAST_RSSI
 
-bool RFIC::powerOnReset()
+/**
+ * A single 2 byte transaction. Fast response registers don't need CTS.
+ */
+uint8_t RFIC::readRSSI()
 {
-  // Pull SDN high to shut down the IC
-  HAL_GPIO_WritePin(mSDNP, mSDNPin, GPIO_PIN_SET);
-
-  // Wait at least 10 microseconds
-  HAL_Delay(1);
-
-  // Pull SDN low and poll the status of GPIO1
-  HAL_GPIO_WritePin(mSDNP, mSDNPin, GPIO_PIN_RESET);
-
-  uint32_t start = HAL_GetTick();
-  while ( HAL_GetTick() - start < 1000 )
-    {
-      if ( HAL_GPIO_ReadPin(mDataPort, mDataPin) == GPIO_PIN_SET )
-        return true;
-    }
-
-  return false;
+  uint8_t rssi = 0;
+  SPIBus::instance().execute(mCSPort, mCSPin, FRR_A_READ, NULL, 0, &rssi, 1, false);
+  return rssi;
 }
 
+#else
+
 /**
  * This exhibits a lot of jitter, occassionally taking more than 100us to return
  */
@@ -269,10 +334,14 @@ uint8_t RFIC::readRSSI()
     }
 }
 
+#endif
+
 bool RFIC::checkStatus()
 {
   DEVICE_STATE s;
-  sendCmd(REQ_DEVICE_STATE, NULL, 0, &s, sizeof s);
+  if ( !sendCmd(REQ_DEVICE_STATE, NULL, 0, &s, sizeof s) )
+    return false;
+
   if ( s.state != 8 && s.state != 7 )
     return false;
   else
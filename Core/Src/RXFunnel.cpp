@@ -0,0 +1,184 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include "RXFunnel.hpp"
+#include "EventQueue.hpp"
+#include "Utils.hpp"
+#include <stdio.h>
+#include <string.h>
+
+// Every payload character carries 3 slots (2 bits each), so a sentence covers 180 slots
+#define RX_MAP_SLOTS_PER_SENTENCE     180
+#define RX_MAP_SENTENCES              ((RX_FUNNEL_SLOTS + RX_MAP_SLOTS_PER_SENTENCE - 1) / RX_MAP_SLOTS_PER_SENTENCE)
+
+// Sentences emitted per clock tick while the map is being dumped. The thread event pool only has 10.
+#define RX_MAP_BATCH                  6
+
+// Slot map marks
+#define RX_SLOT_GOOD                  0x01
+#define RX_SLOT_FAILED                0x02
+
+static const char __designations[RX_FUNNEL_CHANNELS] = { 'A', 'B', '?' };
+
+static inline uint8_t funnelIndex(VHFChannel channel)
+{
+  switch(AIS_CHANNELS[channel].designation)
+  {
+  case 'A':
+    return 0;
+  case 'B':
+    return 1;
+  default:
+    return 2;
+  }
+}
+
+RXFunnel &RXFunnel::instance()
+{
+  static RXFunnel __instance;
+  return __instance;
+}
+
+RXFunnel::RXFunnel()
+  : mMapCursor(-1)
+{
+  memset(mCounters, 0, sizeof mCounters);
+  memset(mSlotMap, 0, sizeof mSlotMap);
+}
+
+void RXFunnel::init()
+{
+  EventQueue::instance().addObserver(this, CLOCK_EVENT);
+}
+
+void RXFunnel::count(VHFChannel channel, RXFunnelStage stage)
+{
+  ++mCounters[funnelIndex(channel)][stage];
+}
+
+void RXFunnel::markSlot(VHFChannel channel, uint32_t slot, bool good)
+{
+  uint8_t c = funnelIndex(channel);
+  if ( c >= RX_FUNNEL_MAP_CHANNELS || slot >= RX_FUNNEL_SLOTS )
+    return;
+
+  uint8_t mark = (good ? RX_SLOT_GOOD : RX_SLOT_FAILED) << ((slot % 4) * 2);
+  __atomic_fetch_or(&mSlotMap[c][slot / 4], mark, __ATOMIC_RELAXED);
+}
+
+void RXFunnel::clearSlot(VHFChannel channel, uint32_t slot)
+{
+  uint8_t c = funnelIndex(channel);
+  if ( c >= RX_FUNNEL_MAP_CHANNELS || slot >= RX_FUNNEL_SLOTS )
+    return;
+
+  uint8_t mask = ~(0x03 << ((slot % 4) * 2));
+  __atomic_fetch_and(&mSlotMap[c][slot / 4], mask, __ATOMIC_RELAXED);
+}
+
+void RXFunnel::reportStats()
+{
+  for ( uint8_t c = 0; c < RX_FUNNEL_CHANNELS; ++c )
+    {
+      Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+      if ( !e )
+        return;
+
+      const uint32_t *n = mCounters[c];
+      sprintf(e->nmeaBuffer.sentence, "$PAIRXF,%c,%lu,%lu,%lu,%lu,%lu,%lu,%lu*",
+          __designations[c],
+          n[RX_FUNNEL_PREAMBLE],
+          n[RX_FUNNEL_STUFFING_ABORT],
+          n[RX_FUNNEL_OVERSIZE_ABORT],
+          n[RX_FUNNEL_RUNT],
+          n[RX_FUNNEL_CRC_FAIL],
+          n[RX_FUNNEL_CRC_PASS],
+          n[RX_FUNNEL_POOL_DROP]);
+
+      Utils::completeNMEA(e->nmeaBuffer.sentence);
+      EventQueue::instance().push(e);
+    }
+}
+
+void RXFunnel::reportMap()
+{
+  mMapCursor = 0;
+  reportNextMapChunk();
+}
+
+/**
+ * Each $PAIRXM sentence has the channel, the first slot it covers and up to 60 characters of 6-bit armored
+ * payload (as in !AIVDM). Every character holds 3 consecutive slots, the earliest in its 2 most significant bits.
+ */
+void RXFunnel::reportNextMapChunk()
+{
+  uint8_t sent = 0;
+  while ( mMapCursor >= 0 && sent < RX_MAP_BATCH )
+    {
+      if ( mMapCursor >= RX_FUNNEL_MAP_CHANNELS * RX_MAP_SENTENCES )
+        {
+          mMapCursor = -1;
+          return;
+        }
+
+      Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+      if ( !e )
+        return;
+
+      uint8_t c = mMapCursor / RX_MAP_SENTENCES;
+      uint16_t first = (mMapCursor % RX_MAP_SENTENCES) * RX_MAP_SLOTS_PER_SENTENCE;
+      uint16_t last = first + RX_MAP_SLOTS_PER_SENTENCE;
+      if ( last > RX_FUNNEL_SLOTS )
+        last = RX_FUNNEL_SLOTS;
+
+      char *s = e->nmeaBuffer.sentence;
+      int n = sprintf(s, "$PAIRXM,%c,%u,", __designations[c], first);
+      for ( uint16_t slot = first; slot < last; slot += 3 )
+        {
+          uint8_t value = 0;
+          for ( uint16_t i = slot; i < slot + 3; ++i )
+            {
+              uint8_t mark = i < RX_FUNNEL_SLOTS ? (mSlotMap[c][i / 4] >> ((i % 4) * 2)) & 0x03 : 0;
+              value = (value << 2) | mark;
+            }
+          s[n++] = Utils::SIX_BIT_ARMOR[value];
+        }
+
+      strcpy(s + n, "*");
+      Utils::completeNMEA(s);
+      EventQueue::instance().push(e);
+
+      ++mMapCursor;
+      ++sent;
+    }
+}
+
+void RXFunnel::processEvent(const Event &e)
+{
+  switch(e.type)
+  {
+  case CLOCK_EVENT:
+    if ( mMapCursor >= 0 )
+      reportNextMapChunk();
+    break;
+  default:
+    break;
+  }
+}
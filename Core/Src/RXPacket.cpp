@@ -21,9 +21,119 @@
 #include <cassert>
 #include <cstring>
 #include "RXPacket.hpp"
+#include "Utils.hpp"
 
 //#define memcpy my_on_steroids_memcpy
 
+// What the CRC register holds after a good frame, including its own (inverted) CRC, has gone through it
+#define CRC16_X25_RESIDUE         0xf0b8
+
+#if RX_CRC_CORRECTION
+/*
+ * CRC syndromes of single bit errors. Entry d is how the final CRC register changes when the bit
+ * received d bits before the end of the frame (CRC included) is flipped. The CRC is linear, so a
+ * 2 bit error produces the XOR of 2 entries. The polynomial's period (32767) keeps all entries distinct.
+ */
+static const uint16_t CRC16_X25_SYNDROMES[MAX_AIS_RX_PACKET_SIZE] = {
+    0x8408, 0x4204, 0x2102, 0x1081, 0x8c48, 0x4624, 0x2312, 0x1189,
+    0x8ccc, 0x4666, 0x2333, 0x9591, 0xcec0, 0x6760, 0x33b0, 0x19d8,
+    0x0cec, 0x0676, 0x033b, 0x8595, 0xc6c2, 0x6361, 0xb5b8, 0x5adc,
+    0x2d6e, 0x16b7, 0x8f53, 0xc3a1, 0xe5d8, 0x72ec, 0x3976, 0x1cbb,
+    0x8a55, 0xc122, 0x6091, 0xb440, 0x5a20, 0x2d10, 0x1688, 0x0b44,
+    0x05a2, 0x02d1, 0x8560, 0x42b0, 0x2158, 0x10ac, 0x0856, 0x042b,
+    0x861d, 0xc706, 0x6383, 0xb5c9, 0xdeec, 0x6f76, 0x37bb, 0x9fd5,
+    0xcbe2, 0x65f1, 0xb6f0, 0x5b78, 0x2dbc, 0x16de, 0x0b6f, 0x81bf,
+    0xc4d7, 0xe663, 0xf739, 0xff94, 0x7fca, 0x3fe5, 0x9bfa, 0x4dfd,
+    0xa2f6, 0x517b, 0xacb5, 0xd252, 0x6929, 0xb09c, 0x584e, 0x2c27,
+    0x921b, 0xcd05, 0xe28a, 0x7145, 0xbcaa, 0x5e55, 0xab22, 0x5591,
+    0xaec0, 0x5760, 0x2bb0, 0x15d8, 0x0aec, 0x0576, 0x02bb, 0x8555,
+    0xc6a2, 0x6351, 0xb5a0, 0x5ad0, 0x2d68, 0x16b4, 0x0b5a, 0x05ad,
+    0x86de, 0x436f, 0xa5bf, 0xd6d7, 0xef63, 0xf3b9, 0xfdd4, 0x7eea,
+    0x3f75, 0x9bb2, 0x4dd9, 0xa2e4, 0x5172, 0x28b9, 0x9054, 0x482a,
+    0x2415, 0x9602, 0x4b01, 0xa188, 0x50c4, 0x2862, 0x1431, 0x8e10,
+    0x4708, 0x2384, 0x11c2, 0x08e1, 0x8078, 0x403c, 0x201e, 0x100f,
+    0x8c0f, 0xc20f, 0xe50f, 0xf68f, 0xff4f, 0xfbaf, 0xf9df, 0xf8e7,
+    0xf87b, 0xf835, 0xf812, 0x7c09, 0xba0c, 0x5d06, 0x2e83, 0x9349,
+    0xcdac, 0x66d6, 0x336b, 0x9dbd, 0xcad6, 0x656b, 0xb6bd, 0xdf56,
+    0x6fab, 0xb3dd, 0xdde6, 0x6ef3, 0xb371, 0xddb0, 0x6ed8, 0x376c,
+    0x1bb6, 0x0ddb, 0x82e5, 0xc57a, 0x62bd, 0xb556, 0x5aab, 0xa95d,
+    0xd0a6, 0x6853, 0xb021, 0xdc18, 0x6e0c, 0x3706, 0x1b83, 0x89c9,
+    0xc0ec, 0x6076, 0x303b, 0x9c15, 0xca02, 0x6501, 0xb688, 0x5b44,
+    0x2da2, 0x16d1, 0x8f60, 0x47b0, 0x23d8, 0x11ec, 0x08f6, 0x047b,
+    0x8635, 0xc712, 0x6389, 0xb5cc, 0x5ae6, 0x2d73, 0x92b1, 0xcd50,
+    0x66a8, 0x3354, 0x19aa, 0x0cd5, 0x8262, 0x4131, 0xa490, 0x5248,
+    0x2924, 0x1492, 0x0a49, 0x812c, 0x4096, 0x204b, 0x942d, 0xce1e,
+    0x670f, 0xb78f, 0xdfcf, 0xebef, 0xf1ff, 0xfcf7, 0xfa73, 0xf931,
+    0xf890, 0x7c48, 0x3e24, 0x1f12, 0x0f89, 0x83cc, 0x41e6, 0x20f3,
+    0x9471, 0xce30, 0x6718, 0x338c, 0x19c6, 0x0ce3, 0x8279, 0xc534,
+    0x629a, 0x314d, 0x9cae, 0x4e57, 0xa323, 0xd599, 0xeec4, 0x7762,
+    0x3bb1, 0x99d0, 0x4ce8, 0x2674, 0x133a, 0x099d, 0x80c6, 0x4063,
+    0xa439, 0xd614, 0x6b0a, 0x3585, 0x9eca, 0x4f65, 0xa3ba, 0x51dd,
+    0xace6, 0x5673, 0xaf31, 0xd390, 0x69c8, 0x34e4, 0x1a72, 0x0d39,
+    0x8294, 0x414a, 0x20a5, 0x945a, 0x4a2d, 0xa11e, 0x508f, 0xac4f,
+    0xd22f, 0xed1f, 0xf287, 0xfd4b, 0xfaad, 0xf95e, 0x7caf, 0xba5f,
+    0xd927, 0xe89b, 0xf045, 0xfc2a, 0x7e15, 0xbb02, 0x5d81, 0xaac8,
+    0x5564, 0x2ab2, 0x1559, 0x8ea4, 0x4752, 0x23a9, 0x95dc, 0x4aee,
+    0x2577, 0x96b3, 0xcf51, 0xe3a0, 0x71d0, 0x38e8, 0x1c74, 0x0e3a,
+    0x071d, 0x8786, 0x43c3, 0xa5e9, 0xd6fc, 0x6b7e, 0x35bf, 0x9ed7,
+    0xcb63, 0xe1b9, 0xf4d4, 0x7a6a, 0x3d35, 0x9a92, 0x4d49, 0xa2ac,
+    0x5156, 0x28ab, 0x905d, 0xcc26, 0x6613, 0xb701, 0xdf88, 0x6fc4,
+    0x37e2, 0x1bf1, 0x89f0, 0x44f8, 0x227c, 0x113e, 0x089f, 0x8047,
+    0xc42b, 0xe61d, 0xf706, 0x7b83, 0xb9c9, 0xd8ec, 0x6c76, 0x363b,
+    0x9f15, 0xcb82, 0x65c1, 0xb6e8, 0x5b74, 0x2dba, 0x16dd, 0x8f66,
+    0x47b3, 0xa7d1, 0xd7e0, 0x6bf0, 0x35f8, 0x1afc, 0x0d7e, 0x06bf,
+    0x8757, 0xc7a3, 0xe7d9, 0xf7e4, 0x7bf2, 0x3df9, 0x9af4, 0x4d7a,
+    0x26bd, 0x9756, 0x4bab, 0xa1dd, 0xd4e6, 0x6a73, 0xb131, 0xdc90,
+    0x6e48, 0x3724, 0x1b92, 0x0dc9, 0x82ec, 0x4176, 0x20bb, 0x9455,
+    0xce22, 0x6711, 0xb780, 0x5bc0, 0x2de0, 0x16f0, 0x0b78, 0x05bc,
+    0x02de, 0x016f, 0x84bf, 0xc657, 0xe723, 0xf799, 0xffc4, 0x7fe2,
+    0x3ff1, 0x9bf0, 0x4df8, 0x26fc, 0x137e, 0x09bf, 0x80d7, 0xc463,
+    0xe639, 0xf714, 0x7b8a, 0x3dc5, 0x9aea, 0x4d75, 0xa2b2, 0x5159,
+    0xaca4, 0x5652, 0x2b29, 0x919c, 0x48ce, 0x2467, 0x963b, 0xcf15,
+    0xe382, 0x71c1, 0xbce8, 0x5e74, 0x2f3a, 0x179d, 0x8fc6, 0x47e3,
+    0xa7f9, 0xd7f4, 0x6bfa, 0x35fd, 0x9ef6, 0x4f7b, 0xa3b5, 0xd5d2,
+    0x6ae9, 0xb17c, 0x58be, 0x2c5f, 0x9227, 0xcd1b, 0xe285, 0xf54a,
+    0x7aa5, 0xb95a, 0x5cad, 0xaa5e, 0x552f, 0xae9f, 0xd347, 0xedab,
+    0xf2dd, 0xfd66, 0x7eb3, 0xbb51, 0xd9a0, 0x6cd0, 0x3668, 0x1b34,
+    0x0d9a, 0x06cd, 0x876e, 0x43b7, 0xa5d3, 0xd6e1, 0xef78, 0x77bc,
+    0x3bde, 0x1def, 0x8aff, 0xc177, 0xe4b3, 0xf651, 0xff20, 0x7f90,
+    0x3fc8, 0x1fe4, 0x0ff2, 0x07f9, 0x87f4, 0x43fa, 0x21fd, 0x94f6,
+    0x4a7b, 0xa135, 0xd492, 0x6a49, 0xb12c, 0x5896, 0x2c4b, 0x922d,
+};
+#endif
+
+#if !defined(__ARM_ARCH_7EM__)
+static const uint8_t REVERSED_BITS_TABLE[] = {
+    0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0, 0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
+    0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8, 0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
+    0x04, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4, 0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
+    0x0c, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec, 0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
+    0x02, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2, 0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
+    0x0a, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea, 0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
+    0x06, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6, 0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
+    0x0e, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee, 0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
+    0x01, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x61, 0xe1, 0x11, 0x91, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
+    0x09, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x69, 0xe9, 0x19, 0x99, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
+    0x05, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x65, 0xe5, 0x15, 0x95, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
+    0x0d, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x6d, 0xed, 0x1d, 0x9d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
+    0x03, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x63, 0xe3, 0x13, 0x93, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
+    0x0b, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x6b, 0xeb, 0x1b, 0x9b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
+    0x07, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x67, 0xe7, 0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
+    0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef, 0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
+};
+#endif
+
+static inline uint8_t reverseBits(uint8_t byte)
+{
+#if defined(__ARM_ARCH_7EM__)
+  uint32_t result;
+  asm("rbit %0, %1" : "=r" (result) : "r" ((uint32_t)byte));
+  return result >> 24;
+#else
+  return REVERSED_BITS_TABLE[byte];
+#endif
+}
+
 
 RXPacket::RXPacket ()
 {
@@ -81,7 +191,7 @@ RXPacket &RXPacket::operator =(const RXPacket &copy)
 
 void RXPacket::reset()
 {
-  mState = {{0}, 0, 0xffff, 0, 0, 0, 0xffffffff, CH_18, 0};
+  mState = {{0}, 0, 0xffff, false, 0, 0, 0, 0xffffffff, CH_18, 0, 0, false};
 #if 0
   mType = 0;
   mRI = 0;
@@ -115,13 +225,36 @@ uint8_t RXPacket::rssi() const
   return mState.mRSSI;
 }
 
+void RXPacket::setSyncErrors(uint8_t errors)
+{
+  mState.mSyncErrors = errors;
+}
+
+uint8_t RXPacket::syncErrors() const
+{
+  return mState.mSyncErrors;
+}
+
+void RXPacket::setCollision(bool collision)
+{
+  mState.mCollision = collision;
+}
+
+bool RXPacket::collision() const
+{
+  return mState.mCollision;
+}
+
 
+/*
+ * Bits are stored MSB first, in the order they appear in the AIS message
+ */
 void RXPacket::addBit(uint8_t bit)
 {
   //ASSERT(mSize < MAX_AIS_RX_PACKET_SIZE);
 
   uint16_t index = mState.mSize / 8;
-  uint8_t offset = mState.mSize % 8;
+  uint8_t offset = 7 - mState.mSize % 8;
 
   if ( bit )
     mState.mPacket[index] |= ( 1 << offset );
@@ -135,58 +268,62 @@ uint8_t RXPacket::bit(uint16_t pos) const
 {
   if ( pos < mState.mSize ) {
       uint16_t index = pos / 8;
-      uint8_t offset = pos % 8;
+      uint8_t offset = 7 - pos % 8;
 
-      return (mState.mPacket[index] & (1 << offset)) != 0;
+      return (mState.mPacket[index] >> offset) & 0x01;
   }
   else
     return 0;
 }
 
+/**
+ * Fields are extracted with a single (unaligned) word load, plus one more byte when a 32 bit field
+ * straddles 5 bytes. As with bit(), anything past the end of the packet reads as 0.
+ */
 uint32_t RXPacket::bits(uint16_t pos, uint8_t count) const
 {
   ASSERT(count <= 32);
-  uint32_t result = 0;
+  if ( count == 0 || pos >= mState.mSize )
+    return 0;
 
-  for ( uint16_t i = pos; i < pos+count; ++i ) {
-      result <<= 1;
-      result |= bit(i);
-  }
+  uint8_t valid = count;
+  if ( pos + count > mState.mSize )
+    valid = mState.mSize - pos;
 
-  return result;
-}
+  const uint8_t *p = mState.mPacket + pos / 8;
+  uint8_t offset = pos % 8;
 
-void RXPacket::addBitCRC(uint8_t data)
-{
-  if ( (data ^ mState.mCRC) & 0x0001 )
-    mState.mCRC = (mState.mCRC >> 1) ^ 0x8408;
-  else
-    mState.mCRC >>= 1;
+  uint32_t word;
+  memcpy(&word, p, sizeof word);
+  uint32_t result = __builtin_bswap32(word) << offset;
+  if ( offset + valid > 32 )
+    result |= p[4] >> (8 - offset);
+
+  result >>= 32 - valid;
+  return result << (count - valid);
 }
 
+/**
+ * This runs for every received byte, so it's a single store and a table lookup.
+ * The byte arrives with the first bit received in the MSB, but every AIS byte is sent LSB first.
+ * Reversing it gives the natural byte, which is also the order the reflected CRC consumes bits in.
+ */
 void RXPacket::addByte(uint8_t byte)
 {
-  // The payload is LSB (inverted MSB bytes). This brings it back into MSB format
-
-  addBit(byte & 0x01);
-  addBit(byte & 0x02);
-  addBit(byte & 0x04);
-  addBit(byte & 0x08);
-  addBit(byte & 0x10);
-  addBit(byte & 0x20);
-  addBit(byte & 0x40);
-  addBit(byte & 0x80);
+  uint8_t natural = reverseBits(byte);
 
-  // Now we can update our CRC in MSB order which is how it was calculated during encoding by the sender ...
-  addBitCRC((byte & 0x80) >> 7);
-  addBitCRC((byte & 0x40) >> 6);
-  addBitCRC((byte & 0x20) >> 5);
-  addBitCRC((byte & 0x10) >> 4);
-  addBitCRC((byte & 0x08) >> 3);
-  addBitCRC((byte & 0x04) >> 2);
-  addBitCRC((byte & 0x02) >> 1);
-  addBitCRC(byte & 0x01);
+  if ( (mState.mSize & 0x07) == 0 )
+    {
+      mState.mPacket[mState.mSize / 8] = natural;
+      mState.mSize += 8;
+    }
+  else
+    {
+      for ( int8_t i = 7; i >= 0; --i )
+        addBit((natural >> i) & 0x01);
+    }
 
+  mState.mCRC = (mState.mCRC >> 8) ^ Utils::CRC16_X25_TABLE[(mState.mCRC ^ natural) & 0xff];
 }
 
 
@@ -195,6 +332,14 @@ uint16_t RXPacket::size() const
   return mState.mSize;
 }
 
+uint16_t RXPacket::payloadSize() const
+{
+  if ( mState.mCRCDiscarded )
+    return mState.mSize;
+
+  return mState.mSize < 16 ? 0 : mState.mSize - 16;
+}
+
 
 bool RXPacket::isBad() const
 {
@@ -213,10 +358,11 @@ uint16_t RXPacket::crc() const
 
 void RXPacket::discardCRC()
 {
-  if ( mState.mCRC == 0xffff )
+  if ( mState.mCRCDiscarded || mState.mSize < 16 )
     return;
   mState.mSize -= 16;
   mState.mCRC = 0xffff;
+  mState.mCRCDiscarded = true;
 
   // Explicitly set those bits to zero, no matter how they align
   for ( uint8_t i = 0; i < 16; ++i )
@@ -237,20 +383,99 @@ bool RXPacket::checkCRC() const
 {
   //uint16_t rcrc = ((mCRC & 0xff00) >> 8) | ((mCRC & 0x00ff) << 8);
   //trace_printf("%.4x %.4x %.4x\n", mCRC, ~(mCRC), ~(rcrc));
-  return mState.mCRC == 0xf0b8;
+  return mState.mCRC == CRC16_X25_RESIDUE;
+
+}
+
+#if RX_CRC_CORRECTION
+
+/**
+ * The syndrome (how far the CRC register is from the good residue) is matched against single bit errors first,
+ * then against pairs of errors no more than RX_CRC_CORRECTION_SPAN bits apart, which is what a single corrupted
+ * NRZI level turns into. Every table comparison counts against the budget, and a search that cannot complete
+ * within what is left is not started. An ambiguous pair match is not corrected.
+ */
+RXPacket::CRCCorrection RXPacket::correctCRC(uint16_t budget)
+{
+  uint16_t n = mState.mSize;
+  if ( checkCRC() || (n & 0x07) || n > MAX_AIS_RX_PACKET_SIZE )
+    return CRC_UNCORRECTABLE;
+
+  uint16_t syndrome = mState.mCRC ^ CRC16_X25_RESIDUE;
+
+  if ( budget < n )
+    return CRC_OVER_BUDGET;
+
+  for ( uint16_t d = 0; d < n; ++d )
+    {
+      if ( CRC16_X25_SYNDROMES[d] == syndrome )
+        {
+          flipReceivedBit(n - 1 - d);
+          return refreshCRC() ? CRC_CORRECTED_1_BIT : CRC_UNCORRECTABLE;
+        }
+    }
+
+  budget -= n;
+  if ( budget < n * RX_CRC_CORRECTION_SPAN )
+    return CRC_OVER_BUDGET;
+
+  uint16_t first = 0, second = 0;
+  uint8_t matches = 0;
+  for ( uint16_t d = 0; d < n; ++d )
+    {
+      uint16_t partner = syndrome ^ CRC16_X25_SYNDROMES[d];
+      for ( uint16_t e = d + 1; e < n && e <= d + RX_CRC_CORRECTION_SPAN; ++e )
+        {
+          if ( CRC16_X25_SYNDROMES[e] == partner )
+            {
+              first = d;
+              second = e;
+              ++matches;
+            }
+        }
+    }
+
+  if ( matches != 1 )
+    return CRC_UNCORRECTABLE;
+
+  flipReceivedBit(n - 1 - first);
+  flipReceivedBit(n - 1 - second);
+  return refreshCRC() ? CRC_CORRECTED_2_BITS : CRC_UNCORRECTABLE;
+}
 
+/*
+ * Index is in order of reception. Every byte is sent LSB first, so bit i of the frame
+ * is bit (i % 8) of the stored byte.
+ */
+void RXPacket::flipReceivedBit(uint16_t index)
+{
+  mState.mPacket[index / 8] ^= 1 << (index % 8);
 }
 
+/*
+ * Recomputes the CRC of the whole frame after a correction and forgets cached fields
+ */
+bool RXPacket::refreshCRC()
+{
+  uint16_t crc = 0xffff;
+  for ( uint16_t i = 0; i < mState.mSize / 8; ++i )
+    crc = (crc >> 8) ^ Utils::CRC16_X25_TABLE[(crc ^ mState.mPacket[i]) & 0xff];
+
+  mState.mCRC = crc;
+  mState.mType = 0;
+  mState.mRI = 0;
+  mState.mMMSI = 0;
+  return checkCRC();
+}
+
+#endif
+
 uint8_t RXPacket::messageType() const
 {
   if ( mState.mType )
     return mState.mType;
 
-  for ( int i = 0; i < 6; ++i ) {
-      mState.mType <<= 1;
-      mState.mType |= bit(i);
-  }
-
+  mState.mType = bits(0, 6);
   return mState.mType;
 }
 
@@ -268,11 +493,7 @@ uint32_t RXPacket::mmsi() const
   if ( mState.mMMSI )
     return mState.mMMSI;
 
-  for ( int i = 8; i < 38; ++i ) {
-      mState.mMMSI <<= 1;
-      mState.mMMSI |= bit(i);
-  }
-
+  mState.mMMSI = bits(8, 30);
   return mState.mMMSI;
 }
 
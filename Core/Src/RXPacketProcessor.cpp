@@ -23,9 +23,12 @@
 #include "config.h"
 #include "RadioManager.hpp"
 #include "RXPacketProcessor.hpp"
-#include "AISMessages.hpp"
+#include "RXFunnel.hpp"
+#include "SlotMap.hpp"
+#include "AISDecoder.hpp"
 #include "DataTerminal.hpp"
 #include "EventQueue.hpp"
+#include "PerfTrace.hpp"
 #include "Utils.hpp"
 #include "AISChannels.h"
 #include "printf_serial.h"
@@ -36,9 +39,19 @@
 char __buff[120];
 #endif
 
+RXPacketProcessor &RXPacketProcessor::instance()
+{
+  static RXPacketProcessor __instance;
+  return __instance;
+}
+
 RXPacketProcessor::RXPacketProcessor ()
 {
   mSentences.reserve(4); // We're not going to need more than 2 sentences for the longest AIS message we report ...
+}
+
+void RXPacketProcessor::init()
+{
   Configuration::instance().readStationData(mStationData);
   EventQueue::instance().addObserver(this, AIS_PACKET_EVENT);
 }
@@ -49,6 +62,38 @@ RXPacketProcessor::~RXPacketProcessor ()
   EventQueue::instance().removeObserver(this);
 }
 
+/**
+ * Checks the CRC (repairing the packet if enabled) and counts the outcome
+ */
+bool RXPacketProcessor::validate(RXPacket &packet)
+{
+  if ( packet.checkCRC() )
+    {
+      ++mStats.good;
+      return true;
+    }
+
+#if RX_CRC_CORRECTION
+  switch(packet.correctCRC(RX_CRC_CORRECTION_BUDGET))
+  {
+  case RXPacket::CRC_CORRECTED_1_BIT:
+    ++mStats.corrected1;
+    return true;
+  case RXPacket::CRC_CORRECTED_2_BITS:
+    ++mStats.corrected2;
+    return true;
+  case RXPacket::CRC_OVER_BUDGET:
+    ++mStats.overBudget;
+    break;
+  default:
+    break;
+  }
+#endif
+
+  ++mStats.bad;
+  return false;
+}
+
 void RXPacketProcessor::processEvent(const Event &e)
 {
   switch(e.type)
@@ -56,51 +101,81 @@ void RXPacketProcessor::processEvent(const Event &e)
   case AIS_PACKET_EVENT:
     {
       ASSERT(e.rxPacket);
-      if (e.rxPacket->isBad() || !e.rxPacket->checkCRC ())
-        return;
+      RXFunnel &funnel = RXFunnel::instance();
+      VHFChannel channel = e.rxPacket->channel();
+
+      if ( e.rxPacket->isBad() )
+        {
+          ++mStats.invalid;
+          funnel.count(channel, RX_FUNNEL_RUNT);
+          funnel.markSlot(channel, e.rxPacket->slot(), false);
+          return;
+        }
+
+      if ( e.rxPacket->collision() )
+        ++mStats.collisions;
+
+      bool valid = validate(*e.rxPacket);
+      funnel.count(channel, valid ? RX_FUNNEL_CRC_PASS : RX_FUNNEL_CRC_FAIL);
+      funnel.markSlot(channel, e.rxPacket->slot(), valid);
+
+      if ( !valid )
+        {
+          if ( e.rxPacket->syncErrors() )
+            ++mStats.tolerantBad;
+          return;
+        }
+
+      if ( e.rxPacket->syncErrors() )
+        ++mStats.tolerantGood;
+
+      if ( e.rxPacket->collision() )
+        ++mStats.captured;
+
+      SlotMap::instance().markDecoded(channel, e.rxPacket->slot(), e.rxPacket->size());
 
       bsp_rx_led_on();
 
-      if ( e.rxPacket->messageType() == 15 )
+      AISDecodedMessage msg;
+      PERF_DECODE_ENTER();
+      bool decoded = AISDecoder::decode(*e.rxPacket, msg);
+      PERF_DECODE_EXIT();
+
+      if ( decoded && msg.type == 15 )
         {
-          AISMessage15 msg;
-          if ( msg.decode(*e.rxPacket) )
-            {
-              // Make sure we actually can transmit something
-              if ( mStationData.magic != STATION_DATA_MAGIC )
-                break;
+          // Make sure we actually can transmit something
+          if ( mStationData.magic != STATION_DATA_MAGIC )
+            break;
 
-              // This is an interrogation. If we are a target, push an appropriate event into the queue
+          // This is an interrogation. If we are a target, push an appropriate event into the queue
 
-              // It is possible that we are the target for more than one type of message (18 + 24)
-              for ( uint8_t i = 0; i < 3; ++i )
+          // It is possible that we are the target for more than one type of message (18 + 24)
+          const AISInterrogation &interrogation = msg.interrogation;
+          for ( uint8_t i = 0; i < interrogation.count; ++i )
+            {
+              if ( interrogation.mmsi[i] == mStationData.mmsi )
                 {
-                  AISMessage15::InterrogationTarget &target = msg.targets[i];
-                  if ( target.mmsi == mStationData.mmsi )
+                  switch(interrogation.messageType[i])
+                  {
+                  case 18:
+                  case 24:
                     {
-                      switch(target.messageType)
-                      {
-                      case 18:
-                      case 24:
-                        {
 #if 0
-                          Event ie(INTERROGATION_EVENT);
-                          ie.interrogation.channel = e.rxPacket.channel();
-                          ie.interrogation.messageType = target.messageType;
+                      Event ie(INTERROGATION_EVENT);
+                      ie.interrogation.channel = e.rxPacket.channel();
+                      ie.interrogation.messageType = interrogation.messageType[i];
 
-                          //printf2("Scheduling message %d in response to interrogation\r\n", ie->interrogation.messageType);
-                          EventQueue::instance().push(ie);
+                      //printf2("Scheduling message %d in response to interrogation\r\n", ie->interrogation.messageType);
+                      EventQueue::instance().push(ie);
 #endif
-                          break;
-                        }
-                      default:
-                        // Why do base stations sometimes request message 5 from class B transponders?
-                        //DBG("Ignoring malformed message 15 from MMSI %d\r\n", e.rxPacket.mmsi());
-                        break;
-                      }
+                      break;
                     }
+                  default:
+                    // Why do base stations sometimes request message 5 from class B transponders?
+                    //DBG("Ignoring malformed message 15 from MMSI %d\r\n", e.rxPacket.mmsi());
+                    break;
+                  }
                 }
-
             }
         } // If message 15
 
@@ -108,7 +183,9 @@ void RXPacketProcessor::processEvent(const Event &e)
       mSentences.clear();
 
       ASSERT_VALID_PTR(e.rxPacket);
+      PERF_NMEA_ENTER();
       mEncoder.encode(*(e.rxPacket), mSentences);
+      PERF_NMEA_EXIT();
       for (vector<string>::iterator i = mSentences.begin(); i != mSentences.end(); ++i)
         {
 #ifdef MULTIPLEXED_OUTPUT
@@ -157,3 +234,25 @@ void RXPacketProcessor::processEvent(const Event &e)
   }
 
 }
+
+void RXPacketProcessor::reportStats()
+{
+  Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+  if ( !e )
+    return;
+
+  sprintf(e->nmeaBuffer.sentence, "$PAIRXS,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu*",
+      mStats.good,
+      mStats.bad,
+      mStats.invalid,
+      mStats.corrected1,
+      mStats.corrected2,
+      mStats.overBudget,
+      mStats.tolerantGood,
+      mStats.tolerantBad,
+      mStats.collisions,
+      mStats.captured);
+
+  Utils::completeNMEA(e->nmeaBuffer.sentence);
+  EventQueue::instance().push(e);
+}
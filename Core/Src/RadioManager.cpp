@@ -20,11 +20,20 @@
 
 #include "RadioManager.hpp"
 #include "NoiseFloorDetector.hpp"
+#include "SlotMap.hpp"
 #include "bsp/bsp.hpp"
 #include "TXErrors.h"
+#include <string.h>
+
+// Milliseconds to wait for each bring-up phase of the RF ICs
+#define RFIC_BRINGUP_TIMEOUT      1000
 
 void rxClockCB();
 void trxClockCB();
+void rxDecoderCB();
+void rxSamplesCB(const uint8_t *samples, uint16_t count);
+void rxSlotBitCB();
+void txTimerCB();
 
 
 RadioManager &RadioManager::instance()
@@ -34,12 +43,13 @@ RadioManager &RadioManager::instance()
 }
 
 RadioManager::RadioManager()
-: mTXQueue(4)
 {
   mTransceiverIC = NULL;
   mReceiverIC = NULL;
   mInitializing = true;
   mUTC = 0;
+  mBootStart = 0;
+  memset(mBootCycles, 0, sizeof mBootCycles);
   EventQueue::instance().addObserver(this, CLOCK_EVENT);
 }
 
@@ -48,15 +58,82 @@ bool RadioManager::initialized()
   return !mInitializing;
 }
 
+static inline uint32_t cycles()
+{
+  return DWT->CYCCNT;
+}
+
+/**
+ * Both ICs are reset and configured at the same time. Instead of fixed delays, the POR state is polled via GPIO1
+ * and every configuration command goes out as soon as the chip reports CTS, alternating between the two chips.
+ */
 void RadioManager::init()
 {
   NoiseFloorDetector::instance();
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
   mTransceiverIC = new Transceiver(SDN1_PORT, SDN1_PIN,
       CS1_PORT, CS1_PIN,
       TRX_IC_DATA_PORT, TRX_IC_DATA_PIN,
       TRX_IC_CLK_PORT, TRX_IC_CLK_PIN, 0);
 
-  if ( mTransceiverIC->isResponsive() )
+  mReceiverIC = new Receiver(SDN2_PORT, SDN2_PIN,
+      CS2_PORT, CS2_PIN,
+      RX_IC_DATA_PORT, RX_IC_DATA_PIN,
+      RX_IC_CLK_PORT, RX_IC_CLK_PIN, 1);
+
+  RFIC *ics[2] = { mTransceiverIC, mReceiverIC };
+
+  uint32_t start = cycles();
+  mBootStart = start;
+
+  // SDN must be held high for at least 10us. There is nothing to poll for that.
+  for ( RFIC *ic : ics )
+    ic->holdInReset();
+  HAL_Delay(1);
+  for ( RFIC *ic : ics )
+    ic->releaseReset();
+
+  uint32_t tick = HAL_GetTick();
+  while ( !(ics[0]->checkPOR() & ics[1]->checkPOR()) && HAL_GetTick() - tick < RFIC_BRINGUP_TIMEOUT )
+    ;
+
+  mBootCycles[BOOT_RESET] = cycles() - start;
+  start = cycles();
+
+  bool done[2] = { true, true };
+  for ( uint8_t i = 0; i < 2; ++i )
+    {
+      if ( ics[i]->isResponsive() )
+        {
+          ics[i]->startConfiguration();
+          done[i] = false;
+        }
+    }
+
+  bool patched = false;
+  tick = HAL_GetTick();
+  while ( !(done[0] && done[1]) && HAL_GetTick() - tick < RFIC_BRINGUP_TIMEOUT )
+    {
+      for ( uint8_t i = 0; i < 2; ++i )
+        {
+          if ( !done[i] )
+            done[i] = ics[i]->continueConfiguration();
+        }
+
+      if ( !patched && (done[0] || ics[0]->poweredUp()) && (done[1] || ics[1]->poweredUp()) )
+        {
+          mBootCycles[BOOT_PATCH] = cycles() - start;
+          start = cycles();
+          patched = true;
+        }
+    }
+
+  mBootCycles[BOOT_CONFIG] = cycles() - start;
+
+  if ( mTransceiverIC->isResponsive() && done[0] )
     {
       mTransceiverIC->init();
     }
@@ -65,11 +142,7 @@ void RadioManager::init()
       reportError(1);
     }
 
-  mReceiverIC = new Receiver(SDN2_PORT, SDN2_PIN,
-      CS2_PORT, CS2_PIN,
-      RX_IC_DATA_PORT, RX_IC_DATA_PIN,
-      RX_IC_CLK_PORT, RX_IC_CLK_PIN, 1);
-  if ( mReceiverIC->isResponsive() )
+  if ( mReceiverIC->isResponsive() && done[1] )
     {
       mReceiverIC->init();
     }
@@ -78,7 +151,7 @@ void RadioManager::init()
       reportError(2);
     }
 
-  if ( mReceiverIC->isResponsive() && mTransceiverIC->isResponsive() )
+  if ( mReceiverIC->isResponsive() && mTransceiverIC->isResponsive() && done[0] && done[1] )
     mInitializing = false;
 }
 
@@ -112,6 +185,21 @@ void RadioManager::start()
   if ( mReceiverIC )
     mReceiverIC->startReceiving(CH_88, true);
 
+  // START_RX was sent without waiting, so the receivers are up when both chips report CTS again
+  uint32_t start = cycles();
+  uint32_t tick = HAL_GetTick();
+  while ( !(mTransceiverIC->isReady() && mReceiverIC->isReady()) && HAL_GetTick() - tick < RFIC_BRINGUP_TIMEOUT )
+    ;
+
+  uint32_t now = cycles();
+  mBootCycles[BOOT_FIRST_RX] = now - start;
+  mBootCycles[BOOT_TOTAL] = now - mBootStart;
+  reportBootTiming();
+
+#if RX_DMA_SAMPLING
+  bsp_start_rx_sampling();
+#endif
+
   GPS::instance().setDelegate(this);
 }
 
@@ -120,6 +208,26 @@ void RadioManager::stop()
   // TODO: Implement this
 }
 
+/**
+ * $PAIBOOT,<reset>,<patch>,<config>,<first RX>,<total> in microseconds. Total includes the time between init() and start().
+ */
+void RadioManager::reportBootTiming()
+{
+  Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+  if ( !e )
+    return;
+
+  uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+  sprintf(e->nmeaBuffer.sentence, "$PAIBOOT,%lu,%lu,%lu,%lu,%lu*",
+      mBootCycles[BOOT_RESET] / cyclesPerUs,
+      mBootCycles[BOOT_PATCH] / cyclesPerUs,
+      mBootCycles[BOOT_CONFIG] / cyclesPerUs,
+      mBootCycles[BOOT_FIRST_RX] / cyclesPerUs,
+      mBootCycles[BOOT_TOTAL] / cyclesPerUs);
+  Utils::completeNMEA(e->nmeaBuffer.sentence);
+  EventQueue::instance().push(e);
+}
+
 void RadioManager::reportError(int chipId)
 {
   Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
@@ -134,7 +242,16 @@ void RadioManager::reportError(int chipId)
 void RadioManager::configureInterrupts()
 {
   bsp_set_trx_clk_callback(trxClockCB);
+#if RX_DMA_SAMPLING
+  bsp_set_rx_samples_callback(rxSamplesCB);
+  bsp_set_slot_bit_callback(rxSlotBitCB, CCA_SLOT_BIT);
+#else
   bsp_set_rx_clk_callback(rxClockCB);
+#endif
+  bsp_set_rx_decoder_callback(rxDecoderCB);
+#if TX_FIFO_MODE
+  bsp_set_tx_timer_callback(txTimerCB);
+#endif
 }
 
 void RadioManager::processEvent(const Event &e)
@@ -196,11 +313,44 @@ void RadioManager::onBitClock(uint8_t ic)
     mReceiverIC->onBitClock();
 }
 
+void RadioManager::decodeCapturedBits()
+{
+  if ( mInitializing )
+    return;
+
+  mTransceiverIC->decodeCapturedBits();
+  mReceiverIC->decodeCapturedBits();
+}
+
+void RadioManager::onRXSamples(const uint8_t *samples, uint16_t count)
+{
+  if ( mInitializing )
+    return;
+
+  mReceiverIC->captureSamples(samples, count);
+}
+
+void RadioManager::onSlotBit()
+{
+  if ( mInitializing )
+    return;
+
+  mReceiverIC->sampleSlotRSSI();
+}
+
+void RadioManager::onTXTimer()
+{
+  if ( mTransceiverIC )
+    mTransceiverIC->onTXTimer();
+}
+
 void RadioManager::timeSlotStarted(uint32_t slotNumber)
 {
   if ( mInitializing )
     return;
 
+  // The map must be on the new slot before the transceiver looks at it
+  SlotMap::instance().slotStarted(slotNumber);
   mTransceiverIC->timeSlotStarted(slotNumber);
   mReceiverIC->timeSlotStarted(slotNumber);
 }
@@ -253,5 +403,25 @@ void trxClockCB()
   RadioManager::instance().onBitClock(1);
 }
 
+void rxDecoderCB()
+{
+  RadioManager::instance().decodeCapturedBits();
+}
+
+void rxSamplesCB(const uint8_t *samples, uint16_t count)
+{
+  RadioManager::instance().onRXSamples(samples, count);
+}
+
+void rxSlotBitCB()
+{
+  RadioManager::instance().onSlotBit();
+}
+
+void txTimerCB()
+{
+  RadioManager::instance().onTXTimer();
+}
+
 
 
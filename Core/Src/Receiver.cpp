@@ -23,25 +23,36 @@
 #include "Events.hpp"
 #include "EventQueue.hpp"
 #include "NoiseFloorDetector.hpp"
+#include "RXFunnel.hpp"
+#include "SlotMap.hpp"
+#include "PerfTrace.hpp"
 #include "bsp/bsp.hpp"
 
+#define CCA_FIRST_BIT                   (CCA_SLOT_BIT - (CCA_SAMPLES - 1) * CCA_SAMPLE_SPACING)
+static_assert(CCA_SAMPLES >= 1 && CCA_SAMPLE_SPACING >= 1 && CCA_FIRST_BIT >= 0, "CCA samples must fit before CCA_SLOT_BIT");
+
 
 Receiver::Receiver(GPIO_TypeDef *sdnPort, uint32_t sdnPin, GPIO_TypeDef *csPort, uint32_t csPin,
     GPIO_TypeDef *dataPort, uint32_t dataPin,
     GPIO_TypeDef *clockPort, uint32_t clockPin, int chipId)
-: RFIC(sdnPort, sdnPin, csPort, csPin, dataPort, dataPin, clockPort, clockPin, chipId)
+: RFIC(sdnPort, sdnPin, csPort, csPin, dataPort, dataPin, clockPort, clockPin, chipId),
+  mDecoder(this)
 {
   mSlotBitNumber = -1;
-  mOneBitCount = 0;
   mChannel = CH_88;
-  mBitCount = 0;
-  mBitState = BIT_STATE_PREAMBLE_SYNC;
-  mLastNRZIBit=0x00;
   mNextChannel = mChannel;
-  mRXByte = 0;
-  mBitWindow = 0;
+  mDecodeChannel = mChannel;
+  mCaptureLevels = 0;
+  mCaptureCount = 0;
+  mGeneration = 0;
+  mDecodeGeneration = 0;
+  mSlotRSSI = 0;
+  mCCARSSI = 0;
+  mSwitchRequested = false;
   mRXPacket = EventPool::instance().newRXPacket();
   ASSERT_VALID_PTR(mRXPacket);
+  mDecoder.setPacket(mRXPacket);
+  mDecoder.reset();
 }
 
 Receiver::~Receiver()
@@ -96,16 +107,15 @@ void Receiver::startListening(VHFChannel channel, bool reconfigGPIOs)
   sendCmdNoWait(START_RX, &options, sizeof options);
 }
 
+/**
+ * Discards the partially captured byte and starts a new generation of captured bits.
+ * The decoder resets itself (and the packet it is building) when it reaches the new generation.
+ */
 void Receiver::resetBitScanner()
 {
-  mBitWindow = 0;
-  mBitCount = 0;
-  mOneBitCount = 0;
-  mLastNRZIBit = 0xff;
-  mRXByte = 0;
-  mBitState = BIT_STATE_PREAMBLE_SYNC;
-  if ( mRXPacket )
-    mRXPacket->reset();
+  mCaptureLevels = 0;
+  mCaptureCount = 0;
+  mGeneration = (mGeneration + 1) & 0x0f;
 }
 
 
@@ -119,154 +129,200 @@ void Receiver::onBitClock()
       return;
     }
 
+  PERF_BITCLOCK_ENTER();
 
-  if ( !mRXPacket )
+  // The decoder can't talk to the RFIC because it may preempt SPI traffic, so it asks us to switch channels
+  if ( mSwitchRequested )
     {
-      mRXPacket = EventPool::instance().newRXPacket();
-      if ( !mRXPacket )
-        {
-          return;
-        }
+      mSwitchRequested = false;
+      if ( mNextChannel != mChannel )
+        startReceiving(mNextChannel, false);
     }
 
-
   uint8_t bit = HAL_GPIO_ReadPin(mDataPort, mDataPin);
-  Receiver::Action action = processNRZIBit(bit);
-  if ( action == RESTART_RX )
+  captureBit(bit);
+
+  if ( mTimeSlot != 0xffffffff && mSlotBitNumber >= CCA_FIRST_BIT && mSlotBitNumber <= CCA_SLOT_BIT &&
+       (CCA_SLOT_BIT - mSlotBitNumber) % CCA_SAMPLE_SPACING == 0 )
     {
-      startReceiving(mNextChannel, false);
+      sampleCCA();
     }
-  else if ( mTimeSlot != 0xffffffff && mSlotBitNumber != 0xffff && mSlotBitNumber == CCA_SLOT_BIT )
+
+  PERF_BITCLOCK_EXIT();
+}
+
+void Receiver::sampleCCA()
+{
+  PERF_RSSI_ENTER();
+  uint8_t rssi = readRSSI();
+  PERF_RSSI_EXIT();
+
+  if ( mSlotBitNumber == CCA_FIRST_BIT || rssi > mCCARSSI )
+    mCCARSSI = rssi;
+
+  if ( mSlotBitNumber == CCA_SLOT_BIT )
     {
-      mRXPacket->setRSSI(reportRSSI());
+      mSlotRSSI = rssi;
+      reportRSSI(rssi);
     }
 }
 
 /**
- * This is called from the SOTDMA timer interrupt, which is at the same priority as the bit clock.
- * So timeSlotStarted() and onBitClock() cannot preempt each other.
+ * This is all the per-bit work left in the bit clock interrupt
  */
-
-void Receiver::timeSlotStarted(uint32_t slot)
+void Receiver::captureBit(uint8_t level)
 {
-  // This should never be called while transmitting. Transmissions start after the slot boundary and end before the end of it.
-  ASSERT(gRadioState == RADIO_RECEIVING);
-
-  mSlotBitNumber = -1;
-  mTimeSlot = slot;
-  if ( mBitState == BIT_STATE_IN_PACKET )
+  mCaptureLevels <<= 1;
+  mCaptureLevels |= level;
+  if ( ++mCaptureCount < 8 )
     return;
 
-  if ( mRXPacket )
-    mRXPacket->setSlot(slot);
+  CapturedBits bits;
+  bits.slot = mTimeSlot;
+  bits.slotBit = mSlotBitNumber > 255 ? 255 : mSlotBitNumber;
+  bits.generation = mGeneration;
+  bits.levels = mCaptureLevels;
 
-  if ( mChannel != mNextChannel )
+  if ( !mCapture.push(bits) )
     {
-      startReceiving(mNextChannel, false);
+      // The decoder fell behind, so the stream has a gap. Whatever frame was in progress is lost.
+      mGeneration = (mGeneration + 1) & 0x0f;
     }
+
+  mCaptureCount = 0;
+  bsp_trigger_rx_decoder();
 }
 
 /**
- * This method must complete in a few microseconds, worst case!
+ * Packs a block of DMA samples exactly like captureBit() does, 8 levels at a time.
+ * This runs right after the last sample of the block was latched, so the slot position of every byte
+ * can be worked out backwards from the SOTDMA timer.
  */
-Receiver::Action Receiver::processNRZIBit(uint8_t bit)
+void Receiver::captureSamples(const uint8_t *samples, uint16_t count)
 {
-  if ( mLastNRZIBit == 0xff )
-    {
-      mLastNRZIBit = bit;
-      return NO_ACTION;
-    }
-
-  uint8_t decodedBit = !(mLastNRZIBit ^ bit);
+  uint32_t slot = mTimeSlot;
+  int32_t slotBit = bsp_get_sotdma_timer_value() / (bsp_get_system_clock() / 9600);
 
-  switch (mBitState) {
-  case BIT_STATE_PREAMBLE_SYNC:
+  CapturedBits bits;
+  for ( uint16_t i = 0; i + 8 <= count; i += 8 )
     {
-      mLastNRZIBit = bit;
-      mBitWindow <<= 1;
-      mBitWindow |= decodedBit;
-
-      /*
-       * By checking for the last few preamble bits plus the HDLC start flag,
-       * we gain enough confidence that this is not random noise.
-       */
-      //if ( mBitWindow == 0b1010101001111110 || mBitWindow == 0b0101010101111110 )
-      if ( (mBitWindow & 0x0fff) == 0b101001111110 || (mBitWindow &0x0fff) == 0b010101111110 )
+      uint8_t levels = 0;
+      for ( uint8_t j = 0; j < 8; ++j )
+        levels = (levels << 1) | ((samples[i + j] & mDataPin) != 0);
+
+      // Position of the last level of this byte
+      int32_t bit = slotBit - (count - i - 8);
+      bits.slot = slot;
+      if ( slot != 0xffffffff && bit < 0 )
         {
-          mBitState = BIT_STATE_IN_PACKET;
-          mRXPacket->setChannel(mChannel);
+          bits.slot = slot ? slot - 1 : 2249;
+          bit += 256;
         }
 
-      break;
+      bits.slotBit = bit < 0 ? 0 : (bit > 255 ? 255 : bit);
+      bits.generation = mGeneration;
+      bits.levels = levels;
+
+      if ( !mCapture.push(bits) )
+        mGeneration = (mGeneration + 1) & 0x0f;
     }
-  case BIT_STATE_IN_PACKET:
-    {
-      if ( mOneBitCount >= 7 || mRXPacket->size() >= MAX_AIS_RX_PACKET_SIZE - 2 )
-        {
-          // Start over
-          return RESTART_RX;
-        }
 
-      mLastNRZIBit = bit;
-      mBitWindow <<= 1;
-      mBitWindow |= decodedBit;
+  bsp_trigger_rx_decoder();
+}
 
-      if ( (mBitWindow & 0x00ff) == 0x7E )
+void Receiver::sampleSlotRSSI()
+{
+  uint8_t rssi = readRSSI();
+  mSlotRSSI = rssi;
+  mCCARSSI = rssi;
+  reportRSSI(rssi);
+}
+
+void Receiver::decodeCapturedBits()
+{
+  while ( mCapture.pop(mDecodeBits) )
+    {
+      if ( !mRXPacket )
         {
-          // We have a complete packet
-          mBitState = BIT_STATE_PREAMBLE_SYNC;
-          /**
-           * This is the longest operation undertaken here. Now that we use object pools and pointers,
-           * it completes in about 14us
-           */
-          pushPacket();
-          return RESTART_RX;
+          mRXPacket = EventPool::instance().newRXPacket();
+          if ( !mRXPacket )
+            continue;
+
+          mDecoder.setPacket(mRXPacket);
+          mDecodeGeneration = 0xff;
         }
-      else
+
+      if ( mDecodeBits.generation != mDecodeGeneration )
         {
-          addBit(decodedBit);
+          mDecodeGeneration = mDecodeBits.generation;
+          mDecodeChannel = mChannel;
+          mDecoder.reset();
         }
 
-      break;
+      mDecoder.decode(mDecodeBits.levels);
     }
-  }
+}
+
+void Receiver::onFrameStart(uint8_t bitsLeft)
+{
+  RXFunnel::instance().count(mDecodeChannel, RX_FUNNEL_PREAMBLE);
+  mRXPacket->setChannel(mDecodeChannel);
 
-  return NO_ACTION;
+  // The slot in which the start flag ended
+  uint32_t slot = mDecodeBits.slot;
+  if ( slot != 0xffffffff && mDecodeBits.slotBit < bitsLeft )
+    slot = slot ? slot - 1 : 2249;
+
+  mRXPacket->setSlot(slot);
 }
 
+/**
+ * The RFIC stays in RX across frames and the decoder has already re-armed itself, so there is nothing to restart.
+ * A pending channel switch is the only reason to send START_RX, and that must not cut a colliding frame short.
+ */
+void Receiver::onFrameEnd(uint8_t, bool resync)
+{
+  mRXPacket->setRSSI(mSlotRSSI);
+  pushPacket();
+  mDecoder.setPacket(mRXPacket);
 
-bool Receiver::addBit(uint8_t bit)
+  if ( !resync && mNextChannel != mChannel )
+    mSwitchRequested = true;
+}
+
+void Receiver::onFrameAbort(FrameAbortReason reason)
 {
-  bool result = true;
-  if ( bit )
-    {
-      ++mOneBitCount;
-    }
-  else
-    {
-      // Don't put stuffed bits into the packet
-      if ( mOneBitCount == 5 )
-        result = false;
+  RXFunnel &funnel = RXFunnel::instance();
+  funnel.count(mRXPacket->channel(), reason == FRAME_ABORT_STUFFING ? RX_FUNNEL_STUFFING_ABORT : RX_FUNNEL_OVERSIZE_ABORT);
+  funnel.markSlot(mRXPacket->channel(), mRXPacket->slot(), false);
 
-      mOneBitCount = 0;
-    }
+  if ( mNextChannel != mChannel )
+    mSwitchRequested = true;
+}
 
-  if ( result )
-    {
-      mRXByte <<= 1;
-      mRXByte |= bit;
-      ++mBitCount;
-    }
+/**
+ * This is called from the SOTDMA timer interrupt, which is at the same priority as the bit clock.
+ * So timeSlotStarted() and onBitClock() cannot preempt each other.
+ */
+
+void Receiver::timeSlotStarted(uint32_t slot)
+{
+  // This should never be called while transmitting. Transmissions start after the slot boundary and end before the end of it.
+  ASSERT(gRadioState == RADIO_RECEIVING);
+
+  mSlotBitNumber = -1;
+  mTimeSlot = slot;
+  RXFunnel::instance().clearSlot(mChannel, slot);
+
+  if ( mDecoder.inPacket() )
+    return;
 
-  if ( mBitCount == 8 )
+  // This is the only place a pending channel switch happens without a bit clock interrupt (RX_DMA_SAMPLING)
+  if ( mChannel != mNextChannel )
     {
-      // Commit to the packet!
-      mRXPacket->addByte(mRXByte);
-      mBitCount = 0;
-      mRXByte = 0;
+      mSwitchRequested = false;
+      startReceiving(mNextChannel, false);
     }
-
-  return result;
 }
 
 void Receiver::pushPacket()
@@ -281,6 +337,7 @@ void Receiver::pushPacket()
       if ( !EventQueue::instance().push(p) )
         {
           // This has never happened
+          RXFunnel::instance().count(mDecodeChannel, RX_FUNNEL_POOL_DROP);
         }
       //bsp_signal_low();
       mRXPacket = EventPool::instance().newRXPacket();
@@ -292,6 +349,9 @@ void Receiver::pushPacket()
   else
     {
       // This has never happened
+      RXFunnel &funnel = RXFunnel::instance();
+      funnel.count(mRXPacket->channel(), RX_FUNNEL_POOL_DROP);
+      funnel.markSlot(mRXPacket->channel(), mRXPacket->slot(), false);
 
       /**
        * We're out of resources so just keep using the existing packet.
@@ -304,14 +364,13 @@ void Receiver::pushPacket()
 }
 
 /**
- * This operation typically takes under 85us
+ * The noise floor keeps getting the sample at CCA_SLOT_BIT alone, while the slot map gets the CCA outcome
  */
-uint8_t Receiver::reportRSSI()
+void Receiver::reportRSSI(uint8_t rssi)
 {
-  uint8_t rssi = readRSSI();
   char channel = AIS_CHANNELS[mChannel].designation;
   NoiseFloorDetector::instance().report(channel, rssi);
-  return rssi;
+  SlotMap::instance().markEnergy(mChannel, mTimeSlot, mCCARSSI);
 }
 
 void Receiver::configureGPIOsForRX()
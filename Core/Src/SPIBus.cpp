@@ -0,0 +1,287 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include "SPIBus.hpp"
+#include "EZRadioPRO.h"
+#include "_assert.h"
+#include "Utils.hpp"
+#include "bsp/bsp.hpp"
+#include <string.h>
+
+// Clocked out while reading a response
+static const uint8_t __zeros[SPI_MAX_RESPONSE] = {0};
+
+static const uint8_t __ctsPoll[2] = { READ_CMD_BUFFER, 0x00 };
+
+// The chip answers 0xFF in the byte after READ_CMD_BUFFER when its response is ready
+#define SPI_CTS                     0xFF
+
+static void spiTransferComplete()
+{
+  SPIBus::instance().onTransferComplete();
+}
+
+static void spiTrigger()
+{
+  SPIBus::instance().onTrigger();
+}
+
+SPIBus &SPIBus::instance()
+{
+  static SPIBus __instance;
+  return __instance;
+}
+
+SPIBus::SPIBus()
+  : mPhase(IDLE), mCTSPolls(0)
+{
+  memset(&mCurrent, 0, sizeof mCurrent);
+  memset(mCTSPending, 0, sizeof mCTSPending);
+  bsp_set_spi_transfer_callback(spiTransferComplete);
+  bsp_set_spi_trigger_callback(spiTrigger);
+}
+
+void SPIBus::prepare(SPITransaction &t, GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params,
+    uint8_t paramLen, void *result, uint8_t resultLen, bool waitCTS)
+{
+  ASSERT(paramLen < SPI_MAX_COMMAND && resultLen <= SPI_MAX_RESPONSE);
+
+  t.csPort = csPort;
+  t.csPin = csPin;
+  t.txLen = paramLen + 1;
+  t.resultLen = result ? resultLen : 0;
+  t.tx[0] = cmd;
+  if ( params )
+    memcpy(t.tx + 1, params, paramLen);
+  else
+    memset(t.tx + 1, 0, paramLen);
+  t.result = (uint8_t*)result;
+  t.waitCTS = waitCTS;
+  t.deferCTS = false;
+  t.done = nullptr;
+  t.ok = nullptr;
+  t.callback = nullptr;
+  t.context = nullptr;
+}
+
+void SPIBus::submit(GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params, uint8_t paramLen,
+    void *result, uint8_t resultLen, bool waitCTS, spi_callback callback, void *context)
+{
+  SPITransaction t;
+  prepare(t, csPort, csPin, cmd, params, paramLen, result, resultLen, waitCTS);
+  t.callback = callback;
+  t.context = context;
+  enqueue(t);
+}
+
+bool SPIBus::execute(GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params, uint8_t paramLen,
+    void *result, uint8_t resultLen, bool waitCTS)
+{
+  volatile bool done = false;
+  volatile bool ok = false;
+
+  SPITransaction t;
+  prepare(t, csPort, csPin, cmd, params, paramLen, result, resultLen, waitCTS);
+  t.done = &done;
+  t.ok = &ok;
+  enqueue(t);
+
+  // The engine preempts us, whatever our priority
+  while ( !done )
+    ;
+
+  return ok;
+}
+
+void SPIBus::post(GPIO_TypeDef *csPort, uint16_t csPin, uint8_t cmd, const void *params, uint8_t paramLen)
+{
+  SPITransaction t;
+  prepare(t, csPort, csPin, cmd, params, paramLen, NULL, 0, false);
+  t.deferCTS = true;
+  enqueue(t);
+}
+
+/**
+ * A push claims its cell and publishes it in two steps. If an interrupt that waits for its own transaction
+ * came in between, the engine would find the queue empty, go idle and never finish that transaction. So each
+ * push runs with interrupts off. The queue only fills up while the engine is busy draining it, so waiting for
+ * room (with interrupts on) is bounded.
+ */
+void SPIBus::enqueue(const SPITransaction &t)
+{
+  bool queued;
+  do
+    {
+      uint32_t mask = Utils::disableInterrupts();
+      queued = mQueue.push(t);
+      Utils::restoreInterrupts(mask);
+    }
+  while ( !queued );
+
+  bsp_trigger_spi();
+}
+
+void SPIBus::onTrigger()
+{
+  if ( mPhase == IDLE )
+    startNext();
+}
+
+void SPIBus::startNext()
+{
+  if ( !mQueue.pop(mCurrent) )
+    {
+      mPhase = IDLE;
+      return;
+    }
+
+  mCTSPolls = 0;
+
+  // A chip that was sent a command with post() may still be busy with it
+  if ( (mCurrent.waitCTS || mCurrent.deferCTS) && takeCTSPending() )
+    pollCTS(PRE_CTS_POLL);
+  else
+    sendCommand();
+}
+
+void SPIBus::sendCommand()
+{
+  mPhase = COMMAND;
+  HAL_GPIO_WritePin(mCurrent.csPort, mCurrent.csPin, GPIO_PIN_RESET);
+  bsp_start_spi_transfer(mCurrent.tx, mScratch, mCurrent.txLen);
+}
+
+bool SPIBus::takeCTSPending()
+{
+  for ( uint8_t i = 0; i < SPI_MAX_DEVICES; ++i )
+    {
+      if ( mCTSPending[i].csPort == mCurrent.csPort && mCTSPending[i].csPin == mCurrent.csPin )
+        {
+          mCTSPending[i].csPort = nullptr;
+          return true;
+        }
+    }
+
+  return false;
+}
+
+void SPIBus::setCTSPending()
+{
+  int8_t slot = -1;
+  for ( uint8_t i = 0; i < SPI_MAX_DEVICES; ++i )
+    {
+      if ( mCTSPending[i].csPort == mCurrent.csPort && mCTSPending[i].csPin == mCurrent.csPin )
+        return;
+      if ( slot < 0 && mCTSPending[i].csPort == nullptr )
+        slot = i;
+    }
+
+  ASSERT(slot >= 0);
+  mCTSPending[slot].csPort = mCurrent.csPort;
+  mCTSPending[slot].csPin = mCurrent.csPin;
+}
+
+void SPIBus::pollCTS(Phase phase)
+{
+  mPhase = phase;
+  HAL_GPIO_WritePin(mCurrent.csPort, mCurrent.csPin, GPIO_PIN_RESET);
+  bsp_start_spi_transfer(__ctsPoll, mScratch, sizeof __ctsPoll);
+}
+
+void SPIBus::readResponse()
+{
+  mPhase = RESPONSE;
+  bsp_start_spi_transfer(__zeros, mCurrent.result, mCurrent.resultLen);
+}
+
+void SPIBus::onTransferComplete()
+{
+  switch(mPhase)
+  {
+  case PRE_CTS_POLL:
+    HAL_GPIO_WritePin(mCurrent.csPort, mCurrent.csPin, GPIO_PIN_SET);
+    if ( mScratch[1] == SPI_CTS )
+      sendCommand();
+    else if ( ++mCTSPolls < SPI_MAX_CTS_POLLS )
+      pollCTS(PRE_CTS_POLL);
+    else
+      finish(false);          // Still busy with the last command, so this one is never sent
+    break;
+  case COMMAND:
+    if ( mCurrent.waitCTS )
+      {
+        HAL_GPIO_WritePin(mCurrent.csPort, mCurrent.csPin, GPIO_PIN_SET);
+        mCTSPolls = 0;
+        pollCTS(CTS_POLL);
+      }
+    else if ( mCurrent.resultLen )
+      {
+        // Fast response registers and FIFOs answer in the same transaction
+        readResponse();
+      }
+    else
+      {
+        finish(true);
+      }
+    break;
+  case CTS_POLL:
+    if ( mScratch[1] != SPI_CTS )
+      {
+        HAL_GPIO_WritePin(mCurrent.csPort, mCurrent.csPin, GPIO_PIN_SET);
+        if ( ++mCTSPolls < SPI_MAX_CTS_POLLS )
+          pollCTS(CTS_POLL);
+        else
+          finish(false);
+      }
+    else if ( mCurrent.resultLen )
+      {
+        readResponse();
+      }
+    else
+      {
+        finish(true);
+      }
+    break;
+  case RESPONSE:
+    finish(true);
+    break;
+  default:
+    break;
+  }
+}
+
+void SPIBus::finish(bool ok)
+{
+  HAL_GPIO_WritePin(mCurrent.csPort, mCurrent.csPin, GPIO_PIN_SET);
+
+  if ( ok && mCurrent.deferCTS )
+    setCTSPending();
+
+  if ( mCurrent.callback )
+    mCurrent.callback(mCurrent.context);
+
+  if ( mCurrent.ok )
+    *mCurrent.ok = ok;
+
+  if ( mCurrent.done )
+    *mCurrent.done = true;
+
+  startNext();
+}
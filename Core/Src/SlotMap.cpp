@@ -0,0 +1,148 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+
+#include "SlotMap.hpp"
+#include "NoiseFloorDetector.hpp"
+#include "Utils.hpp"
+#include <string.h>
+
+// Ramp up, training sequence and start flag before the data, end flag and ramp down after it
+#define SLOT_MAP_FRAMING_BITS           48
+
+static inline int8_t mapIndex(VHFChannel channel)
+{
+  switch(AIS_CHANNELS[channel].designation)
+  {
+  case 'A':
+    return 0;
+  case 'B':
+    return 1;
+  default:
+    return -1;
+  }
+}
+
+SlotMap &SlotMap::instance()
+{
+  static SlotMap __instance;
+  return __instance;
+}
+
+SlotMap::SlotMap()
+  : mSlot(0xffffffff), mFrame(0)
+{
+  memset(mDecoded, 0, sizeof mDecoded);
+  memset(mEnergy, 0, sizeof mEnergy);
+}
+
+void SlotMap::slotStarted(uint32_t slot)
+{
+  if ( slot >= SLOT_MAP_SLOTS )
+    return;
+
+  uint8_t frame = mFrame;
+  if ( mSlot != 0xffffffff && slot < mSlot )
+    {
+      frame = (frame + 1) % SLOT_MAP_FRAMES;
+      mFrame = frame;
+    }
+
+  mSlot = slot;
+
+  // Forget what happened in this slot SLOT_MAP_FRAMES frames ago
+  uint32_t mask = ~(1UL << (slot % 32));
+  for ( uint8_t c = 0; c < SLOT_MAP_CHANNELS; ++c )
+    {
+      __atomic_fetch_and(&mDecoded[frame][c][slot / 32], mask, __ATOMIC_RELAXED);
+      __atomic_fetch_and(&mEnergy[frame][c][slot / 32], mask, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Slots up to the current one belong to the current frame, the ones after it to the previous frame.
+ *
+ * This runs in the main loop as well as in interrupts below the slot timer, so the slot timer must not advance
+ * mSlot and mFrame between reading them, nor clear the slot between picking the frame and setting the bit.
+ */
+void SlotMap::mark(uint32_t (*bitset)[SLOT_MAP_CHANNELS][SLOT_MAP_WORDS], VHFChannel channel, uint32_t slot)
+{
+  int8_t c = mapIndex(channel);
+  if ( c < 0 || slot >= SLOT_MAP_SLOTS )
+    return;
+
+  uint32_t mask = Utils::disableInterrupts();
+  uint32_t current = mSlot;
+  if ( current != 0xffffffff )
+    {
+      uint8_t frame = mFrame;
+      if ( slot > current )
+        frame = (frame + SLOT_MAP_FRAMES - 1) % SLOT_MAP_FRAMES;
+
+      bitset[frame][c][slot / 32] |= 1UL << (slot % 32);
+    }
+  Utils::restoreInterrupts(mask);
+}
+
+void SlotMap::markDecoded(VHFChannel channel, uint32_t slot, uint16_t bits)
+{
+  // Random data needs about 3% of stuffed bits, so a 2-slot message (440 bits) still spans 2 slots
+  uint16_t span = (bits + bits / 32 + SLOT_MAP_FRAMING_BITS + 255) / 256;
+  for ( uint16_t i = 0; i < span; ++i )
+    mark(mDecoded, channel, (slot + i) % SLOT_MAP_SLOTS);
+}
+
+void SlotMap::markEnergy(VHFChannel channel, uint32_t slot, uint8_t rssi)
+{
+  // An unknown noise floor (0xff) never marks anything
+  int nf = NoiseFloorDetector::instance().getNoiseFloor(AIS_CHANNELS[channel].designation);
+  if ( rssi > nf + TX_CCA_HEADROOM )
+    mark(mEnergy, channel, slot);
+}
+
+bool SlotMap::isFree(VHFChannel channel, uint32_t slot) const
+{
+  int8_t c = mapIndex(channel);
+  if ( c < 0 || slot >= SLOT_MAP_SLOTS )
+    return false;
+
+  uint32_t used = 0;
+  for ( uint8_t f = 0; f < SLOT_MAP_FRAMES; ++f )
+    used |= mDecoded[f][c][slot / 32] | mEnergy[f][c][slot / 32];
+
+  return (used & (1UL << (slot % 32))) == 0;
+}
+
+int16_t SlotMap::findFreeSlot(VHFChannel channel, uint32_t near, uint16_t before, uint16_t after) const
+{
+  if ( mapIndex(channel) < 0 || near >= SLOT_MAP_SLOTS )
+    return -1;
+
+  uint16_t range = before > after ? before : after;
+  for ( uint16_t d = 0; d <= range; ++d )
+    {
+      if ( d <= after && isFree(channel, (near + d) % SLOT_MAP_SLOTS) )
+        return (near + d) % SLOT_MAP_SLOTS;
+
+      if ( d && d <= before && isFree(channel, (near + SLOT_MAP_SLOTS - d) % SLOT_MAP_SLOTS) )
+        return (near + SLOT_MAP_SLOTS - d) % SLOT_MAP_SLOTS;
+    }
+
+  return -1;
+}
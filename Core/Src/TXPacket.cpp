@@ -21,6 +21,9 @@
 #include <cstring>
 #include <cassert>
 #include "TXPacket.hpp"
+#include "EventQueue.hpp"
+#include "Utils.hpp"
+#include <stdio.h>
 #include <stdlib.h>
 
 
@@ -34,6 +37,7 @@ void TXPacket::configure(VHFChannel channel)
 {
   mTestPacket = false;
   mChannel  = channel;
+  mTargetSlot = -1;
   memset(mMessageType, 0, sizeof mMessageType);
 }
 
@@ -43,6 +47,10 @@ void TXPacket::configureForTesting(VHFChannel channel, uint16_t numBits)
   mChannel  = channel;
   strcpy(mMessageType, "00");
   mSize = numBits;
+
+  // Only used for transmission from the FIFO, which repeats these as often as it takes
+  for ( uint16_t i = 0; i < sizeof mPacket; ++i )
+    mPacket[i] = rand();
 }
 
 TXPacket::~TXPacket ()
@@ -55,6 +63,7 @@ void TXPacket::reset()
   mPosition  = 0;
   mChannel   = CH_87;
   mTimestamp = 0;
+  mTargetSlot = -1;
   memset(mPacket, 0, sizeof mPacket);
 }
 
@@ -73,6 +82,16 @@ time_t TXPacket::timestamp()
   return mTimestamp;
 }
 
+void TXPacket::setTargetSlot(int16_t slot)
+{
+  mTargetSlot = slot;
+}
+
+int16_t TXPacket::targetSlot()
+{
+  return mTargetSlot;
+}
+
 void TXPacket::setMessageType(const char *t)
 {
   strlcpy(mMessageType, t, sizeof mMessageType);
@@ -106,6 +125,31 @@ void TXPacket::addBit(uint8_t bit)
   ++mSize;
 }
 
+void TXPacket::addBits(uint32_t bits, uint8_t count)
+{
+  ASSERT(mSize + count <= MAX_AIS_TX_PACKET_SIZE);
+
+  while ( count )
+    {
+      uint16_t index = mSize / 8;
+      uint8_t offset = mSize % 8;
+      uint8_t n = count < 8 - offset ? count : 8 - offset;
+
+      mPacket[index] |= (bits & ((1 << n) - 1)) << offset;
+      bits >>= n;
+      count -= n;
+      mSize += n;
+    }
+}
+
+void TXPacket::copyFrame(const TXPacket &source)
+{
+  memcpy(mPacket, source.mPacket, sizeof mPacket);
+  mSize = source.mSize;
+  mPosition = 0;
+  strlcpy(mMessageType, source.mMessageType, sizeof mMessageType);
+}
+
 void TXPacket::pad()
 {
   uint16_t rem = 8 - mSize % 8;
@@ -123,7 +167,23 @@ bool TXPacket::eof()
 
 bool TXPacket::canRampDown()
 {
-  return mPosition == mSize - 3;
+  return mPosition == rampDownBit() + 1;
+}
+
+uint16_t TXPacket::rampDownBit()
+{
+  return mSize - 4;
+}
+
+const uint8_t *TXPacket::data()
+{
+  return mPacket;
+}
+
+uint8_t TXPacket::dataSize()
+{
+  uint16_t bytes = (mSize + 7) / 8;
+  return bytes < sizeof mPacket ? bytes : sizeof mPacket;
 }
 
 uint8_t TXPacket::nextBit()
@@ -158,12 +218,11 @@ TXPacketPool &TXPacketPool::instance()
 
 void TXPacketPool::init()
 {
-  mPool = new ObjectPool<TXPacket>(4);
 }
 
 TXPacket *TXPacketPool::newTXPacket(VHFChannel channel)
 {
-  TXPacket *p = mPool->get();
+  TXPacket *p = mPool.get();
   if ( !p )
     return p;
 
@@ -175,7 +234,23 @@ TXPacket *TXPacketPool::newTXPacket(VHFChannel channel)
 void TXPacketPool::deleteTXPacket(TXPacket* p)
 {
   ASSERT(p);
-  mPool->put(p);
+  mPool.put(p);
+}
+
+void TXPacketPool::reportStats()
+{
+  Event *e = EventPool::instance().newEvent(PROPR_NMEA_SENTENCE);
+  if ( !e )
+    return;
+
+  sprintf(e->nmeaBuffer.sentence, "$PAIPOOL,TXPKT,%lu,%lu,%lu,%lu*",
+      mPool.size(),
+      mPool.utilization(),
+      mPool.maxUtilization(),
+      mPool.allocFailures());
+
+  Utils::completeNMEA(e->nmeaBuffer.sentence);
+  EventQueue::instance().push(e);
 }
 
 
@@ -80,7 +80,8 @@ TXScheduler & TXScheduler::instance() {
  * Registers the TXScheduler as an observer for GPS_FIX_EVENT, CLOCK_EVENT, and INTERROGATION_EVENT.
  * Initializes default values for various transmission channels and timings.
  */
-TXScheduler::TXScheduler() {
+TXScheduler::TXScheduler()
+    : mMsg18Prefix(mMsg18Frame) {
     EventQueue::instance().addObserver(this, GPS_FIX_EVENT | CLOCK_EVENT | INTERROGATION_EVENT);
     mPositionReportChannel = CH_87;
     mStaticDataChannel = CH_87;
@@ -108,6 +109,40 @@ void TXScheduler::init() {
         reportTXStatus();
 }
 
+/**
+ * @brief Reloads the station data after it has been written or erased.
+ *
+ * The cached frames were encoded from the old station data, so they are encoded again when next needed.
+ */
+void TXScheduler::reloadStationData() {
+    Configuration::instance().readStationData(mStationData);
+    mStaticFramesValid = false;
+}
+
+/**
+ * @brief Encodes the frames that only depend on the station data.
+ *
+ * Messages 24A and 24B are sent as they are, so they are fully framed and NRZI encoded once.
+ * Every message 18 starts with the same 46 bits, so those are encoded once as a template,
+ * and each report only encodes its dynamic fields and the CRC on top of it.
+ */
+void TXScheduler::encodeStaticFrames() {
+    mMsg24AFrame.reset();
+    AISMessage24A msg24A;
+    msg24A.encode(mStationData, mMsg24AFrame);
+
+    mMsg24BFrame.reset();
+    AISMessage24B msg24B;
+    msg24B.encode(mStationData, mMsg24BFrame);
+
+    mMsg18Frame.reset();
+    mMsg18Prefix = HDLCEncoder(mMsg18Frame);
+    AISMessage18 msg18;
+    msg18.encodePrefix(mStationData, mMsg18Prefix);
+
+    mStaticFramesValid = true;
+}
+
 
 // replace code "samadhan
 
@@ -129,8 +164,10 @@ void TXScheduler::queueMessage24(VHFChannel channel)
         return;
     }
 
-    AISMessage24A msg2;
-    msg2.encode(mStationData, * p2);
+    if (!mStaticFramesValid)
+        encodeStaticFrames();
+
+    p2->copyFrame(mMsg24AFrame);
     RadioManager::instance().scheduleTransmission(p2);
 
     TXPacket * p3 = TXPacketPool::instance().newTXPacket(channel);
@@ -142,8 +179,7 @@ void TXScheduler::queueMessage24(VHFChannel channel)
         return;
     }
 
-    AISMessage24B msg3;
-    msg3.encode(mStationData, * p3);
+    p3->copyFrame(mMsg24BFrame);
     RadioManager::instance().scheduleTransmission(p3);
 }
 
@@ -298,13 +334,16 @@ void TXScheduler::queueMessage18(VHFChannel channel) {
         return;
     }
 
+    if (!mStaticFramesValid)
+        encodeStaticFrames();
+
     AISMessage18 msg;
     msg.latitude = mLastGPSFix.lat;
     msg.longitude = mLastGPSFix.lng;
     msg.sog = mLastGPSFix.speed;
     msg.cog = mLastGPSFix.cog;
     msg.utc = mLastGPSFix.utc;
-    msg.encode(mStationData, * p1);
+    msg.encode(mMsg18Prefix, * p1);
 
     RadioManager::instance().scheduleTransmission(p1);
 }
@@ -353,6 +392,11 @@ void TXScheduler::arbitrary_tx(VHFChannel channel, const arbitrary_tx_t & RREQre
         return;
     }
 
+    arb_msg msg;
+
+    msg.encode(RREQrequest, * p1);
+
+    RadioManager::instance().scheduleTransmission(p1);
 
  }
 
@@ -28,6 +28,13 @@
 #include "TXErrors.h"
 #include <stdio.h>
 #include "TXScheduler.hpp"
+#include "SlotMap.hpp"
+#include "SPIBus.hpp"
+
+#if TX_FIFO_MODE
+// Microseconds for a number of bits at 9600bps
+#define BIT_TIME_US(bits)     ((bits) * 1000000UL / 9600)
+#endif
 
 Transceiver::Transceiver(GPIO_TypeDef *sdnPort, uint32_t sdnPin, GPIO_TypeDef *csPort,
     uint32_t csPin, GPIO_TypeDef *dataPort, uint32_t dataPin,
@@ -39,6 +46,9 @@ Transceiver::Transceiver(GPIO_TypeDef *sdnPort, uint32_t sdnPin, GPIO_TypeDef *c
   mUTC = 0;
   mLastTXTime = 0;
   mChannel = CH_87;
+#if TX_FIFO_MODE
+  mTXEnding = false;
+#endif
 }
 
 void Transceiver::configure()
@@ -51,9 +61,45 @@ void Transceiver::configure()
   p.Group = 0x20;
   p.NumProperties = 1;
   p.StartProperty = 0x00;
+#if TX_FIFO_MODE
+  p.Data[0] = 0x03;               // 2GFSK modulation from the packet handler (TX FIFO)
+#else
   p.Data[0] = 0x20 | 0x08 | 0x03; // Synchronous direct mode from GPIO 1 with 2GFSK modulation
+#endif
+  sendCmd(SET_PROPERTY, &p, 4, NULL, 0);
+
+#if TX_FIFO_MODE
+  /*
+   * The frame in the FIFO is already complete (ramp, training sequence, flags and NRZI), so the packet handler
+   * must not add a preamble, a sync word, whitening or a CRC, and it must send the LSB of each byte first,
+   * which is how TXPacket stores it. None of this affects reception in direct mode.
+   */
+  p.Group = 0x10;
+  p.NumProperties = 1;
+  p.StartProperty = 0x00;
+  p.Data[0] = 0x00;               // PREAMBLE_TX_LENGTH
+  sendCmd(SET_PROPERTY, &p, 4, NULL, 0);
+
+  p.Group = 0x11;
+  p.NumProperties = 1;
+  p.StartProperty = 0x00;
+  p.Data[0] = 0x81;               // SYNC_CONFIG: skip the sync word in TX, 2 bytes in RX as before
+  sendCmd(SET_PROPERTY, &p, 4, NULL, 0);
+
+  p.Group = 0x12;
+  p.NumProperties = 1;
+  p.StartProperty = 0x06;
+  p.Data[0] = 0x03;               // PKT_CONFIG1: LSB first, CRC endianness as before
   sendCmd(SET_PROPERTY, &p, 4, NULL, 0);
 
+  p.Group = 0x12;
+  p.NumProperties = 2;
+  p.StartProperty = 0x0F;
+  p.Data[0] = 0x00;               // PKT_FIELD_1_CONFIG: no whitening or Manchester coding
+  p.Data[1] = 0x00;               // PKT_FIELD_1_CRC_CONFIG: no CRC
+  sendCmd(SET_PROPERTY, &p, 5, NULL, 0);
+#endif
+
   /**
    * We need maximum digital ramp control to reduce spurs. It's only about 200us, which
    * is less than the ramp-up bits in the TX packet, but it sure helped!
@@ -151,12 +197,20 @@ void Transceiver::setTXPower(const pa_params &pwr)
 
 void Transceiver::configureGPIOsForTX()
 {
-  bsp_set_tx_mode();
-
   GPIO_PIN_CFG_PARAMS gpiocfg;
   gpiocfg.GPIO0 = 0x00;       // No change
+#if TX_FIFO_MODE
+  bsp_set_fifo_tx_mode();
+  gpiocfg.GPIO1 = 0x00;       // No change, the data pin isn't used
+
+  // The clock pin goes high when the TX FIFO is almost empty (see loadTXFIFO()).
+  // Test packets and CW have no ramp down, so it goes straight to RX_STATE for them.
+  gpiocfg.GPIO2 = mTXPacket && !mTXPacket->isTestPacket() ? 0x23 : 0x21;
+#else
+  bsp_set_tx_mode();
   gpiocfg.GPIO1 = 0x04;       // RX/TX bit data
   gpiocfg.GPIO2 = 0x1F;       // RX/TX bit clock
+#endif
 #if BOARD_REV < 105
   gpiocfg.GPIO3 = 0x21;       // RX_STATE; low during TX and high during RX
 #else
@@ -172,8 +226,33 @@ void Transceiver::configureGPIOsForTX()
 void Transceiver::assignTXPacket(TXPacket *p)
 {
   ASSERT(!mTXPacket);
+  p->setTimestamp(mUTC);
+  if ( !p->isTestPacket() )
+    targetFreeSlot(p);
+
+#if TX_FIFO_MODE
+  loadTXFIFO(p);
+#endif
+
+  // The bit clock interrupt may pick it up right away, so it must be complete by now
   mTXPacket = p;
-  mTXPacket->setTimestamp(mUTC);
+}
+
+/**
+ * Picks the earliest slot that has been free in all the frames the slot map remembers, far enough ahead
+ * to switch channels. Without one, the packet goes out in the first slot with a clear channel as before.
+ */
+void Transceiver::targetFreeSlot(TXPacket *p)
+{
+  SlotMap &map = SlotMap::instance();
+  uint32_t slot = map.currentSlot();
+  if ( slot == 0xffffffff )
+    {
+      p->setTargetSlot(-1);
+      return;
+    }
+
+  p->setTargetSlot(map.findFreeSlot(p->channel(), (slot + SLOT_MAP_TX_LEAD) % SLOT_MAP_SLOTS, 0, SLOT_MAP_TX_RANGE));
 }
 
 TXPacket* Transceiver::assignedTXPacket()
@@ -181,6 +260,47 @@ TXPacket* Transceiver::assignedTXPacket()
   return mTXPacket;
 }
 
+#if TX_FIFO_MODE
+
+/**
+ * This method is called in interrupt context, on rising edges of the clock pin during transmission.
+ * Edges left behind by reconfiguring the pin are ignored, as the level is low then.
+ */
+void Transceiver::onFIFOTXEvent()
+{
+  if ( HAL_GPIO_ReadPin(mClockGPIO, mClockPin) == GPIO_PIN_RESET )
+    return;
+
+  if ( mTXEnding )
+    {
+      // The chip is back in RX
+      bsp_stop_tx_timer();
+      finishTransmitting();
+      return;
+    }
+
+  // The byte with the ramp down bit has started, so time the ramp down from here
+  bsp_start_tx_timer(BIT_TIME_US(mTXPacket->rampDownBit() % 8));
+  mTXEnding = true;
+
+  GPIO_PIN_CFG_PARAMS gpiocfg;
+  memset(&gpiocfg, 0, sizeof gpiocfg);  // No change, except:
+  gpiocfg.GPIO2 = 0x21;                 // RX_STATE
+  sendCmd(GPIO_PIN_CFG, &gpiocfg, sizeof gpiocfg, NULL, 0);
+}
+
+#endif
+
+/**
+ * This method is called in interrupt context
+ */
+void Transceiver::onTXTimer()
+{
+  // See canRampDown() below
+  if ( gRadioState == RADIO_TRANSMITTING )
+    HAL_GPIO_WritePin(PA_BIAS_PORT, PA_BIAS_PIN, GPIO_PIN_RESET);
+}
+
 /**
  * This method is called in interrupt context
  */
@@ -193,9 +313,10 @@ void Transceiver::onBitClock()
           We start transmitting a packet if:
             - We have a TX packet assigned
             - Transmission is enabled
-            - We are at bit CCA_SLOT_BIT+1 (after obtaining an RSSI level)
+            - We are at bit CCA_SLOT_BIT+1 (after obtaining the last of CCA_SAMPLES RSSI levels)
             - The TX packet's transmission channel is our current listening channel
-            - The RSSI is within 6dB of the noise floor for this channel
+            - This is the TX packet's target slot, if it has one
+            - The loudest CCA sample is within TX_CCA_HEADROOM dB of the noise floor for this channel
             - It's been at least MIN_TX_INTERVAL seconds since our last transmission
        */
 
@@ -236,10 +357,11 @@ void Transceiver::onBitClock()
           // It's not time to transmit yet
           return;
         }
-      else if ( mUTC && mSlotBitNumber == CCA_SLOT_BIT && mTXPacket->channel() == mChannel )
+      else if ( mUTC && mSlotBitNumber == CCA_SLOT_BIT && mTXPacket->channel() == mChannel &&
+                ( mTXPacket->targetSlot() < 0 || (uint32_t)mTXPacket->targetSlot() == mTimeSlot ) )
         {
-          // It has already been sampled during Receiver::onBitClock();
-          int rssi = mRXPacket->rssi();
+          // The loudest of the samples taken during Receiver::onBitClock() up to this bit
+          int rssi = mCCARSSI;
           int nf = NoiseFloorDetector::instance().getNoiseFloor(AIS_CHANNELS[mChannel].designation);
           if ( rssi <= nf + TX_CCA_HEADROOM )
             {
@@ -250,14 +372,12 @@ void Transceiver::onBitClock()
     }
   else if ( mTXPacket )
     {
+#if TX_FIFO_MODE
+      onFIFOTXEvent();
+#else
       if ( mTXPacket->eof() )
         {
-          mLastTXTime = mUTC;
-          startReceiving(mChannel, true);
-          gRadioState = RADIO_RECEIVING;
-          reportTXEvent();
-          TXPacketPool::instance().deleteTXPacket(mTXPacket);
-          mTXPacket = NULL;
+          finishTransmitting();
         }
       else
         {
@@ -279,6 +399,7 @@ void Transceiver::onBitClock()
           if ( mTXPacket->canRampDown() )
             HAL_GPIO_WritePin(PA_BIAS_PORT, PA_BIAS_PIN, GPIO_PIN_RESET);
         }
+#endif
     }
   else
     {
@@ -291,6 +412,11 @@ void Transceiver::timeSlotStarted(uint32_t slot)
 {
   Receiver::timeSlotStarted(slot);
 
+  // If the target slot went by without a transmission (busy channel, too soon after the last one), pick another
+  if ( mTXPacket && !mTXPacket->isTestPacket() && mTXPacket->targetSlot() >= 0 &&
+       (mTXPacket->targetSlot() + SLOT_MAP_SLOTS - slot) % SLOT_MAP_SLOTS > SLOT_MAP_TX_LEAD + SLOT_MAP_TX_RANGE )
+    targetFreeSlot(mTXPacket);
+
   // Switch channel if we have a transmission scheduled and we're not on the right channel
   if ( gRadioState == RADIO_RECEIVING && mTXPacket && mTXPacket->channel() != mChannel )
     startReceiving(mTXPacket->channel(), false);
@@ -308,6 +434,10 @@ void Transceiver::startTransmitting()
   //ASSERT(false);
 
 
+#if TX_FIFO_MODE
+  mTXEnding = mTXPacket->isTestPacket();
+  startFIFOTX(mTXPacket);
+#else
   TX_OPTIONS options;
   options.channel     = AIS_CHANNELS[mTXPacket->channel()].ordinal;
   options.condition   = 0;
@@ -316,12 +446,23 @@ void Transceiver::startTransmitting()
   options.repeats     = 0;
 
   sendCmd(START_TX, &options, sizeof options, NULL, 0);
+#endif
 
   // Ensure all data changes in the function have completed, otherwise gRadioState may not actually be modified
   __DSB();
 
 }
 
+void Transceiver::finishTransmitting()
+{
+  mLastTXTime = mUTC;
+  startReceiving(mChannel, true);
+  gRadioState = RADIO_RECEIVING;
+  reportTXEvent();
+  TXPacketPool::instance().deleteTXPacket(mTXPacket);
+  mTXPacket = NULL;
+}
+
 void Transceiver::startReceiving(VHFChannel channel, bool reconfigGPIOs)
 {
   Receiver::startReceiving(channel, reconfigGPIOs);
@@ -43,6 +43,10 @@ IWDG_HandleTypeDef hiwdg;
 UART_HandleTypeDef huart2;
 UART_HandleTypeDef huart1;
 TIM_HandleTypeDef htim2;
+DMA_HandleTypeDef hdma_tim2_ch2;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 void SystemClock_Config();
 
@@ -53,6 +57,17 @@ irq_callback sotdmaCallback = nullptr;
 irq_callback trxClockCallback = nullptr;
 irq_callback rxClockCallback = nullptr;
 irq_callback tickCallback = nullptr;
+irq_callback slotBitCallback = nullptr;
+irq_callback spiTransferCallback = nullptr;
+irq_callback spiTriggerCallback = nullptr;
+irq_callback txTimerCallback = nullptr;
+rx_samples_cb rxSamplesCallback = nullptr;
+
+// Two halves of 128 samples, i.e. half a slot each
+#define RX_SAMPLE_BUFFER_SIZE     256
+uint8_t __rxSamples[RX_SAMPLE_BUFFER_SIZE];
+irq_callback rxDecoderCallback = nullptr;
+irq_callback terminalTXCallback = nullptr;
 
 // This should be plenty big (no need to be a whole flash page)
 typedef union
@@ -89,7 +104,11 @@ static const GPIO __gpios[] = {
     {UART_RX_PORT, {UART_RX_PIN, GPIO_MODE_AF_PP, GPIO_PULLUP, GPIO_SPEED_LOW, GPIO_AF7_USART1}, GPIO_PIN_RESET},
     {GNSS_STATE_PORT, {GNSS_STATE_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, GPIO_SPEED_LOW, 0}, GPIO_PIN_RESET},
     {SDN2_PORT, {SDN2_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, GPIO_SPEED_LOW, 0}, GPIO_PIN_SET},
+#if RX_DMA_SAMPLING
+    {RX_IC_CLK_PORT, {RX_IC_CLK_PIN, GPIO_MODE_AF_PP, GPIO_NOPULL, GPIO_SPEED_LOW, GPIO_AF1_TIM2}, GPIO_PIN_RESET},
+#else
     {RX_IC_CLK_PORT, {RX_IC_CLK_PIN, GPIO_MODE_IT_RISING, GPIO_NOPULL, GPIO_SPEED_LOW, 0}, GPIO_PIN_RESET},
+#endif
     {RX_IC_DATA_PORT, {RX_IC_DATA_PIN, GPIO_MODE_INPUT, GPIO_NOPULL, GPIO_SPEED_LOW, 0}, GPIO_PIN_RESET},
     {PA_BIAS_PORT, {PA_BIAS_PIN, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL, GPIO_SPEED_LOW, 0}, GPIO_PIN_RESET},
     {I2C_SCL_PORT, {I2C_SCL_PIN, GPIO_MODE_AF_OD, GPIO_PULLUP, GPIO_SPEED_HIGH, GPIO_AF4_I2C1}, GPIO_PIN_SET},
@@ -109,6 +128,9 @@ extern "C"
 
 
 void gpio_pin_init();
+void rx_samples_half(DMA_HandleTypeDef *hdma);
+void rx_samples_full(DMA_HandleTypeDef *hdma);
+void terminal_dma_complete(DMA_HandleTypeDef *hdma);
 
 void bsp_hw_init()
 {
@@ -124,6 +146,7 @@ void bsp_hw_init()
   __HAL_RCC_SPI1_CLK_ENABLE();
   __HAL_RCC_TIM2_CLK_ENABLE();
   __HAL_RCC_I2C1_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
 
   gpio_pin_init();
 
@@ -146,6 +169,28 @@ void bsp_hw_init()
   HAL_NVIC_EnableIRQ(USART1_IRQn);
   __HAL_UART_ENABLE_IT(&huart1, UART_IT_RXNE);
 
+  // USART1 TX DMA (channel 4, request 2). Completion runs below the RF IC clock interrupts.
+  hdma_usart1_tx.Instance                 = DMA1_Channel4;
+  hdma_usart1_tx.Init.Request             = DMA_REQUEST_2;
+  hdma_usart1_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+  hdma_usart1_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_usart1_tx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart1_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma_usart1_tx.Init.Mode                = DMA_NORMAL;
+  hdma_usart1_tx.Init.Priority            = DMA_PRIORITY_LOW;
+  if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+    {
+      Error_Handler(0);
+    }
+
+  hdma_usart1_tx.XferCpltCallback   = terminal_dma_complete;
+  hdma_usart1_tx.XferErrorCallback  = terminal_dma_complete;
+  SET_BIT(USART1->CR3, USART_CR3_DMAT);
+
+  HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+
 
   // SPI
 
@@ -171,6 +216,51 @@ void bsp_hw_init()
 
   __HAL_SPI_ENABLE(&hspi1);
 
+  /*
+   * SPI1 DMA: RX on channel 2 and TX on channel 3 (request 1). Transfers are started and completed
+   * above everything else, so a command to one RF IC never gets interleaved with another.
+   */
+  hdma_spi1_rx.Instance                 = DMA1_Channel2;
+  hdma_spi1_rx.Init.Request             = DMA_REQUEST_1;
+  hdma_spi1_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_spi1_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_spi1_rx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_spi1_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma_spi1_rx.Init.Mode                = DMA_NORMAL;
+  hdma_spi1_rx.Init.Priority            = DMA_PRIORITY_HIGH;
+  if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK)
+    {
+      Error_Handler(0);
+    }
+  __HAL_LINKDMA(&hspi1, hdmarx, hdma_spi1_rx);
+
+  hdma_spi1_tx.Instance                 = DMA1_Channel3;
+  hdma_spi1_tx.Init.Request             = DMA_REQUEST_1;
+  hdma_spi1_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+  hdma_spi1_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_spi1_tx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_spi1_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma_spi1_tx.Init.Mode                = DMA_NORMAL;
+  hdma_spi1_tx.Init.Priority            = DMA_PRIORITY_HIGH;
+  if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
+    {
+      Error_Handler(0);
+    }
+  __HAL_LINKDMA(&hspi1, hdmatx, hdma_spi1_tx);
+
+  HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+  HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+  HAL_NVIC_SetPriority(SPI1_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(SPI1_IRQn);
+
+  // The single wire protocol master is not used, so its vector is pended by software to start SPI transfers
+  HAL_NVIC_SetPriority(SWPMI1_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(SWPMI1_IRQn);
+
 
   // I2C
   hi2c1.Instance                = I2C1;
@@ -241,8 +331,56 @@ void bsp_hw_init()
   HAL_NVIC_SetPriority(EXTI15_10_IRQn, 1, 0);
   HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 
+  // TIM16 is a one-shot timer for FIFO transmissions. URS keeps software updates from raising an interrupt.
+  __HAL_RCC_TIM16_CLK_ENABLE();
+  TIM16->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+  TIM16->DIER = TIM_DIER_UIE;
+
+  // Same level as the transceiver's clock interrupt, so they never preempt each other
+  HAL_NVIC_SetPriority(TIM1_UP_TIM16_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
+
+#if RX_DMA_SAMPLING
+  /*
+   * The receiver's data clock (PB3) is TIM2 input capture 2. Every rising edge makes DMA1 channel 7 (request 4)
+   * copy the low byte of GPIOB->IDR, which holds the data pin (PB4). Capture does not depend on the counter running,
+   * so sampling continues while the SOTDMA timer is stopped.
+   */
+  TIM_IC_InitTypeDef ic;
+  ic.ICPolarity   = TIM_ICPOLARITY_RISING;
+  ic.ICSelection  = TIM_ICSELECTION_DIRECTTI;
+  ic.ICPrescaler  = TIM_ICPSC_DIV1;
+  ic.ICFilter     = 0;
+  HAL_TIM_IC_ConfigChannel(&htim2, &ic, TIM_CHANNEL_2);
+
+  hdma_tim2_ch2.Instance                 = DMA1_Channel7;
+  hdma_tim2_ch2.Init.Request             = DMA_REQUEST_4;
+  hdma_tim2_ch2.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_tim2_ch2.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_tim2_ch2.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_tim2_ch2.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_tim2_ch2.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  hdma_tim2_ch2.Init.Mode                = DMA_CIRCULAR;
+  hdma_tim2_ch2.Init.Priority            = DMA_PRIORITY_VERY_HIGH;
+  if (HAL_DMA_Init(&hdma_tim2_ch2) != HAL_OK)
+    {
+      Error_Handler(0);
+    }
+
+  hdma_tim2_ch2.XferHalfCpltCallback = rx_samples_half;
+  hdma_tim2_ch2.XferCpltCallback     = rx_samples_full;
+
+  // Same level as the decoder, so the SOTDMA timer (and the slot number) always wins
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+#else
   HAL_NVIC_SetPriority(EXTI3_IRQn, 1, 0);
   HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+#endif
+
+  // The touch sensing controller is not used, so its vector is pended by software to run the RX decoders
+  HAL_NVIC_SetPriority(TSC_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(TSC_IRQn);
 
   bsp_read_station_data(&__station);
 }
@@ -542,15 +680,100 @@ void USART_putc(USART_TypeDef* USARTx, char c)
   USARTx->TDR = c;
 }
 
+/*
+ * Blocking writes must not interleave with a DMA transfer. The completion interrupt is held off until the
+ * write is done, otherwise it could restart the DMA from the ring while we are still writing.
+ */
+static uint32_t lock_terminal_dma()
+{
+  uint32_t enabled = NVIC_GetEnableIRQ(DMA1_Channel4_IRQn);
+  NVIC_DisableIRQ(DMA1_Channel4_IRQn);
+
+  if ( hdma_usart1_tx.Instance )
+    while ( hdma_usart1_tx.Instance->CNDTR )
+      ;
+
+  return enabled;
+}
+
+static void unlock_terminal_dma(uint32_t enabled)
+{
+  if ( enabled )
+    NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+}
+
 void bsp_write_char(char c)
 {
+  uint32_t lock = lock_terminal_dma();
   USART_putc(USART1, c);
+  unlock_terminal_dma(lock);
 }
 
 void bsp_write_string(const char *s)
 {
+  uint32_t lock = lock_terminal_dma();
   for ( int i = 0; s[i] != 0; ++i )
     USART_putc(USART1, s[i]);
+  unlock_terminal_dma(lock);
+}
+
+bool bsp_start_terminal_tx(const uint8_t *data, uint16_t len)
+{
+  return HAL_DMA_Start_IT(&hdma_usart1_tx, (uint32_t)data, (uint32_t)&USART1->TDR, len) == HAL_OK;
+}
+
+void bsp_set_terminal_tx_callback(irq_callback cb)
+{
+  terminalTXCallback = cb;
+}
+
+void terminal_dma_complete(DMA_HandleTypeDef *)
+{
+  if ( terminalTXCallback )
+    terminalTXCallback();
+}
+
+void bsp_set_rx_decoder_callback(irq_callback cb)
+{
+  rxDecoderCallback = cb;
+}
+
+void bsp_trigger_rx_decoder()
+{
+  NVIC_SetPendingIRQ(TSC_IRQn);
+}
+
+void bsp_set_rx_samples_callback(rx_samples_cb cb)
+{
+  rxSamplesCallback = cb;
+}
+
+void bsp_start_rx_sampling()
+{
+  HAL_DMA_Start_IT(&hdma_tim2_ch2, (uint32_t)&GPIOB->IDR, (uint32_t)__rxSamples, RX_SAMPLE_BUFFER_SIZE);
+  __HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_CC2);
+  TIM_CCxChannelCmd(TIM2, TIM_CHANNEL_2, TIM_CCx_ENABLE);
+}
+
+void rx_samples_half(DMA_HandleTypeDef *)
+{
+  if ( rxSamplesCallback )
+    rxSamplesCallback(__rxSamples, RX_SAMPLE_BUFFER_SIZE / 2);
+}
+
+void rx_samples_full(DMA_HandleTypeDef *)
+{
+  if ( rxSamplesCallback )
+    rxSamplesCallback(__rxSamples + RX_SAMPLE_BUFFER_SIZE / 2, RX_SAMPLE_BUFFER_SIZE / 2);
+}
+
+void bsp_set_slot_bit_callback(irq_callback cb, uint8_t bit)
+{
+  slotBitCallback = cb;
+
+  // A slot is 256 bits long and the timer period is exactly one slot
+  TIM2->CCR1 = (uint32_t)(((uint64_t)TIM2->ARR + 1) * bit / 256);
+  __HAL_TIM_ENABLE_IT(&htim2, TIM_IT_CC1);
 }
 
 void bsp_start_wdt()
@@ -588,12 +811,19 @@ void bsp_set_tick_callback(irq_callback cb)
 
 void bsp_start_sotdma_timer()
 {
+  if ( slotBitCallback )
+    __HAL_TIM_ENABLE_IT(&htim2, TIM_IT_CC1);
+
   HAL_TIM_Base_Start_IT(&htim2);
 }
 
 void bsp_stop_sotdma_timer()
 {
   HAL_TIM_Base_Stop_IT(&htim2);
+
+  // HAL leaves the counter running while a capture channel is enabled
+  __HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC1);
+  TIM2->CR1 &= ~TIM_CR1_CEN;
 }
 
 void bsp_set_gnss_1pps_callback(irq_callback cb)
@@ -638,6 +868,58 @@ uint8_t bsp_tx_spi_byte(uint8_t data)
   return result;
 }
 
+bool bsp_start_spi_transfer(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+  return HAL_SPI_TransmitReceive_DMA(&hspi1, (uint8_t*)tx, rx, len) == HAL_OK;
+}
+
+void bsp_set_spi_transfer_callback(irq_callback cb)
+{
+  spiTransferCallback = cb;
+}
+
+void bsp_set_spi_trigger_callback(irq_callback cb)
+{
+  spiTriggerCallback = cb;
+}
+
+void bsp_trigger_spi()
+{
+  NVIC_SetPendingIRQ(SWPMI1_IRQn);
+}
+
+void bsp_set_fifo_tx_mode()
+{
+  HAL_GPIO_WritePin(PA_BIAS_PORT, PA_BIAS_PIN, GPIO_PIN_SET);       // RF MOSFET bias voltage
+}
+
+void bsp_set_tx_timer_callback(irq_callback cb)
+{
+  txTimerCallback = cb;
+}
+
+void bsp_start_tx_timer(uint32_t us)
+{
+  // The prescaler keeps the period within the 16 bit counter
+  uint32_t scale = us / 0x10000 + 1;
+  uint32_t ticks = us / scale;
+
+  TIM16->CR1 &= ~TIM_CR1_CEN;
+  TIM16->PSC = SystemCoreClock / 1000000 * scale - 1;
+  TIM16->ARR = ticks > 1 ? ticks - 1 : 1;
+  TIM16->CNT = 0;
+  TIM16->EGR = TIM_EGR_UG;
+  TIM16->SR = 0;
+  TIM16->CR1 |= TIM_CR1_CEN;
+}
+
+void bsp_stop_tx_timer()
+{
+  TIM16->CR1 &= ~TIM_CR1_CEN;
+  TIM16->SR = 0;
+  NVIC_ClearPendingIRQ(TIM1_UP_TIM16_IRQn);
+}
+
 void bsp_reboot()
 {
   NVIC_SystemReset();
@@ -686,6 +968,55 @@ extern "C"
       }
   }
 
+  void DMA1_Channel4_IRQHandler(void)
+  {
+    HAL_DMA_IRQHandler(&hdma_usart1_tx);
+  }
+
+  void DMA1_Channel2_IRQHandler(void)
+  {
+    HAL_DMA_IRQHandler(&hdma_spi1_rx);
+  }
+
+  void DMA1_Channel3_IRQHandler(void)
+  {
+    HAL_DMA_IRQHandler(&hdma_spi1_tx);
+  }
+
+  void SPI1_IRQHandler(void)
+  {
+    HAL_SPI_IRQHandler(&hspi1);
+  }
+
+  void SWPMI1_IRQHandler(void)
+  {
+    if ( spiTriggerCallback )
+      spiTriggerCallback();
+  }
+
+  void TIM1_UP_TIM16_IRQHandler(void)
+  {
+    if ( TIM16->SR & TIM_SR_UIF )
+      {
+        TIM16->SR = ~TIM_SR_UIF;
+        if ( txTimerCallback )
+          txTimerCallback();
+      }
+  }
+
+  void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *)
+  {
+    if ( spiTransferCallback )
+      spiTransferCallback();
+  }
+
+  // The transfer is over either way. A garbled CTS poll is simply repeated.
+  void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *)
+  {
+    if ( spiTransferCallback )
+      spiTransferCallback();
+  }
+
   void EXTI2_IRQHandler(void)
   {
     if ( __HAL_GPIO_EXTI_GET_IT(GNSS_1PPS_PIN) != RESET )
@@ -719,6 +1050,21 @@ extern "C"
               sotdmaCallback();
           }
       }
+
+    if(__HAL_TIM_GET_FLAG(&htim2, TIM_FLAG_CC1) != RESET)
+      {
+        if(__HAL_TIM_GET_IT_SOURCE(&htim2, TIM_IT_CC1) !=RESET)
+          {
+            __HAL_TIM_CLEAR_IT(&htim2, TIM_IT_CC1);
+            if ( slotBitCallback )
+              slotBitCallback();
+          }
+      }
+  }
+
+  void DMA1_Channel7_IRQHandler(void)
+  {
+    HAL_DMA_IRQHandler(&hdma_tim2_ch2);
   }
 
   void EXTI3_IRQHandler(void)
@@ -741,6 +1087,12 @@ extern "C"
       }
   }
 
+  void TSC_IRQHandler(void)
+  {
+    if ( rxDecoderCallback )
+      rxDecoderCallback();
+  }
+
   void HAL_SYSTICK_Callback()
   {
     if ( tickCallback )
@@ -20,6 +20,7 @@
 #include "config.h"
 #include "RadioManager.hpp"
 #include "RXPacketProcessor.hpp"
+#include "RXFunnel.hpp"
 #include "DataTerminal.hpp"
 #include "TXScheduler.hpp"
 #include "GPS.hpp"
@@ -27,6 +28,7 @@
 #include "CommandProcessor.hpp"
 #include "bsp/bsp.hpp"
 #include "AODV_mesh.hpp"
+#include "PerfTrace.hpp"
 
 
 
@@ -55,11 +57,15 @@ void mainLoop()
 
   EventPool::instance().init();
   EventQueue::instance().init();
+#if EVENT_LATENCY_TRACING
+  PerfTrace::instance().init();
+#endif
   Configuration::instance().init();
   DataTerminal::instance().init();
   CommandProcessor::instance().init();
   AODVmesh::instance().init();
-  RXPacketProcessor packetProcessor;
+  RXPacketProcessor::instance().init();
+  RXFunnel::instance().init();
   GPS::instance().init();
   TXPacketPool::instance().init();
   TXScheduler::instance().init();
@@ -70,7 +70,7 @@ void printf_serial(const char *format, ...)
 #ifdef MULTIPLEXED_OUTPUT
       DataTerminal::instance().write("DEBUG", __buffer);
 #else
-      bsp_write_string(__buffer);
+      DataTerminal::instance().write(__buffer);
 #endif
     }
 }
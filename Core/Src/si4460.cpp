@@ -8,11 +8,17 @@
 
 #include <stdint.h>
 #include "radio_config_si4460.h"
+#include "RadioConfigDelta.hpp"
 
 
-static uint8_t __si_4460_cfg[] = RADIO_CONFIGURATION_DATA_ARRAY;
+static constexpr uint8_t __si_4460_wds[] = RADIO_CONFIGURATION_DATA_ARRAY;
 
-uint8_t* get_si4460_config_array()
+static_assert(radioConfigValid(__si_4460_wds), "Malformed Si4460 configuration array");
+static_assert(radioConfigHasBase(__si_4460_wds), "The Si4460 configuration array no longer agrees with RADIO_CONFIG_BASE");
+
+static constexpr auto __si_4460_cfg = radioConfigDelta<radioConfigDeltaSize(__si_4460_wds)>(__si_4460_wds);
+
+const uint8_t* get_si4460_config_array()
 {
-  return __si_4460_cfg;
+  return __si_4460_cfg.bytes;
 }
@@ -8,13 +8,19 @@
 
 #include <stdint.h>
 #include "radio_config_Si4463_nonstd_preamble.h"
+#include "RadioConfigDelta.hpp"
 
 
-static uint8_t __si_4463_cfg[] = RADIO_CONFIGURATION_DATA_ARRAY;
+static constexpr uint8_t __si_4463_wds[] = RADIO_CONFIGURATION_DATA_ARRAY;
 
-uint8_t* get_si4463_config_array()
+static_assert(radioConfigValid(__si_4463_wds), "Malformed Si4463 configuration array");
+static_assert(radioConfigHasBase(__si_4463_wds), "The Si4463 configuration array no longer agrees with RADIO_CONFIG_BASE");
+
+static constexpr auto __si_4463_cfg = radioConfigDelta<radioConfigDeltaSize(__si_4463_wds)>(__si_4463_wds);
+
+const uint8_t* get_si4463_config_array()
 {
-  return __si_4463_cfg;
+  return __si_4463_cfg.bytes;
 }
 
 
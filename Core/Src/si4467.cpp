@@ -7,11 +7,17 @@
 
 #include <stdint.h>
 #include "radio_config_si4467.h"
+#include "RadioConfigDelta.hpp"
 
 
-static uint8_t __si_4467_cfg[] = RADIO_CONFIGURATION_DATA_ARRAY;
+static constexpr uint8_t __si_4467_wds[] = RADIO_CONFIGURATION_DATA_ARRAY;
 
-uint8_t* get_si4467_config_array()
+static_assert(radioConfigValid(__si_4467_wds), "Malformed Si4467 configuration array");
+static_assert(radioConfigHasBase(__si_4467_wds), "The Si4467 configuration array no longer agrees with RADIO_CONFIG_BASE");
+
+static constexpr auto __si_4467_cfg = radioConfigDelta<radioConfigDeltaSize(__si_4467_wds)>(__si_4467_wds);
+
+const uint8_t* get_si4467_config_array()
 {
-  return __si_4467_cfg;
+  return __si_4467_cfg.bytes;
 }
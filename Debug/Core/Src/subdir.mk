@@ -5,6 +5,7 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
+../Core/Src/AISDecoder.cpp \
 ../Core/Src/AISMessages.cpp \
 ../Core/Src/AODV_mesh.cpp \
 ../Core/Src/ChannelManager.cpp \
@@ -14,15 +15,21 @@ CPP_SRCS += \
 ../Core/Src/EventQueue.cpp \
 ../Core/Src/Events.cpp \
 ../Core/Src/GPS.cpp \
+../Core/Src/HDLCDecoder.cpp \
+../Core/Src/HDLCEncoder.cpp \
 ../Core/Src/LEDManager.cpp \
 ../Core/Src/NMEAEncoder.cpp \
 ../Core/Src/NMEASentence.cpp \
 ../Core/Src/NoiseFloorDetector.cpp \
+../Core/Src/PerfTrace.cpp \
 ../Core/Src/RFIC.cpp \
+../Core/Src/RXFunnel.cpp \
 ../Core/Src/RXPacket.cpp \
 ../Core/Src/RXPacketProcessor.cpp \
 ../Core/Src/RadioManager.cpp \
 ../Core/Src/Receiver.cpp \
+../Core/Src/SPIBus.cpp \
+../Core/Src/SlotMap.cpp \
 ../Core/Src/TXPacket.cpp \
 ../Core/Src/TXScheduler.cpp \
 ../Core/Src/Transceiver.cpp \
@@ -47,6 +54,7 @@ C_DEPS += \
 ./Core/Src/system_stm32l4xx.d 
 
 OBJS += \
+./Core/Src/AISDecoder.o \
 ./Core/Src/AISMessages.o \
 ./Core/Src/AODV_mesh.o \
 ./Core/Src/ChannelManager.o \
@@ -56,15 +64,21 @@ OBJS += \
 ./Core/Src/EventQueue.o \
 ./Core/Src/Events.o \
 ./Core/Src/GPS.o \
+./Core/Src/HDLCDecoder.o \
+./Core/Src/HDLCEncoder.o \
 ./Core/Src/LEDManager.o \
 ./Core/Src/NMEAEncoder.o \
 ./Core/Src/NMEASentence.o \
 ./Core/Src/NoiseFloorDetector.o \
+./Core/Src/PerfTrace.o \
 ./Core/Src/RFIC.o \
+./Core/Src/RXFunnel.o \
 ./Core/Src/RXPacket.o \
 ./Core/Src/RXPacketProcessor.o \
 ./Core/Src/RadioManager.o \
 ./Core/Src/Receiver.o \
+./Core/Src/SPIBus.o \
+./Core/Src/SlotMap.o \
 ./Core/Src/TXPacket.o \
 ./Core/Src/TXScheduler.o \
 ./Core/Src/Transceiver.o \
@@ -81,6 +95,7 @@ OBJS += \
 ./Core/Src/system_stm32l4xx.o 
 
 CPP_DEPS += \
+./Core/Src/AISDecoder.d \
 ./Core/Src/AISMessages.d \
 ./Core/Src/AODV_mesh.d \
 ./Core/Src/ChannelManager.d \
@@ -90,15 +105,21 @@ CPP_DEPS += \
 ./Core/Src/EventQueue.d \
 ./Core/Src/Events.d \
 ./Core/Src/GPS.d \
+./Core/Src/HDLCDecoder.d \
+./Core/Src/HDLCEncoder.d \
 ./Core/Src/LEDManager.d \
 ./Core/Src/NMEAEncoder.d \
 ./Core/Src/NMEASentence.d \
 ./Core/Src/NoiseFloorDetector.d \
+./Core/Src/PerfTrace.d \
 ./Core/Src/RFIC.d \
+./Core/Src/RXFunnel.d \
 ./Core/Src/RXPacket.d \
 ./Core/Src/RXPacketProcessor.d \
 ./Core/Src/RadioManager.d \
 ./Core/Src/Receiver.d \
+./Core/Src/SPIBus.d \
+./Core/Src/SlotMap.d \
 ./Core/Src/TXPacket.d \
 ./Core/Src/TXScheduler.d \
 ./Core/Src/Transceiver.d \
@@ -120,7 +141,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/AISMessages.cyclo ./Core/Src/AISMessages.d ./Core/Src/AISMessages.o ./Core/Src/AISMessages.su ./Core/Src/AODV_mesh.cyclo ./Core/Src/AODV_mesh.d ./Core/Src/AODV_mesh.o ./Core/Src/AODV_mesh.su ./Core/Src/ChannelManager.cyclo ./Core/Src/ChannelManager.d ./Core/Src/ChannelManager.o ./Core/Src/ChannelManager.su ./Core/Src/CommandProcessor.cyclo ./Core/Src/CommandProcessor.d ./Core/Src/CommandProcessor.o ./Core/Src/CommandProcessor.su ./Core/Src/Configuration.cyclo ./Core/Src/Configuration.d ./Core/Src/Configuration.o ./Core/Src/Configuration.su ./Core/Src/DataTerminal.cyclo ./Core/Src/DataTerminal.d ./Core/Src/DataTerminal.o ./Core/Src/DataTerminal.su ./Core/Src/EventQueue.cyclo ./Core/Src/EventQueue.d ./Core/Src/EventQueue.o ./Core/Src/EventQueue.su ./Core/Src/Events.cyclo ./Core/Src/Events.d ./Core/Src/Events.o ./Core/Src/Events.su ./Core/Src/GPS.cyclo ./Core/Src/GPS.d ./Core/Src/GPS.o ./Core/Src/GPS.su ./Core/Src/LEDManager.cyclo ./Core/Src/LEDManager.d ./Core/Src/LEDManager.o ./Core/Src/LEDManager.su ./Core/Src/NMEAEncoder.cyclo ./Core/Src/NMEAEncoder.d ./Core/Src/NMEAEncoder.o ./Core/Src/NMEAEncoder.su ./Core/Src/NMEASentence.cyclo ./Core/Src/NMEASentence.d ./Core/Src/NMEASentence.o ./Core/Src/NMEASentence.su ./Core/Src/NoiseFloorDetector.cyclo ./Core/Src/NoiseFloorDetector.d ./Core/Src/NoiseFloorDetector.o ./Core/Src/NoiseFloorDetector.su ./Core/Src/RFIC.cyclo ./Core/Src/RFIC.d ./Core/Src/RFIC.o ./Core/Src/RFIC.su ./Core/Src/RXPacket.cyclo ./Core/Src/RXPacket.d ./Core/Src/RXPacket.o ./Core/Src/RXPacket.su ./Core/Src/RXPacketProcessor.cyclo ./Core/Src/RXPacketProcessor.d ./Core/Src/RXPacketProcessor.o ./Core/Src/RXPacketProcessor.su ./Core/Src/RadioManager.cyclo ./Core/Src/RadioManager.d ./Core/Src/RadioManager.o ./Core/Src/RadioManager.su ./Core/Src/Receiver.cyclo ./Core/Src/Receiver.d ./Core/Src/Receiver.o ./Core/Src/Receiver.su ./Core/Src/TXPacket.cyclo ./Core/Src/TXPacket.d ./Core/Src/TXPacket.o ./Core/Src/TXPacket.su ./Core/Src/TXScheduler.cyclo ./Core/Src/TXScheduler.d ./Core/Src/TXScheduler.o ./Core/Src/TXScheduler.su ./Core/Src/Transceiver.cyclo ./Core/Src/Transceiver.d ./Core/Src/Transceiver.o ./Core/Src/Transceiver.su ./Core/Src/Utils.cyclo ./Core/Src/Utils.d ./Core/Src/Utils.o ./Core/Src/Utils.su ./Core/Src/arbitrary_tx.cyclo ./Core/Src/arbitrary_tx.d ./Core/Src/arbitrary_tx.o ./Core/Src/arbitrary_tx.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/printf_serial.cyclo ./Core/Src/printf_serial.d ./Core/Src/printf_serial.o ./Core/Src/printf_serial.su ./Core/Src/si4460.cyclo ./Core/Src/si4460.d ./Core/Src/si4460.o ./Core/Src/si4460.su ./Core/Src/si4463.cyclo ./Core/Src/si4463.d ./Core/Src/si4463.o ./Core/Src/si4463.su ./Core/Src/si4467.cyclo ./Core/Src/si4467.d ./Core/Src/si4467.o ./Core/Src/si4467.su ./Core/Src/stm32l4xx_it.cyclo ./Core/Src/stm32l4xx_it.d ./Core/Src/stm32l4xx_it.o ./Core/Src/stm32l4xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32l4xx.cyclo ./Core/Src/system_stm32l4xx.d ./Core/Src/system_stm32l4xx.o ./Core/Src/system_stm32l4xx.su
+	-$(RM) ./Core/Src/AISDecoder.cyclo ./Core/Src/AISDecoder.d ./Core/Src/AISDecoder.o ./Core/Src/AISDecoder.su ./Core/Src/AISMessages.cyclo ./Core/Src/AISMessages.d ./Core/Src/AISMessages.o ./Core/Src/AISMessages.su ./Core/Src/AODV_mesh.cyclo ./Core/Src/AODV_mesh.d ./Core/Src/AODV_mesh.o ./Core/Src/AODV_mesh.su ./Core/Src/ChannelManager.cyclo ./Core/Src/ChannelManager.d ./Core/Src/ChannelManager.o ./Core/Src/ChannelManager.su ./Core/Src/CommandProcessor.cyclo ./Core/Src/CommandProcessor.d ./Core/Src/CommandProcessor.o ./Core/Src/CommandProcessor.su ./Core/Src/Configuration.cyclo ./Core/Src/Configuration.d ./Core/Src/Configuration.o ./Core/Src/Configuration.su ./Core/Src/DataTerminal.cyclo ./Core/Src/DataTerminal.d ./Core/Src/DataTerminal.o ./Core/Src/DataTerminal.su ./Core/Src/EventQueue.cyclo ./Core/Src/EventQueue.d ./Core/Src/EventQueue.o ./Core/Src/EventQueue.su ./Core/Src/Events.cyclo ./Core/Src/Events.d ./Core/Src/Events.o ./Core/Src/Events.su ./Core/Src/GPS.cyclo ./Core/Src/GPS.d ./Core/Src/GPS.o ./Core/Src/GPS.su ./Core/Src/HDLCDecoder.cyclo ./Core/Src/HDLCDecoder.d ./Core/Src/HDLCDecoder.o ./Core/Src/HDLCDecoder.su ./Core/Src/HDLCEncoder.cyclo ./Core/Src/HDLCEncoder.d ./Core/Src/HDLCEncoder.o ./Core/Src/HDLCEncoder.su ./Core/Src/LEDManager.cyclo ./Core/Src/LEDManager.d ./Core/Src/LEDManager.o ./Core/Src/LEDManager.su ./Core/Src/NMEAEncoder.cyclo ./Core/Src/NMEAEncoder.d ./Core/Src/NMEAEncoder.o ./Core/Src/NMEAEncoder.su ./Core/Src/NMEASentence.cyclo ./Core/Src/NMEASentence.d ./Core/Src/NMEASentence.o ./Core/Src/NMEASentence.su ./Core/Src/NoiseFloorDetector.cyclo ./Core/Src/NoiseFloorDetector.d ./Core/Src/NoiseFloorDetector.o ./Core/Src/NoiseFloorDetector.su ./Core/Src/PerfTrace.cyclo ./Core/Src/PerfTrace.d ./Core/Src/PerfTrace.o ./Core/Src/PerfTrace.su ./Core/Src/RFIC.cyclo ./Core/Src/RFIC.d ./Core/Src/RFIC.o ./Core/Src/RFIC.su ./Core/Src/RXFunnel.cyclo ./Core/Src/RXFunnel.d ./Core/Src/RXFunnel.o ./Core/Src/RXFunnel.su ./Core/Src/RXPacket.cyclo ./Core/Src/RXPacket.d ./Core/Src/RXPacket.o ./Core/Src/RXPacket.su ./Core/Src/RXPacketProcessor.cyclo ./Core/Src/RXPacketProcessor.d ./Core/Src/RXPacketProcessor.o ./Core/Src/RXPacketProcessor.su ./Core/Src/RadioManager.cyclo ./Core/Src/RadioManager.d ./Core/Src/RadioManager.o ./Core/Src/RadioManager.su ./Core/Src/Receiver.cyclo ./Core/Src/Receiver.d ./Core/Src/Receiver.o ./Core/Src/Receiver.su ./Core/Src/SPIBus.cyclo ./Core/Src/SPIBus.d ./Core/Src/SPIBus.o ./Core/Src/SPIBus.su ./Core/Src/SlotMap.cyclo ./Core/Src/SlotMap.d ./Core/Src/SlotMap.o ./Core/Src/SlotMap.su ./Core/Src/TXPacket.cyclo ./Core/Src/TXPacket.d ./Core/Src/TXPacket.o ./Core/Src/TXPacket.su ./Core/Src/TXScheduler.cyclo ./Core/Src/TXScheduler.d ./Core/Src/TXScheduler.o ./Core/Src/TXScheduler.su ./Core/Src/Transceiver.cyclo ./Core/Src/Transceiver.d ./Core/Src/Transceiver.o ./Core/Src/Transceiver.su ./Core/Src/Utils.cyclo ./Core/Src/Utils.d ./Core/Src/Utils.o ./Core/Src/Utils.su ./Core/Src/arbitrary_tx.cyclo ./Core/Src/arbitrary_tx.d ./Core/Src/arbitrary_tx.o ./Core/Src/arbitrary_tx.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/printf_serial.cyclo ./Core/Src/printf_serial.d ./Core/Src/printf_serial.o ./Core/Src/printf_serial.su ./Core/Src/si4460.cyclo ./Core/Src/si4460.d ./Core/Src/si4460.o ./Core/Src/si4460.su ./Core/Src/si4463.cyclo ./Core/Src/si4463.d ./Core/Src/si4463.o ./Core/Src/si4463.su ./Core/Src/si4467.cyclo ./Core/Src/si4467.d ./Core/Src/si4467.o ./Core/Src/si4467.su ./Core/Src/stm32l4xx_it.cyclo ./Core/Src/stm32l4xx_it.d ./Core/Src/stm32l4xx_it.o ./Core/Src/stm32l4xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32l4xx.cyclo ./Core/Src/system_stm32l4xx.d ./Core/Src/system_stm32l4xx.o ./Core/Src/system_stm32l4xx.su
 
 .PHONY: clean-Core-2f-Src
 
@@ -0,0 +1,189 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file AISFrames.hpp
+ * @brief Builds the data levels an RF IC outputs for a sequence of AIS frames and noise.
+ * @details Segments are appended as NRZI-decoded bits, in air order. levels() then applies the NRZI encoding
+ *          and packs() groups the levels 8 at a time with the earliest one in the MSB, just like the bit clock
+ *          interrupt hands them to the HDLCDecoder.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef AISFRAMES_HPP_
+#define AISFRAMES_HPP_
+
+#include <stdint.h>
+#include <vector>
+#include "TestUtils.hpp"
+
+class AISFrameStream
+{
+public:
+  AISFrameStream(TestRandom &rnd) : mRandom(rnd) { }
+
+  // Alternating training bits ending in 0101... or 1010... (phase 0 ends with a 1)
+  void training(uint8_t count, uint8_t phase = 0)
+  {
+    for ( uint8_t i = 0; i < count; ++i )
+      mBits.push_back(((count - 1 - i) & 1) ^ phase ^ 1);
+  }
+
+  void flag()
+  {
+    for ( int8_t i = 7; i >= 0; --i )
+      mBits.push_back((0x7e >> i) & 1);
+  }
+
+  // Seven ones in a row
+  void abort()
+  {
+    for ( uint8_t i = 0; i < 9; ++i )
+      mBits.push_back(1);
+  }
+
+  /*
+   * Message bits (a whole number of bytes, in the order RXPacket::bit() returns them) followed by the FCS.
+   * Each byte goes on the air LSB first, and the result is bit stuffed. Returns the message and FCS bits
+   * in packet order, which is what a decoder should produce.
+   */
+  std::vector<uint8_t> payload(const std::vector<uint8_t> &bits)
+  {
+    std::vector<uint8_t> air = byteReversed(bits);
+    uint16_t crc = 0xffff;
+    for ( uint8_t b : air )
+      crc = ((crc ^ b) & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+
+    crc = ~crc;
+    for ( uint8_t i = 0; i < 16; ++i )
+      air.push_back((crc >> i) & 1);
+
+    uint8_t ones = 0;
+    for ( uint8_t b : air )
+      {
+        mBits.push_back(b);
+        ones = b ? ones + 1 : 0;
+        if ( ones == 5 )
+          {
+            mBits.push_back(0);
+            ones = 0;
+          }
+      }
+
+    return byteReversed(air);
+  }
+
+  // count must be a multiple of 8
+  std::vector<uint8_t> randomPayload(uint16_t count)
+  {
+    std::vector<uint8_t> bits;
+    for ( uint16_t i = 0; i < count; ++i )
+      bits.push_back(mRandom.next() & 1);
+    return payload(bits);
+  }
+
+  // A complete frame: 24 training bits, flag, payload with FCS, flag
+  std::vector<uint8_t> frame(uint16_t payloadBits, uint8_t phase = 0)
+  {
+    training(24, phase);
+    flag();
+    std::vector<uint8_t> bits = randomPayload(payloadBits);
+    flag();
+    return bits;
+  }
+
+  // Random bits, with a one bias of (ones - 1)/ones when ones > 2
+  void noise(uint16_t count, uint8_t ones = 2)
+  {
+    for ( uint16_t i = 0; i < count; ++i )
+      mBits.push_back(ones > 2 ? mRandom.next() % ones != 0 : mRandom.next() & 1);
+  }
+
+  void bit(uint8_t b)
+  {
+    mBits.push_back(b);
+  }
+
+  // Flips the decoded bit at this position, i.e. both levels that follow it are inverted from there on
+  void flip(size_t pos)
+  {
+    mBits[pos] ^= 1;
+  }
+
+  size_t size() const
+  {
+    return mBits.size();
+  }
+
+  void truncate(size_t count)
+  {
+    mBits.resize(count);
+  }
+
+  // NRZI encoded, padded with noise to a multiple of 8
+  std::vector<uint8_t> levels()
+  {
+    std::vector<uint8_t> result;
+    uint8_t level = mRandom.next() & 1;
+    for ( uint8_t b : mBits )
+      {
+        // A 0 is a transition
+        if ( !b )
+          level ^= 1;
+        result.push_back(level);
+      }
+
+    while ( result.size() % 8 )
+      result.push_back(mRandom.next() & 1);
+
+    return result;
+  }
+
+  // Reverses the bit order within every byte
+  static std::vector<uint8_t> byteReversed(const std::vector<uint8_t> &bits)
+  {
+    std::vector<uint8_t> result(bits.size());
+    for ( size_t i = 0; i < bits.size(); ++i )
+      result[i] = bits[(i & ~(size_t)7) + 7 - (i & 7)];
+    return result;
+  }
+
+  static std::vector<uint8_t> pack(const std::vector<uint8_t> &levels)
+  {
+    std::vector<uint8_t> bytes;
+    for ( size_t i = 0; i + 8 <= levels.size(); i += 8 )
+      {
+        uint8_t byte = 0;
+        for ( uint8_t j = 0; j < 8; ++j )
+          byte = (byte << 1) | levels[i + j];
+        bytes.push_back(byte);
+      }
+
+    return bytes;
+  }
+
+private:
+  TestRandom &mRandom;
+  std::vector<uint8_t> mBits;
+};
+
+#endif /* AISFRAMES_HPP_ */
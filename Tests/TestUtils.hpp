@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/**
+ * @file TestUtils.hpp
+ * @brief Minimal checking and timing helpers shared by the host tests.
+ * @version 1.0A
+ * @date September 2024
+ * @author Peter Antypas
+ * @company Uluka Systems Pvt Ltd
+ */
+
+#ifndef TESTUTILS_HPP_
+#define TESTUTILS_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+static int __failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if ( !(cond) ) \
+      { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        ++__failures; \
+      } \
+  } while (0)
+
+#define CHECK_EQ(a, b) \
+  do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if ( _a != _b ) \
+      { \
+        printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        ++__failures; \
+      } \
+  } while (0)
+
+// Prints the verdict and returns the process exit code
+static inline int testResult(const char *name)
+{
+  printf("%s: %s\n", name, __failures ? "FAIL" : "PASS");
+  return __failures ? 1 : 0;
+}
+
+static inline uint64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Small deterministic PRNG (xorshift32), so failures are reproducible
+class TestRandom
+{
+public:
+  TestRandom(uint32_t seed = 0x12345678) : mState(seed ? seed : 1) { }
+
+  uint32_t next()
+  {
+    mState ^= mState << 13;
+    mState ^= mState >> 17;
+    mState ^= mState << 5;
+    return mState;
+  }
+
+  // Uniform in [lo, hi]
+  uint32_t range(uint32_t lo, uint32_t hi)
+  {
+    return lo + next() % (hi - lo + 1);
+  }
+
+private:
+  uint32_t mState;
+};
+
+#endif /* TESTUTILS_HPP_ */
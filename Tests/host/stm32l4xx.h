@@ -0,0 +1,18 @@
+/*
+ * Host stand-in for the CMSIS device header, so hardware independent sources that need a
+ * couple of core intrinsics (e.g. Utils.cpp) build into the host tests. There are no interrupts here.
+ */
+
+#ifndef HOST_STM32L4XX_H_
+#define HOST_STM32L4XX_H_
+
+#include <stdint.h>
+
+static inline uint32_t __get_IPSR(void) { return 0; }
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t) { }
+static inline void __disable_irq(void) { }
+static inline void __enable_irq(void) { }
+static inline uint32_t __REV16(uint32_t v) { return ((v & 0xff00ff00) >> 8) | ((v & 0x00ff00ff) << 8); }
+
+#endif /* HOST_STM32L4XX_H_ */
@@ -0,0 +1,25 @@
+/*
+ * Host stand-in for the HAL header, with just the GPIO calls the RF IC drivers make. Tests that build those
+ * drivers define HAL_GPIO_WritePin() and HAL_GPIO_ReadPin() themselves, to model the hardware behind the pins.
+ */
+
+#ifndef HOST_STM32L4XX_HAL_H_
+#define HOST_STM32L4XX_HAL_H_
+
+#include "stm32l4xx.h"
+
+typedef struct
+{
+  uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);
+
+#endif /* HOST_STM32L4XX_HAL_H_ */
@@ -0,0 +1,25 @@
+/*
+ * newlib has strlcpy(), glibc only since 2.38. Force-included into host builds of sources that use it.
+ */
+
+#ifndef HOST_STRLCPY_H_
+#define HOST_STRLCPY_H_
+
+#include <string.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len = strlen(src);
+  if ( size )
+    {
+      size_t n = len < size - 1 ? len : size - 1;
+      memcpy(dst, src, n);
+      dst[n] = 0;
+    }
+
+  return len;
+}
+#endif
+
+#endif /* HOST_STRLCPY_H_ */
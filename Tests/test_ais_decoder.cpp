@@ -0,0 +1,815 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * AISDecoder, one message type (and sub-variant) at a time. Each message is written field by field with the
+ * layout of Rec. ITU-R M.1371 spelled out again here, received into an RXPacket with its FCS the way the
+ * HDLCDecoder builds it, and decoded both before and after RXPacket::discardCRC(). Packets that are one byte
+ * too short for their type must be rejected.
+ */
+
+#include "TestUtils.hpp"
+#include "AISFrames.hpp"
+#include <string.h>
+#include "AISDecoder.hpp"
+
+// Message bits in packet order, MSB of every field first
+class MessageBits
+{
+public:
+  MessageBits &u(uint32_t value, uint8_t width)
+  {
+    for ( int8_t i = width - 1; i >= 0; --i )
+      bits.push_back((value >> i) & 1);
+    return *this;
+  }
+
+  MessageBits &s(int32_t value, uint8_t width)
+  {
+    return u((uint32_t)value & (width == 32 ? 0xffffffff : (1u << width) - 1), width);
+  }
+
+  // 6-bit characters, padded with '@'
+  MessageBits &str(const char *value, uint8_t chars)
+  {
+    size_t len = strlen(value);
+    for ( uint8_t c = 0; c < chars; ++c )
+      u(c < len ? value[c] & 0x3f : 0, 6);
+    return *this;
+  }
+
+  // Fill bits up to a whole number of bytes
+  MessageBits &fill()
+  {
+    while ( bits.size() % 8 )
+      bits.push_back(0);
+    return *this;
+  }
+
+  std::vector<uint8_t> bits;
+};
+
+static TestRandom gRandom(41);
+
+// Message bits and FCS as the HDLCDecoder adds them, one air order byte at a time
+static void receive(RXPacket &p, const MessageBits &m)
+{
+  AISFrameStream stream(gRandom);
+  std::vector<uint8_t> air = AISFrameStream::byteReversed(stream.payload(m.bits));
+
+  p.reset();
+  for ( size_t i = 0; i + 8 <= air.size(); i += 8 )
+    {
+      uint8_t byte = 0;
+      for ( uint8_t j = 0; j < 8; ++j )
+        byte = (byte << 1) | air[i + j];
+      p.addByte(byte);
+    }
+}
+
+/*
+ * Decodes the message with the FCS still in the packet and again with it discarded, which must agree.
+ * The message must be a whole number of bytes.
+ */
+static bool decode(const MessageBits &m, AISDecodedMessage &msg, RXPacket &p)
+{
+  receive(p, m);
+  CHECK(p.checkCRC());
+  CHECK_EQ(p.payloadSize(), m.bits.size());
+  bool ok = AISDecoder::decode(p, msg);
+
+  AISDecodedMessage discarded;
+  p.discardCRC();
+  CHECK_EQ(p.payloadSize(), m.bits.size());
+  CHECK_EQ(AISDecoder::decode(p, discarded), ok);
+  CHECK(memcmp(&msg, &discarded, sizeof msg) == 0);
+
+  return ok;
+}
+
+static bool decode(const MessageBits &m, AISDecodedMessage &msg)
+{
+  RXPacket p;
+  return decode(m, msg, p);
+}
+
+// The same message without its last byte
+static bool decodeShort(const MessageBits &m)
+{
+  MessageBits shorter = m;
+  shorter.bits.resize(m.bits.size() - 8);
+
+  AISDecodedMessage msg;
+  return decode(shorter, msg);
+}
+
+static MessageBits header(uint8_t type, uint32_t mmsi, uint8_t repeat = 0)
+{
+  MessageBits m;
+  m.u(type, 6).u(repeat, 2).u(mmsi, 30);
+  return m;
+}
+
+static void testPayloadSize()
+{
+  RXPacket p;
+  receive(p, header(1, 123456789).fill());
+  CHECK_EQ(p.size(), 56);
+  CHECK_EQ(p.payloadSize(), 40);
+
+  p.discardCRC();
+  CHECK_EQ(p.size(), 40);
+  CHECK_EQ(p.payloadSize(), 40);
+
+  // Only once
+  p.discardCRC();
+  CHECK_EQ(p.size(), 40);
+  CHECK_EQ(p.payloadSize(), 40);
+
+  // A bad frame whose CRC register happens to be back at its initial value still ends in 16 FCS bits
+  bool found = false;
+  for ( uint32_t word = 0; word < 0x10000 && !found; ++word )
+    {
+      p.reset();
+      p.addByte(word >> 8);
+      p.addByte(word & 0xff);
+      p.addByte(0x5a);
+      found = p.crc() == 0xffff;
+    }
+
+  CHECK(found);
+  CHECK_EQ(p.payloadSize(), 8);
+  p.discardCRC();
+  CHECK_EQ(p.size(), 8);
+  CHECK_EQ(p.payloadSize(), 8);
+
+  // Too short to hold an FCS at all
+  p.reset();
+  p.addByte(0x12);
+  CHECK_EQ(p.payloadSize(), 0);
+  p.discardCRC();
+  CHECK_EQ(p.size(), 8);
+}
+
+static void testPositionReportA()
+{
+  MessageBits m = header(3, 987654321, 1);
+  m.u(5, 4).s(-127, 8).u(1023, 10).u(1, 1).s(-108000000, 28).s(54600000, 27).u(3600, 12).u(511, 9)
+   .u(59, 6).u(2, 2).u(0, 3).u(1, 1).u(0x7abcd, 19);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.type, 3);
+  CHECK_EQ(msg.repeat, 1);
+  CHECK_EQ(msg.mmsi, 987654321);
+
+  const AISPositionReportA &r = msg.positionA;
+  CHECK_EQ(r.navStatus, 5);
+  CHECK_EQ(r.rot, -127);
+  CHECK_EQ(r.sog, 1023);
+  CHECK_EQ(r.accuracy, 1);
+  CHECK_EQ(r.lon, -108000000);
+  CHECK_EQ(r.lat, 54600000);
+  CHECK_EQ(r.cog, 3600);
+  CHECK_EQ(r.heading, 511);
+  CHECK_EQ(r.second, 59);
+  CHECK_EQ(r.maneuver, 2);
+  CHECK_EQ(r.raim, 1);
+  CHECK_EQ(r.radio, 0x7abcd);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testBaseStation()
+{
+  MessageBits m = header(11, 2655000);
+  m.u(2024, 14).u(9, 4).u(30, 5).u(23, 5).u(59, 6).u(58, 6).u(0, 1).s(14400000, 28).s(-3000000, 27).u(7, 4)
+   .u(0, 10).u(1, 1).u(0x12345, 19);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.type, 11);
+
+  const AISBaseStationReport &r = msg.baseStation;
+  CHECK_EQ(r.year, 2024);
+  CHECK_EQ(r.month, 9);
+  CHECK_EQ(r.day, 30);
+  CHECK_EQ(r.hour, 23);
+  CHECK_EQ(r.minute, 59);
+  CHECK_EQ(r.second, 58);
+  CHECK_EQ(r.accuracy, 0);
+  CHECK_EQ(r.lon, 14400000);
+  CHECK_EQ(r.lat, -3000000);
+  CHECK_EQ(r.epfd, 7);
+  CHECK_EQ(r.raim, 1);
+  CHECK_EQ(r.radio, 0x12345);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testStaticVoyage()
+{
+  MessageBits m = header(5, 351759000);
+  m.u(1, 2).u(9134270, 30).str("3FOF8", 7).str("EVER DIADEM", 20).u(70, 8).u(225, 9).u(70, 9).u(1, 6)
+   .u(31, 6).u(1, 4).u(5, 4).u(15, 5).u(14, 5).u(0, 6).u(122, 8).str("NEW YORK", 20).u(0, 1).u(0, 1);
+  m.fill();
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISStaticVoyageData &r = msg.staticVoyage;
+  CHECK_EQ(r.aisVersion, 1);
+  CHECK_EQ(r.imo, 9134270);
+  CHECK(strcmp(r.callsign, "3FOF8") == 0);
+  CHECK(strcmp(r.name, "EVER DIADEM") == 0);
+  CHECK_EQ(r.shipType, 70);
+  CHECK_EQ(r.dimensions.a, 225);
+  CHECK_EQ(r.dimensions.b, 70);
+  CHECK_EQ(r.dimensions.c, 1);
+  CHECK_EQ(r.dimensions.d, 31);
+  CHECK_EQ(r.epfd, 1);
+  CHECK_EQ(r.month, 5);
+  CHECK_EQ(r.day, 15);
+  CHECK_EQ(r.hour, 14);
+  CHECK_EQ(r.minute, 0);
+  CHECK_EQ(r.draught, 122);
+  CHECK(strcmp(r.destination, "NEW YORK") == 0);
+  CHECK_EQ(r.dte, 0);
+
+  // A name that uses all 20 characters
+  m = header(5, 351759000);
+  m.u(0, 2).u(0, 30).str("ABCDEFG", 7).str("ABCDEFGHIJKLMNOPQRST", 20).u(0, 8).u(0, 9).u(0, 9).u(0, 6).u(0, 6)
+   .u(0, 4).u(0, 4).u(0, 5).u(0, 5).u(0, 6).u(0, 8).str("", 20).u(1, 1).u(0, 1);
+  m.fill();
+  CHECK(decode(m, msg));
+  CHECK(strcmp(msg.staticVoyage.callsign, "ABCDEFG") == 0);
+  CHECK(strcmp(msg.staticVoyage.name, "ABCDEFGHIJKLMNOPQRST") == 0);
+  CHECK_EQ(msg.staticVoyage.destination[0], 0);
+  CHECK_EQ(msg.staticVoyage.dte, 1);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testBinary()
+{
+  // Message 6 with 16 bits of data
+  MessageBits m = header(6, 366123456);
+  m.u(3, 2).u(123456789, 30).u(1, 1).u(0, 1).u(235, 10).u(10, 6).u(0xbeef, 16);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.binary.sequence, 3);
+  CHECK_EQ(msg.binary.destination, 123456789);
+  CHECK_EQ(msg.binary.retransmit, 1);
+  CHECK_EQ(msg.binary.structured, 1);
+  CHECK_EQ(msg.binary.dac, 235);
+  CHECK_EQ(msg.binary.fid, 10);
+  CHECK_EQ(msg.binary.data.pos, 88);
+  CHECK_EQ(msg.binary.data.bits, 16);
+
+  // Header and application ID only
+  m.bits.resize(88);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.binary.data.bits, 0);
+  CHECK(!decodeShort(m));
+
+  // Message 8 with 24 bits of data
+  m = header(8, 2573305);
+  m.u(0, 2).u(1, 10).u(31, 6).u(0xabcdef, 24);
+  RXPacket p;
+  CHECK(decode(m, msg, p));
+  CHECK_EQ(msg.binary.destination, 0);
+  CHECK_EQ(msg.binary.dac, 1);
+  CHECK_EQ(msg.binary.fid, 31);
+  CHECK_EQ(msg.binary.data.pos, 56);
+  CHECK_EQ(msg.binary.data.bits, 24);
+  CHECK_EQ(p.bits(msg.binary.data.pos, 24), 0xabcdef);
+
+  m.bits.resize(56);
+  CHECK(!decodeShort(m));
+}
+
+static void testAcknowledgement()
+{
+  for ( uint8_t count = 1; count <= 4; ++count )
+    {
+      MessageBits m = header(count & 1 ? 7 : 13, 244000000);
+      m.u(0, 2);
+      for ( uint8_t i = 0; i < count; ++i )
+        m.u(200000000 + i, 30).u(i, 2);
+      m.fill();
+
+      AISDecodedMessage msg;
+      CHECK(decode(m, msg));
+      CHECK_EQ(msg.ack.count, count);
+      for ( uint8_t i = 0; i < count; ++i )
+        {
+          CHECK_EQ(msg.ack.mmsi[i], 200000000 + i);
+          CHECK_EQ(msg.ack.sequence[i], i);
+        }
+    }
+
+  MessageBits m = header(7, 244000000);
+  m.u(0, 2).fill();
+  AISDecodedMessage msg;
+  CHECK(!decode(m, msg));
+}
+
+static void testSARAircraft()
+{
+  MessageBits m = header(9, 111232511);
+  m.u(4094, 12).u(135, 10).u(1, 1).s(-7375000, 28).s(24640000, 27).u(1794, 12).u(17, 6).u(0, 8).u(1, 1)
+   .u(0, 3).u(1, 1).u(0, 1).u(0xfffff, 20);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISSARAircraftReport &r = msg.sar;
+  CHECK_EQ(r.altitude, 4094);
+  CHECK_EQ(r.sog, 135);
+  CHECK_EQ(r.accuracy, 1);
+  CHECK_EQ(r.lon, -7375000);
+  CHECK_EQ(r.lat, 24640000);
+  CHECK_EQ(r.cog, 1794);
+  CHECK_EQ(r.second, 17);
+  CHECK_EQ(r.dte, 1);
+  CHECK_EQ(r.assigned, 1);
+  CHECK_EQ(r.raim, 0);
+  CHECK_EQ(r.radio, 0xfffff);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testSafety()
+{
+  // Message 10 has nothing but a destination
+  MessageBits m = header(10, 211000001);
+  m.u(0, 2).u(211000002, 30).u(0, 1).u(0, 1);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.safety.destination, 211000002);
+  CHECK_EQ(msg.safety.text.bits, 0);
+  CHECK(!decodeShort(m));
+
+  // Message 12, where the 2 fill bits must not count as text
+  m = header(12, 211000001);
+  m.u(2, 2).u(211000003, 30).u(1, 1).u(0, 1).str("HELLO", 5).fill();
+
+  RXPacket p;
+  char text[20];
+  CHECK(decode(m, msg, p));
+  CHECK_EQ(msg.safety.sequence, 2);
+  CHECK_EQ(msg.safety.destination, 211000003);
+  CHECK_EQ(msg.safety.retransmit, 1);
+  CHECK_EQ(msg.safety.text.pos, 72);
+  CHECK_EQ(msg.safety.text.bits, 30);
+  AISDecoder::text(p, msg.safety.text, text, sizeof text);
+  CHECK(strcmp(text, "HELLO") == 0);
+
+  // Text is truncated to fit
+  AISDecoder::text(p, msg.safety.text, text, 4);
+  CHECK(strcmp(text, "HEL") == 0);
+
+  // Message 14, whose text is free and may contain '@'
+  m = header(14, 970012345);
+  m.u(0, 2).str("SART@TEST", 9).fill();
+  CHECK(decode(m, msg, p));
+  CHECK_EQ(msg.safety.destination, 0);
+  CHECK_EQ(msg.safety.text.pos, 40);
+  CHECK_EQ(msg.safety.text.bits, 54);
+  AISDecoder::text(p, msg.safety.text, text, sizeof text);
+  CHECK(strcmp(text, "SART@TEST") == 0);
+}
+
+static void testInterrogation()
+{
+  // One station, one message, without the trailing spare bits
+  MessageBits m = header(15, 2320001);
+  m.u(0, 2).u(235000001, 30).u(5, 6).u(100, 12);
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.interrogation.count, 1);
+  CHECK_EQ(msg.interrogation.mmsi[0], 235000001);
+  CHECK_EQ(msg.interrogation.messageType[0], 5);
+  CHECK_EQ(msg.interrogation.slotOffset[0], 100);
+  CHECK(!decodeShort(m));
+
+  // One station, two messages
+  m = header(15, 2320001);
+  m.u(0, 2).u(235000001, 30).u(5, 6).u(100, 12).u(0, 2).u(24, 6).u(200, 12).fill();
+  CHECK_EQ(m.bits.size(), 112);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.interrogation.count, 2);
+  CHECK_EQ(msg.interrogation.mmsi[1], 235000001);
+  CHECK_EQ(msg.interrogation.messageType[1], 24);
+  CHECK_EQ(msg.interrogation.slotOffset[1], 200);
+
+  // Two stations
+  m = header(15, 2320001);
+  m.u(0, 2).u(235000001, 30).u(5, 6).u(100, 12).u(0, 2).u(24, 6).u(200, 12).u(0, 2).u(235000002, 30)
+   .u(3, 6).u(4095, 12).u(0, 2);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.interrogation.count, 3);
+  CHECK_EQ(msg.interrogation.mmsi[0], 235000001);
+  CHECK_EQ(msg.interrogation.mmsi[2], 235000002);
+  CHECK_EQ(msg.interrogation.messageType[2], 3);
+  CHECK_EQ(msg.interrogation.slotOffset[2], 4095);
+}
+
+static void testAssignment()
+{
+  MessageBits m = header(16, 2190047);
+  m.u(0, 2).u(219000001, 30).u(500, 12).u(75, 10).fill();
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.assignment.count, 1);
+  CHECK_EQ(msg.assignment.mmsi[0], 219000001);
+  CHECK_EQ(msg.assignment.offset[0], 500);
+  CHECK_EQ(msg.assignment.increment[0], 75);
+  CHECK(!decodeShort(m));
+
+  m = header(16, 2190047);
+  m.u(0, 2).u(219000001, 30).u(500, 12).u(75, 10).u(219000002, 30).u(4095, 12).u(1023, 10);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.assignment.count, 2);
+  CHECK_EQ(msg.assignment.mmsi[1], 219000002);
+  CHECK_EQ(msg.assignment.offset[1], 4095);
+  CHECK_EQ(msg.assignment.increment[1], 1023);
+}
+
+static void testDGNSS()
+{
+  MessageBits m = header(17, 2734450);
+  m.u(0, 2).s(-1800, 18).s(3540, 17).u(0, 5).u(0x123456, 24).u(0x789a, 16);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.dgnss.lon, -1800);
+  CHECK_EQ(msg.dgnss.lat, 3540);
+  CHECK_EQ(msg.dgnss.data.pos, 80);
+  CHECK_EQ(msg.dgnss.data.bits, 40);
+
+  m.bits.resize(80);
+  CHECK(!decodeShort(m));
+}
+
+static void testPositionReportB()
+{
+  MessageBits m = header(18, 338087471);
+  m.u(0, 8).u(1, 10).u(0, 1).s(-44406000, 28).s(24402000, 27).u(790, 12).u(511, 9).u(49, 6).u(0, 2)
+   .u(1, 1).u(0, 1).u(1, 1).u(1, 1).u(0, 1).u(0, 1).u(1, 1).u(0xc0000, 20);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISPositionReportB &r = msg.positionB;
+  CHECK_EQ(r.sog, 1);
+  CHECK_EQ(r.accuracy, 0);
+  CHECK_EQ(r.lon, -44406000);
+  CHECK_EQ(r.lat, 24402000);
+  CHECK_EQ(r.cog, 790);
+  CHECK_EQ(r.heading, 511);
+  CHECK_EQ(r.second, 49);
+  CHECK_EQ(r.cs, 1);
+  CHECK_EQ(r.display, 0);
+  CHECK_EQ(r.dsc, 1);
+  CHECK_EQ(r.band, 1);
+  CHECK_EQ(r.msg22, 0);
+  CHECK_EQ(r.assigned, 0);
+  CHECK_EQ(r.raim, 1);
+  CHECK_EQ(r.radio, 0xc0000);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testExtendedPositionReportB()
+{
+  MessageBits m = header(19, 367059850);
+  m.u(0, 8).u(87, 10).u(0, 1).s(-52953000, 28).s(17370000, 27).u(2264, 12).u(217, 9).u(59, 6).u(0, 4)
+   .str("CAPT.J.RIMES", 20).u(37, 8).u(5, 9).u(21, 9).u(4, 6).u(4, 6).u(1, 4).u(0, 1).u(1, 1).u(0, 1).u(0, 4);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISPositionReportB &r = msg.positionB;
+  CHECK_EQ(r.sog, 87);
+  CHECK_EQ(r.lon, -52953000);
+  CHECK_EQ(r.lat, 17370000);
+  CHECK_EQ(r.cog, 2264);
+  CHECK_EQ(r.heading, 217);
+  CHECK_EQ(r.second, 59);
+  CHECK(strcmp(r.name, "CAPT.J.RIMES") == 0);
+  CHECK_EQ(r.shipType, 37);
+  CHECK_EQ(r.dimensions.a, 5);
+  CHECK_EQ(r.dimensions.b, 21);
+  CHECK_EQ(r.dimensions.c, 4);
+  CHECK_EQ(r.dimensions.d, 4);
+  CHECK_EQ(r.epfd, 1);
+  CHECK_EQ(r.raim, 0);
+  CHECK_EQ(r.dte, 1);
+  CHECK_EQ(r.assigned, 0);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testDataLink()
+{
+  for ( uint8_t count = 1; count <= 4; ++count )
+    {
+      MessageBits m = header(20, 3669702);
+      m.u(0, 2);
+      for ( uint8_t i = 0; i < count; ++i )
+        m.u(2000 + i, 12).u(i + 1, 4).u(7 - i, 3).u(1125 - i, 11);
+      m.fill();
+
+      AISDecodedMessage msg;
+      CHECK(decode(m, msg));
+      CHECK_EQ(msg.dataLink.count, count);
+      for ( uint8_t i = 0; i < count; ++i )
+        {
+          CHECK_EQ(msg.dataLink.offset[i], 2000 + i);
+          CHECK_EQ(msg.dataLink.number[i], i + 1);
+          CHECK_EQ(msg.dataLink.timeout[i], 7 - i);
+          CHECK_EQ(msg.dataLink.increment[i], 1125 - i);
+        }
+    }
+
+  MessageBits m = header(20, 3669702);
+  m.u(0, 2).fill();
+  AISDecodedMessage msg;
+  CHECK(!decode(m, msg));
+}
+
+static MessageBits aidToNavigation(const char *name)
+{
+  MessageBits m = header(21, 993672085);
+  m.u(19, 5).str(name, 20).u(1, 1).s(-73245000, 28).s(24315000, 27).u(0, 9).u(0, 9).u(0, 6).u(0, 6).u(7, 4)
+   .u(60, 6).u(1, 1).u(0, 8).u(0, 1).u(1, 1).u(0, 1).u(0, 1);
+  return m;
+}
+
+static void testAidToNavigation()
+{
+  MessageBits m = aidToNavigation("BUOY 1");
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISAidToNavigationReport &r = msg.aton;
+  CHECK_EQ(r.aidType, 19);
+  CHECK(strcmp(r.name, "BUOY 1") == 0);
+  CHECK_EQ(r.accuracy, 1);
+  CHECK_EQ(r.lon, -73245000);
+  CHECK_EQ(r.lat, 24315000);
+  CHECK_EQ(r.epfd, 7);
+  CHECK_EQ(r.second, 60);
+  CHECK_EQ(r.offPosition, 1);
+  CHECK_EQ(r.raim, 0);
+  CHECK_EQ(r.virtualAid, 1);
+  CHECK_EQ(r.assigned, 0);
+  CHECK(!decodeShort(m));
+
+  // A full name with an extension of 3 characters and 6 fill bits
+  m = aidToNavigation("NORTH ENTRANCE LIGHT");
+  m.str("NO2", 3).fill();
+  CHECK(decode(m, msg));
+  CHECK(strcmp(msg.aton.name, "NORTH ENTRANCE LIGHTNO2") == 0);
+
+  // An extension that fills the name buffer
+  m = aidToNavigation("NORTH ENTRANCE LIGHT");
+  m.str("ABCDEFGHIJKLMNOP", 16);
+  CHECK(decode(m, msg));
+  CHECK(strcmp(msg.aton.name, "NORTH ENTRANCE LIGHTABCDEFGHIJKLMN") == 0);
+}
+
+static void testChannelManagement()
+{
+  MessageBits m = header(22, 3160048);
+  m.u(0, 2).u(2087, 12).u(2088, 12).u(1, 4).u(0, 1).s(-4200, 18).s(2800, 17).s(-4260, 18).s(2740, 17)
+   .u(0, 1).u(1, 1).u(0, 1).u(4, 3).u(0, 23);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISChannelManagement &r = msg.channel;
+  CHECK_EQ(r.channelA, 2087);
+  CHECK_EQ(r.channelB, 2088);
+  CHECK_EQ(r.txrx, 1);
+  CHECK_EQ(r.power, 0);
+  CHECK_EQ(r.addressed, 0);
+  CHECK_EQ(r.neLon, -4200);
+  CHECK_EQ(r.neLat, 2800);
+  CHECK_EQ(r.swLon, -4260);
+  CHECK_EQ(r.swLat, 2740);
+  CHECK_EQ(r.bandA, 1);
+  CHECK_EQ(r.bandB, 0);
+  CHECK_EQ(r.zoneSize, 4);
+  CHECK(!decodeShort(m));
+
+  m = header(22, 3160048);
+  m.u(0, 2).u(2087, 12).u(2088, 12).u(0, 4).u(1, 1).u(316000001, 30).u(0, 5).u(316000002, 30).u(0, 5)
+   .u(1, 1).u(0, 1).u(0, 1).u(2, 3).u(0, 23);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.channel.addressed, 1);
+  CHECK_EQ(msg.channel.power, 1);
+  CHECK_EQ(msg.channel.destination[0], 316000001);
+  CHECK_EQ(msg.channel.destination[1], 316000002);
+  CHECK_EQ(msg.channel.neLon, 0);
+  CHECK_EQ(msg.channel.zoneSize, 2);
+}
+
+static void testGroupAssignment()
+{
+  MessageBits m = header(23, 2268120);
+  m.u(0, 2).s(1571, 18).s(2957, 17).s(1528, 18).s(2915, 17).u(6, 4).u(36, 8).u(0, 22).u(2, 2).u(9, 4)
+   .u(15, 4).u(0, 6);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISGroupAssignment &r = msg.group;
+  CHECK_EQ(r.neLon, 1571);
+  CHECK_EQ(r.neLat, 2957);
+  CHECK_EQ(r.swLon, 1528);
+  CHECK_EQ(r.swLat, 2915);
+  CHECK_EQ(r.stationType, 6);
+  CHECK_EQ(r.shipType, 36);
+  CHECK_EQ(r.txrx, 2);
+  CHECK_EQ(r.interval, 9);
+  CHECK_EQ(r.quiet, 15);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testStaticData()
+{
+  MessageBits m = header(24, 271041815);
+  m.u(0, 2).str("PROGUY", 20);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.staticData.part, 0);
+  CHECK(strcmp(msg.staticData.name, "PROGUY") == 0);
+  CHECK(!decodeShort(m));
+
+  m = header(24, 271041815);
+  m.u(1, 2).u(60, 8).str("1D00014", 7).str("TC6163", 7).u(123, 9).u(45, 9).u(6, 6).u(7, 6).u(1, 4).u(0, 2);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.staticData.part, 1);
+  CHECK_EQ(msg.staticData.shipType, 60);
+  CHECK(strcmp(msg.staticData.vendor, "1D00014") == 0);
+  CHECK(strcmp(msg.staticData.callsign, "TC6163") == 0);
+  CHECK_EQ(msg.staticData.dimensions.a, 123);
+  CHECK_EQ(msg.staticData.dimensions.b, 45);
+  CHECK_EQ(msg.staticData.dimensions.c, 6);
+  CHECK_EQ(msg.staticData.dimensions.d, 7);
+  CHECK_EQ(msg.staticData.mothership, 0);
+  CHECK_EQ(msg.staticData.epfd, 1);
+  CHECK(!decodeShort(m));
+
+  // An auxiliary craft reports its mothership instead
+  m = header(24, 982710001);
+  m.u(1, 2).u(60, 8).str("", 7).str("", 7).u(271041815, 30).u(1, 4).u(0, 2);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.staticData.mothership, 271041815);
+  CHECK_EQ(msg.staticData.dimensions.a, 0);
+  CHECK_EQ(msg.staticData.epfd, 1);
+
+  // There is no part C or D
+  m = header(24, 271041815);
+  m.u(2, 2).str("", 20);
+  CHECK(!decode(m, msg));
+}
+
+static void testSlotBinary()
+{
+  // Message 25, addressed and structured
+  MessageBits m = header(25, 440006460);
+  m.u(1, 1).u(1, 1).u(134218384, 30).u(0, 2).u(1, 10).u(0, 6).u(0x5a5a, 16);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.binary.destination, 134218384);
+  CHECK_EQ(msg.binary.structured, 1);
+  CHECK_EQ(msg.binary.dac, 1);
+  CHECK_EQ(msg.binary.fid, 0);
+  CHECK_EQ(msg.binary.data.pos, 88);
+  CHECK_EQ(msg.binary.data.bits, 16);
+  CHECK_EQ(msg.binary.radio, 0);
+
+  // Message 25, broadcast and unstructured
+  m = header(25, 440006460);
+  m.u(0, 1).u(0, 1).u(0xabcdef, 24);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.binary.destination, 0);
+  CHECK_EQ(msg.binary.structured, 0);
+  CHECK_EQ(msg.binary.data.pos, 40);
+  CHECK_EQ(msg.binary.data.bits, 24);
+
+  // Addressed, but too short for the destination
+  m = header(25, 440006460);
+  m.u(1, 1).u(0, 1).u(0, 30).fill();
+  CHECK(!decodeShort(m));
+
+  // Message 26, broadcast and structured, with the communication state at the end
+  m = header(26, 440006460);
+  m.u(0, 1).u(1, 1).u(366, 10).u(56, 6).u(0x12345, 20).u(0xfedcb, 20);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.binary.dac, 366);
+  CHECK_EQ(msg.binary.fid, 56);
+  CHECK_EQ(msg.binary.data.pos, 56);
+  CHECK_EQ(msg.binary.data.bits, 20);
+  CHECK_EQ(msg.binary.radio, 0xfedcb);
+
+  m = header(26, 440006460);
+  m.u(0, 1).u(0, 1).u(0xa, 4).u(0xfedcb, 20);
+  CHECK(decode(m, msg));
+  CHECK_EQ(msg.binary.data.pos, 40);
+  CHECK_EQ(msg.binary.data.bits, 4);
+  CHECK_EQ(msg.binary.radio, 0xfedcb);
+  CHECK(!decodeShort(m));
+}
+
+static void testLongRange()
+{
+  MessageBits m = header(27, 206914217);
+  m.u(0, 1).u(0, 1).u(5, 4).s(-8190, 18).s(3124, 17).u(63, 6).u(511, 9).u(0, 1).u(0, 1);
+
+  AISDecodedMessage msg;
+  CHECK(decode(m, msg));
+
+  const AISLongRangeReport &r = msg.longRange;
+  CHECK_EQ(r.accuracy, 0);
+  CHECK_EQ(r.raim, 0);
+  CHECK_EQ(r.navStatus, 5);
+  CHECK_EQ(r.lon, -8190);
+  CHECK_EQ(r.lat, 3124);
+  CHECK_EQ(r.sog, 63);
+  CHECK_EQ(r.cog, 511);
+  CHECK_EQ(r.gnss, 0);
+
+  CHECK(!decodeShort(m));
+}
+
+static void testUnknownTypes()
+{
+  uint8_t types[] = { 0, 28, 63 };
+  for ( uint8_t type : types )
+    {
+      MessageBits m = header(type, 123456789);
+      m.u(0, 2).u(0, 32).u(0, 32).u(0, 32).u(0, 32);
+
+      AISDecodedMessage msg;
+      CHECK(!decode(m, msg));
+    }
+
+  // Not even a header
+  MessageBits m;
+  m.u(1, 6).u(0, 2).u(0, 24);
+  AISDecodedMessage msg;
+  CHECK(!decode(m, msg));
+}
+
+int main()
+{
+  testPayloadSize();
+  testPositionReportA();
+  testBaseStation();
+  testStaticVoyage();
+  testBinary();
+  testAcknowledgement();
+  testSARAircraft();
+  testSafety();
+  testInterrogation();
+  testAssignment();
+  testDGNSS();
+  testPositionReportB();
+  testExtendedPositionReportB();
+  testDataLink();
+  testAidToNavigation();
+  testChannelManagement();
+  testGroupAssignment();
+  testStaticData();
+  testSlotBinary();
+  testLongRange();
+  testUnknownTypes();
+  return testResult("test_ais_decoder");
+}
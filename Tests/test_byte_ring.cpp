@@ -0,0 +1,157 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * ByteRingBuffer: ordering, all-or-nothing drops and statistics under a randomized producer/consumer
+ * interleaving, then the throughput of queueing NMEA sentences for the terminal DMA.
+ */
+
+#include "TestUtils.hpp"
+#include "ByteRingBuffer.hpp"
+#include <vector>
+
+static void testOrdering()
+{
+  ByteRingBuffer<1024> ring;
+  TestRandom rnd(1);
+
+  std::vector<uint8_t> sent, received;
+  uint32_t dropped = 0, writesDropped = 0;
+  uint8_t counter = 0;
+
+  for ( int i = 0; i < 200000; ++i )
+    {
+      if ( rnd.next() & 1 )
+        {
+          uint8_t line[100];
+          size_t len = rnd.range(1, sizeof line);
+          for ( size_t j = 0; j < len; ++j )
+            line[j] = counter + j;
+
+          size_t before = ring.used();
+          if ( ring.write(line, len) )
+            {
+              sent.insert(sent.end(), line, line + len);
+              counter += len;
+              CHECK_EQ(ring.used(), before + len);
+            }
+          else
+            {
+              CHECK(before + len > ring.capacity());
+              CHECK_EQ(ring.used(), before);
+              dropped += len;
+              ++writesDropped;
+            }
+        }
+      else
+        {
+          const uint8_t *data = nullptr;
+          size_t len = ring.peekContiguous(data);
+          if ( len )
+            {
+              // The DMA engine doesn't always get the whole run (e.g. the 16 bit transfer count)
+              size_t take = rnd.range(1, len);
+              received.insert(received.end(), data, data + take);
+              ring.consume(take);
+            }
+        }
+    }
+
+  const uint8_t *data = nullptr;
+  while ( size_t len = ring.peekContiguous(data) )
+    {
+      received.insert(received.end(), data, data + len);
+      ring.consume(len);
+    }
+
+  CHECK(ring.empty());
+  CHECK(sent == received);
+  CHECK_EQ(ring.bytesQueued(), sent.size());
+  CHECK_EQ(ring.bytesDropped(), dropped);
+  CHECK_EQ(ring.writesDropped(), writesDropped);
+  CHECK(ring.highWater() <= ring.capacity());
+}
+
+static void testWrapAround()
+{
+  ByteRingBuffer<16> ring;
+  const uint8_t *data = nullptr;
+  uint8_t buff[12] = {0,1,2,3,4,5,6,7,8,9,10,11};
+
+  CHECK(ring.write(buff, 12));
+  CHECK_EQ(ring.peekContiguous(data), 12);
+  ring.consume(10);
+
+  // 4 bytes fit before the end, the rest wraps to the start
+  CHECK(ring.write(buff, 12));
+  CHECK_EQ(ring.peekContiguous(data), 6);
+  CHECK_EQ(data[0], 10);
+  ring.consume(6);
+  CHECK_EQ(ring.peekContiguous(data), 8);
+  CHECK_EQ(data[0], 4);
+  CHECK_EQ(data[7], 11);
+
+  // Full means full, and a block that doesn't fit is dropped whole
+  ring.consume(8);
+  CHECK(ring.write(buff, 12));
+  CHECK(!ring.write(buff, 5));
+  CHECK(ring.write(buff, 4));
+  CHECK_EQ(ring.used(), 16);
+}
+
+/*
+ * A typical AIVDM sentence through a ring the size of the firmware's. The consumer drains
+ * whenever a write would not fit, which is the worst case for the DMA chunking.
+ */
+static void benchThroughput()
+{
+  static ByteRingBuffer<1024> ring;
+  const char *sentence = "!AIVDM,1,1,,A,15MgK45P3@G?fl0E`JbR0OwT0@MS,0*4E\r\n";
+  size_t len = strlen(sentence);
+  const int count = 2000000;
+  uint64_t bytes = 0;
+
+  uint64_t start = nowNs();
+  for ( int i = 0; i < count; ++i )
+    {
+      while ( !ring.write((const uint8_t*)sentence, len) )
+        {
+          const uint8_t *data = nullptr;
+          size_t n = ring.peekContiguous(data);
+          bytes += n;
+          ring.consume(n);
+        }
+    }
+  uint64_t elapsed = nowNs() - start;
+
+  double perSentence = (double)elapsed / count;
+  printf("  ring: %.1f ns per %u byte sentence, %.0f MB/s drained\n", perSentence, (unsigned)len,
+      bytes * 1000.0 / elapsed);
+
+  // The blocking path held the caller until every character had left the UART
+  printf("  blocking write at 38400 baud: %.0f us per sentence\n", len * 10 * 1e6 / 38400);
+}
+
+int main()
+{
+  testOrdering();
+  testWrapAround();
+  benchThroughput();
+  return testResult("test_byte_ring");
+}
@@ -0,0 +1,204 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * CRC syndrome correction corpus. Frames of typical lengths get 1 to 4 bit errors, either at random
+ * or clustered like a corrupted NRZI level, and RXPacket::correctCRC() must repair what it claims to repair.
+ * Built with RX_CRC_CORRECTION forced on.
+ */
+
+#include "TestUtils.hpp"
+#include "AISFrames.hpp"
+#include <algorithm>
+#include "RXPacket.hpp"
+
+#if !RX_CRC_CORRECTION
+#error "This test needs RX_CRC_CORRECTION"
+#endif
+
+// A packet as the decoder builds it from air order bits
+static void receive(RXPacket &p, const std::vector<uint8_t> &air)
+{
+  p.reset();
+  for ( size_t i = 0; i + 8 <= air.size(); i += 8 )
+    {
+      uint8_t byte = 0;
+      for ( uint8_t j = 0; j < 8; ++j )
+        byte = (byte << 1) | air[i + j];
+      p.addByte(byte);
+    }
+}
+
+static bool sameBits(const RXPacket &p, const std::vector<uint8_t> &bits)
+{
+  if ( p.size() != bits.size() )
+    return false;
+
+  for ( uint16_t i = 0; i < p.size(); ++i )
+    if ( p.bit(i) != bits[i] )
+      return false;
+
+  return true;
+}
+
+typedef struct {
+  uint32_t fixed1;
+  uint32_t fixed2;
+  uint32_t overBudget;
+  uint32_t uncorrectable;
+  uint32_t wrong;             // "Corrected" into something that isn't the original frame
+} CorpusResult;
+
+/*
+ * span == 0 puts the errors anywhere, otherwise each error is 1..span bits after the previous one
+ */
+static CorpusResult corpus(uint16_t payloadBits, uint8_t errors, uint8_t span, uint32_t count)
+{
+  TestRandom rnd(payloadBits * 31 + errors * 7 + span);
+  CorpusResult r = {0, 0, 0, 0, 0};
+
+  for ( uint32_t i = 0; i < count; ++i )
+    {
+      AISFrameStream stream(rnd);
+      std::vector<uint8_t> bits = stream.randomPayload(payloadBits);
+      std::vector<uint8_t> air = AISFrameStream::byteReversed(bits);
+
+      std::vector<size_t> positions;
+      if ( span == 0 )
+        {
+          while ( positions.size() < errors )
+            {
+              size_t pos = rnd.range(0, air.size() - 1);
+              if ( std::find(positions.begin(), positions.end(), pos) == positions.end() )
+                positions.push_back(pos);
+            }
+        }
+      else
+        {
+          size_t pos = rnd.range(0, air.size() - 1 - errors * span);
+          positions.push_back(pos);
+          for ( uint8_t e = 1; e < errors; ++e )
+            positions.push_back(pos += rnd.range(1, span));
+        }
+
+      for ( size_t pos : positions )
+        air[pos] ^= 1;
+
+      RXPacket p;
+      receive(p, air);
+      if ( p.checkCRC() )
+        {
+          // The CRC catches every pattern of up to 3 errors at these lengths, but not all of 4
+          CHECK(errors >= 4);
+          continue;
+        }
+
+      switch ( p.correctCRC(RX_CRC_CORRECTION_BUDGET) ) {
+      case RXPacket::CRC_CORRECTED_1_BIT:
+        ++r.fixed1;
+        break;
+      case RXPacket::CRC_CORRECTED_2_BITS:
+        ++r.fixed2;
+        break;
+      case RXPacket::CRC_OVER_BUDGET:
+        ++r.overBudget;
+        continue;
+      case RXPacket::CRC_UNCORRECTABLE:
+        ++r.uncorrectable;
+        continue;
+      }
+
+      CHECK(p.checkCRC());
+      if ( !sameBits(p, bits) )
+        ++r.wrong;
+    }
+
+  return r;
+}
+
+static void report(uint16_t bits, uint8_t errors, uint8_t span, const CorpusResult &r, uint32_t count)
+{
+  printf("  %3u bits, %u error%s %-8s fixed %5.1f%%, falsely %5.2f%%, uncorrectable %5.1f%%, over budget %5.1f%%\n",
+      bits + 16, errors, errors > 1 ? "s" : " ", span ? "burst" : "random",
+      100.0 * (r.fixed1 + r.fixed2 - r.wrong) / count, 100.0 * r.wrong / count,
+      100.0 * r.uncorrectable / count, 100.0 * r.overBudget / count);
+}
+
+static void testCorpus()
+{
+  const uint32_t count = 20000;
+  static const uint16_t lengths[] = { 168, 424 };
+
+  for ( uint16_t bits : lengths )
+    {
+      // Whatever is in reach of the search must come back exactly
+      CorpusResult r = corpus(bits, 1, 0, count);
+      CHECK_EQ(r.fixed1, count);
+      CHECK_EQ(r.wrong, 0);
+      report(bits, 1, 0, r, count);
+
+      r = corpus(bits, 2, RX_CRC_CORRECTION_SPAN, count);
+      CHECK_EQ(r.fixed2, count);
+      CHECK_EQ(r.wrong, 0);
+      report(bits, 2, RX_CRC_CORRECTION_SPAN, r, count);
+
+      // Beyond that the CRC is weakened, which is why the switch is off by default. Keep it bounded.
+      for ( uint8_t errors = 2; errors <= 4; ++errors )
+        {
+          r = corpus(bits, errors, 0, count);
+          CHECK(r.wrong < count / 10);
+          report(bits, errors, 0, r, count);
+        }
+    }
+}
+
+static void testBudget()
+{
+  TestRandom rnd(5);
+  AISFrameStream stream(rnd);
+  std::vector<uint8_t> bits = stream.randomPayload(424);
+  std::vector<uint8_t> air = AISFrameStream::byteReversed(bits);
+  air[100] ^= 1;
+  air[102] ^= 1;
+
+  // Not even the single bit search fits, and a search that isn't started leaves the packet alone
+  RXPacket p;
+  receive(p, air);
+  uint16_t crc = p.crc();
+  CHECK_EQ(p.correctCRC(bits.size() - 1), RXPacket::CRC_OVER_BUDGET);
+  CHECK_EQ(p.crc(), crc);
+  CHECK_EQ(p.bit(100 - 100 % 8 + 7 - 100 % 8), bits[100 - 100 % 8 + 7 - 100 % 8] ^ 1);
+
+  // The single bit search fits but the pair search doesn't
+  CHECK_EQ(p.correctCRC(bits.size() * 2), RXPacket::CRC_OVER_BUDGET);
+
+  CHECK_EQ(p.correctCRC(bits.size() * (1 + RX_CRC_CORRECTION_SPAN)), RXPacket::CRC_CORRECTED_2_BITS);
+  CHECK(sameBits(p, bits));
+
+  // A good packet is left alone
+  CHECK_EQ(p.correctCRC(RX_CRC_CORRECTION_BUDGET), RXPacket::CRC_UNCORRECTABLE);
+  CHECK(sameBits(p, bits));
+}
+
+int main()
+{
+  testBudget();
+  testCorpus();
+  return testResult("test_crc_correction");
+}
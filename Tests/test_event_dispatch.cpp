@@ -0,0 +1,195 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * EventQueue dispatch: every event reaches exactly the consumers subscribed to its type, in registration
+ * order, the same set the old std::map walk delivered to. Then a microbenchmark of the two dispatch paths
+ * with the firmware's own consumer masks.
+ */
+
+#include "TestUtils.hpp"
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "LockFreeQueue.hpp"
+#include "Events.hpp"
+
+// The benchmark times EventQueue::dispatch(Event*) on its own, without the lanes
+#define private public
+#include "EventQueue.hpp"
+#undef private
+
+static std::vector<int> __deliveries;
+
+class CountingConsumer : public EventConsumer
+{
+public:
+  CountingConsumer() : mId(0), mCount(0) { }
+
+  void processEvent(const Event &)
+  {
+    ++mCount;
+    if ( mRecord )
+      __deliveries.push_back(mId);
+  }
+
+  int mId;
+  uint32_t mCount;
+  static bool mRecord;
+};
+
+bool CountingConsumer::mRecord = false;
+
+// The observers main() registers, one per addObserver() call in the firmware
+static const EventMask __masks[] = {
+    GPS_NMEA_SENTENCE,                                    // GPS
+    CLOCK_EVENT,                                          // RadioManager
+    CLOCK_EVENT,                                          // RXFunnel
+    CLOCK_EVENT,                                          // NoiseFloorDetector
+    CLOCK_EVENT,                                          // Transceiver
+    AIS_PACKET_EVENT,                                     // RXPacketProcessor
+    GPS_FIX_EVENT|CLOCK_EVENT|INTERROGATION_EVENT,        // TXScheduler
+    CLOCK_EVENT,                                          // PerfTrace
+    AIS_PACKET_EVENT,                                     // ChannelManager
+    DEBUG_EVENT|PROPR_NMEA_SENTENCE,                      // DataTerminal
+    COMMAND_EVENT,                                        // CommandProcessor
+};
+
+#define CONSUMER_COUNT (sizeof __masks / sizeof __masks[0])
+
+static CountingConsumer __consumers[CONSUMER_COUNT];
+
+// The pre-table dispatcher: walk every consumer and test its mask
+static std::map<EventConsumer*, EventMask> __legacy;
+
+static void legacyDispatch(Event *e)
+{
+  for ( std::map<EventConsumer*, EventMask>::iterator c = __legacy.begin(); c != __legacy.end(); ++c )
+    {
+      if ( c->second & e->type )
+        c->first->processEvent(*e);
+    }
+
+  EventPool::instance().deleteEvent(e);
+}
+
+static void testDelivery()
+{
+  CountingConsumer::mRecord = true;
+
+  for ( uint32_t t = 0; t < EVENT_TYPE_COUNT; ++t )
+    {
+      EventType type = (EventType)(1ULL << t);
+
+      std::vector<int> expected;
+      for ( size_t c = 0; c < CONSUMER_COUNT; ++c )
+        if ( __masks[c] & type )
+          expected.push_back(c);
+
+      __deliveries.clear();
+      Event *e = EventPool::instance().newEvent(type);
+      CHECK(e != nullptr);
+      CHECK(EventQueue::instance().push(e));
+      EventQueue::instance().dispatch();
+      CHECK(__deliveries == expected);
+
+      // Same set through the map (which orders by address, not registration)
+      __deliveries.clear();
+      legacyDispatch(EventPool::instance().newEvent(type));
+      std::vector<int> legacy = __deliveries;
+      std::sort(legacy.begin(), legacy.end());
+      CHECK(legacy == expected);
+    }
+
+  // Re-registering replaces the mask, removing drops every subscription
+  EventQueue::instance().addObserver(&__consumers[0], CLOCK_EVENT);
+  __deliveries.clear();
+  EventQueue::instance().push(EventPool::instance().newEvent(GPS_NMEA_SENTENCE));
+  EventQueue::instance().dispatch();
+  CHECK(__deliveries.empty());
+
+  EventQueue::instance().removeObserver(&__consumers[0]);
+  __deliveries.clear();
+  EventQueue::instance().push(EventPool::instance().newEvent(CLOCK_EVENT));
+  EventQueue::instance().dispatch();
+  CHECK_EQ(std::count(__deliveries.begin(), __deliveries.end(), 0), 0);
+  CHECK_EQ(__deliveries.size(), 6);
+
+  EventQueue::instance().addObserver(&__consumers[0], __masks[0]);
+  CountingConsumer::mRecord = false;
+}
+
+static const EventType __mix[] = { GPS_NMEA_SENTENCE, GPS_NMEA_SENTENCE, GPS_NMEA_SENTENCE, AIS_PACKET_EVENT,
+                                   AIS_PACKET_EVENT, CLOCK_EVENT, PROPR_NMEA_SENTENCE, DEBUG_EVENT };
+#define MIX_SIZE  (sizeof __mix / sizeof __mix[0])
+#define ROUNDS    200000
+
+// Nanoseconds per event, best of a few runs
+template<typename F>
+static double measure(F f)
+{
+  double best = 1e9;
+  for ( int run = 0; run < 5; ++run )
+    {
+      uint64_t start = nowNs();
+      for ( int r = 0; r < ROUNDS; ++r )
+        for ( size_t i = 0; i < MIX_SIZE; ++i )
+          f(__mix[i]);
+      double ns = (double)(nowNs() - start) / (ROUNDS * MIX_SIZE);
+      if ( ns < best )
+        best = ns;
+    }
+  return best;
+}
+
+/*
+ * Both paths get the event from the pool and free it when done. That cost is measured on its own and
+ * taken out, which leaves the consumer lookup and the calls.
+ */
+static void benchDispatch()
+{
+  double pool = measure([](EventType t) {
+    EventPool::instance().deleteEvent(EventPool::instance().newEvent(t));
+  });
+
+  double legacy = measure([](EventType t) {
+    legacyDispatch(EventPool::instance().newEvent(t));
+  });
+
+  double table = measure([](EventType t) {
+    EventQueue::instance().dispatch(EventPool::instance().newEvent(t));
+  });
+
+  printf("  %u consumers, map walk: %.1f ns/event, table: %.1f ns/event (pool %.1f ns excluded)\n",
+      (unsigned)CONSUMER_COUNT, legacy - pool, table - pool, pool);
+}
+
+int main()
+{
+  for ( size_t c = 0; c < CONSUMER_COUNT; ++c )
+    {
+      __consumers[c].mId = c;
+      EventQueue::instance().addObserver(&__consumers[c], __masks[c]);
+      __legacy[&__consumers[c]] = __masks[c];
+    }
+
+  testDelivery();
+  benchDispatch();
+  return testResult("test_event_dispatch");
+}
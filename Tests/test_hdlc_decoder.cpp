@@ -0,0 +1,625 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * HDLCDecoder replays. Level streams made of AIS frames, truncated frames and noise go through the decoder
+ * 8 levels at a time, as the decode interrupt feeds it, and through a reference that decodes one level at a
+ * time like the bit clock interrupt used to. Both must report the same frames at the same bit positions.
+ */
+
+#include "TestUtils.hpp"
+#include "AISFrames.hpp"
+#include "HDLCDecoder.hpp"
+#include <set>
+#include <string>
+
+typedef struct {
+  char event;                   // S(tart), E(nd), R(esync end) or A(bort)
+  long position;                // Level that triggered it
+  uint16_t size;
+  uint16_t crc;
+  uint8_t syncErrors;
+  bool collision;
+  bool good;                    // Passed the CRC
+  std::vector<uint8_t> bits;
+} FrameRecord;
+
+static FrameRecord snapshot(char event, long position, const RXPacket &p)
+{
+  FrameRecord r;
+  r.event = event;
+  r.position = position;
+  r.size = p.size();
+  r.crc = p.crc();
+  r.syncErrors = p.syncErrors();
+  r.collision = p.collision();
+  r.good = p.checkCRC();
+  for ( uint16_t i = 0; i < p.size(); ++i )
+    r.bits.push_back(p.bit(i));
+  return r;
+}
+
+static bool sameRecord(const FrameRecord &a, const FrameRecord &b)
+{
+  return a.event == b.event && a.position == b.position && a.size == b.size && a.crc == b.crc &&
+      a.syncErrors == b.syncErrors && a.collision == b.collision && a.bits == b.bits;
+}
+
+/*
+ * The per-bit receiver, decoding one level per bit clock interrupt. Frame start needs an exact flag
+ * preceded by either the last 4 training bits or the last RX_PREAMBLE_BITS of them within the tolerance
+ * (0 is the exact 4 bit match alone). A flag that ends a frame with a bad CRC starts a colliding frame
+ * only after all RX_PREAMBLE_BITS training bits without an error.
+ */
+class ReferenceDecoder
+{
+public:
+  ReferenceDecoder(uint8_t tolerance = RX_PREAMBLE_TOLERANCE) : mTolerance(tolerance), mPosition(0) { reset(); }
+
+  uint32_t goodFrames() const
+  {
+    uint32_t count = 0;
+    for ( const FrameRecord &r : records )
+      count += r.event != 'S' && r.event != 'A' && r.good;
+    return count;
+  }
+
+  void level(uint8_t level)
+  {
+    ++mPosition;
+    if ( mLast == 0xff )
+      {
+        mLast = level;
+        return;
+      }
+
+    uint8_t bit = !(mLast ^ level);
+    if ( !mInPacket )
+      {
+        mLast = level;
+        mWindow = (mWindow << 1) | bit;
+        int errors = syncErrors();
+        if ( errors >= 0 )
+          {
+            mInPacket = true;
+            mPacket.setSyncErrors(errors);
+            records.push_back(snapshot('S', mPosition, mPacket));
+          }
+        return;
+      }
+
+    if ( mOnes >= 7 || mPacket.size() >= MAX_AIS_RX_PACKET_SIZE - 2 )
+      {
+        records.push_back(snapshot('A', mPosition, mPacket));
+        reset();
+        return;
+      }
+
+    mLast = level;
+    mWindow = (mWindow << 1) | bit;
+    if ( (mWindow & 0xff) == 0x7e )
+      {
+        int errors = !mPacket.checkCRC() && trainingComplete() ? 0 : -1;
+        records.push_back(snapshot(errors >= 0 ? 'R' : 'E', mPosition, mPacket));
+
+        uint32_t window = mWindow;
+        reset();
+        if ( errors >= 0 )
+          {
+            mInPacket = true;
+            mWindow = window;
+            mLast = level;
+            mPacket.setSyncErrors(errors);
+            mPacket.setCollision(true);
+            records.push_back(snapshot('S', mPosition, mPacket));
+          }
+        return;
+      }
+
+    if ( bit )
+      {
+        ++mOnes;
+      }
+    else
+      {
+        bool stuffed = mOnes == 5;
+        mOnes = 0;
+        if ( stuffed )
+          return;
+      }
+
+    mData = (mData << 1) | bit;
+    if ( ++mDataBits == 8 )
+      {
+        mPacket.addByte(mData);
+        mDataBits = 0;
+        mData = 0;
+      }
+  }
+
+  std::vector<FrameRecord> records;
+
+private:
+  void reset()
+  {
+    mInPacket = false;
+    mWindow = 0;
+    mLast = 0xff;
+    mOnes = 0;
+    mDataBits = 0;
+    mData = 0;
+    mPacket.reset();
+  }
+
+  int syncErrors() const
+  {
+    if ( (mWindow & 0xff) != 0x7e )
+      return -1;
+
+    uint32_t training = mWindow >> 8;
+    if ( (training & 0x0f) == 0x0a || (training & 0x0f) == 0x05 )
+      return 0;
+
+    if ( mTolerance == 0 )
+      return -1;
+
+    int distance = 0;
+    for ( int i = 0; i < RX_PREAMBLE_BITS; ++i )
+      distance += ((training >> i) & 1) != (i & 1);
+    if ( distance > RX_PREAMBLE_BITS / 2 )
+      distance = RX_PREAMBLE_BITS - distance;
+
+    return distance <= mTolerance ? distance : -1;
+  }
+
+  bool trainingComplete() const
+  {
+    uint32_t training = mWindow >> 8;
+    int distance = 0;
+    for ( int i = 0; i < RX_PREAMBLE_BITS; ++i )
+      distance += ((training >> i) & 1) != (i & 1);
+
+    return distance == 0 || distance == RX_PREAMBLE_BITS;
+  }
+
+private:
+  uint8_t mTolerance;
+  RXPacket mPacket;
+  bool mInPacket;
+  uint32_t mWindow;
+  uint8_t mLast;
+  uint8_t mOnes;
+  uint8_t mDataBits;
+  uint8_t mData;
+  long mPosition;
+};
+
+/*
+ * Stands in for the Receiver: records every callback and hands the decoder a fresh packet after each frame
+ */
+class ReplayListener : public HDLCDecoderListener
+{
+public:
+  ReplayListener() : mDecoder(this), mPacket(&mPackets[0]), mPosition(0)
+  {
+    mDecoder.setPacket(mPacket);
+    mDecoder.reset();
+  }
+
+  void replay(const std::vector<uint8_t> &bytes)
+  {
+    for ( uint8_t b : bytes )
+      decode(b);
+  }
+
+  void decode(uint8_t byte)
+  {
+    mPosition += 8;
+    mDecoder.decode(byte);
+  }
+
+  // What the receiver did before continuous RX: START_RX and a fresh decoder after every frame
+  void restart()
+  {
+    mDecoder.reset();
+    restartPending = false;
+  }
+
+  void onFrameStart(uint8_t bitsLeft)
+  {
+    ++starts;
+    records.push_back(snapshot('S', mPosition - bitsLeft, *mPacket));
+  }
+
+  void onFrameEnd(uint8_t bitsLeft, bool resync)
+  {
+    records.push_back(snapshot(resync ? 'R' : 'E', mPosition - bitsLeft, *mPacket));
+    restartPending |= !resync;
+    if ( mPacket->checkCRC() )
+      frames.push_back(records.back().bits);
+
+    mPacket = mPacket == &mPackets[0] ? &mPackets[1] : &mPackets[0];
+    mDecoder.setPacket(mPacket);
+  }
+
+  void onFrameAbort(FrameAbortReason)
+  {
+    records.push_back(snapshot('A', mPosition, *mPacket));
+    restartPending = true;
+  }
+
+  std::vector<FrameRecord> records;
+  std::vector<std::vector<uint8_t> > frames;    // Bits of every frame that passed the CRC
+  uint32_t starts = 0;
+  bool restartPending = false;
+
+private:
+  HDLCDecoder mDecoder;
+  RXPacket mPackets[2];
+  RXPacket *mPacket;
+  long mPosition;
+};
+
+static bool replayMatches(const std::vector<uint8_t> &levels, ReplayListener &replay)
+{
+  ReferenceDecoder reference;
+  for ( uint8_t l : levels )
+    reference.level(l);
+
+  replay.replay(AISFrameStream::pack(levels));
+
+  if ( reference.records.size() != replay.records.size() )
+    {
+      printf("  %zu reference records, %zu replayed\n", reference.records.size(), replay.records.size());
+      return false;
+    }
+
+  for ( size_t i = 0; i < reference.records.size(); ++i )
+    {
+      const FrameRecord &a = reference.records[i];
+      const FrameRecord &b = replay.records[i];
+
+      // An abort is reported before the bit that caused it, which the byte decoder doesn't track
+      if ( a.event == 'A' && b.event == 'A' )
+        continue;
+
+      if ( !sameRecord(a, b) )
+        {
+          printf("  record %zu: %c at %ld (%u bits) vs %c at %ld (%u bits)\n", i, a.event, a.position, a.size,
+              b.event, b.position, b.size);
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/*
+ * Random mixes of clean frames, long frames, truncated ones, aborts and noise of different densities
+ */
+static void testMatchesPerBitDecoding()
+{
+  TestRandom rnd(7);
+  long frames = 0, levels = 0;
+
+  for ( int iter = 0; iter < 3000; ++iter )
+    {
+      AISFrameStream stream(rnd);
+      uint8_t segments = rnd.range(1, 20);
+      for ( uint8_t s = 0; s < segments; ++s )
+        {
+          switch ( rnd.range(0, 5) ) {
+          case 0:
+            stream.noise(rnd.range(0, 300));
+            break;
+          case 1:
+            // Long runs of ones, so the per-bit fallback is taken a lot
+            stream.noise(rnd.range(0, 300), 8);
+            break;
+          case 2:
+          case 3:
+            stream.frame(rnd.range(1, 60) * 8, rnd.next() & 1);
+            break;
+          case 4:
+            // Longer than any AIS packet
+            stream.training(24);
+            stream.flag();
+            stream.randomPayload(rnd.range(MAX_AIS_RX_PACKET_SIZE / 8 - 5, MAX_AIS_RX_PACKET_SIZE / 8 + 5) * 8);
+            break;
+          case 5:
+            stream.training(24);
+            stream.flag();
+            stream.randomPayload(rnd.range(0, 25) * 8);
+            stream.abort();
+            break;
+          }
+        }
+
+      std::vector<uint8_t> l = stream.levels();
+      ReplayListener replay;
+      if ( !replayMatches(l, replay) )
+        {
+          printf("  iteration %d differs\n", iter);
+          CHECK(false);
+          return;
+        }
+
+      frames += replay.frames.size();
+      levels += l.size();
+    }
+
+  printf("  %ld levels, %ld good frames, identical to per-bit decoding\n", levels, frames);
+}
+
+// Every clean frame in a continuous stream comes out with its exact bits and a good CRC
+static void testCleanFrames()
+{
+  TestRandom rnd(11);
+  AISFrameStream stream(rnd);
+  std::vector<std::vector<uint8_t> > sent;
+
+  for ( int i = 0; i < 500; ++i )
+    {
+      stream.noise(rnd.range(8, 64));
+      sent.push_back(stream.frame(rnd.range(1, 60) * 8, i & 1));
+    }
+
+  ReplayListener replay;
+  replay.replay(AISFrameStream::pack(stream.levels()));
+  CHECK(replay.frames == sent);
+}
+
+/*
+ * A frame cut off by a stronger one that starts in the middle of it. The decoder only sees the end of the
+ * first frame at the flag of the second, so it has to fork there to get the second frame at all.
+ */
+static void testOverlappingFrames()
+{
+  TestRandom rnd(17);
+  uint32_t collisions = 0;
+
+  for ( int iter = 0; iter < 2000; ++iter )
+    {
+      AISFrameStream stream(rnd);
+      stream.noise(rnd.range(20, 100));
+      stream.training(24, rnd.next() & 1);
+      stream.flag();
+      stream.randomPayload(rnd.range(1, 40) * 8);
+      std::vector<uint8_t> second = stream.frame(rnd.range(1, 60) * 8, rnd.next() & 1);
+      stream.noise(rnd.range(20, 100));
+
+      std::vector<uint8_t> levels = stream.levels();
+      ReplayListener replay;
+      CHECK(replayMatches(levels, replay));
+      CHECK_EQ(replay.frames.size(), 1u);
+      if ( replay.frames.size() == 1 )
+        CHECK(replay.frames[0] == second);
+
+      for ( const FrameRecord &r : replay.records )
+        collisions += r.event == 'E' && r.good && r.collision;
+    }
+
+  // Unless random data in the first frame happened to end it early, the second frame came from a fork
+  printf("  2000 overlapping frames, %u recovered through a fork\n", collisions);
+  CHECK(collisions > 1900);
+
+  // Damaged frames on their own must hardly ever fork at their closing flag
+  TestRandom noise(19);
+  AISFrameStream stream(noise);
+  std::set<long> ends;
+  for ( int f = 0; f < 20000; ++f )
+    {
+      stream.noise(noise.range(100, 300));
+      size_t start = stream.size();
+      stream.frame(168);
+      stream.flip(start + 40 + noise.range(0, 150));
+      ends.insert(stream.size());
+    }
+
+  ReplayListener replay;
+  replay.replay(AISFrameStream::pack(stream.levels()));
+
+  // Forks at a real frame's flag after a false start in the noise are fine, so only the ends count here
+  uint32_t forks = 0;
+  for ( const FrameRecord &r : replay.records )
+    forks += r.event == 'R' && ends.count(r.position);
+
+  printf("  20000 damaged frames, %u forks at the closing flag\n", forks);
+  CHECK(forks < 100);
+}
+
+/*
+ * 20000 frames in noise, with each of the 24 training bits flipped at the given rate. The exact 4 bit match
+ * loses a frame whenever one of those 4 is hit. Returns the good frames found by the decoder and by the
+ * exact match alone.
+ */
+static void replayTrainingErrors(uint32_t permille, uint32_t &tolerant, uint32_t &exact, bool noiseOnly = false)
+{
+  TestRandom rnd(13);
+  AISFrameStream stream(rnd);
+
+  for ( int f = 0; f < 20000; ++f )
+    {
+      stream.noise(rnd.range(100, 300));
+      if ( noiseOnly )
+        continue;
+
+      size_t training = stream.size();
+      stream.frame(168);
+      for ( size_t i = training; i < training + 24; ++i )
+        if ( rnd.range(0, 999) < permille )
+          stream.flip(i);
+    }
+
+  std::vector<uint8_t> levels = stream.levels();
+
+  ReplayListener replay;
+  replay.replay(AISFrameStream::pack(levels));
+  tolerant = noiseOnly ? replay.starts : replay.frames.size();
+
+  ReferenceDecoder reference(0);
+  for ( uint8_t l : levels )
+    reference.level(l);
+
+  exact = 0;
+  for ( const FrameRecord &r : reference.records )
+    exact += noiseOnly ? r.event == 'S' : r.event != 'S' && r.event != 'A' && r.good;
+}
+
+static void testTrainingErrors()
+{
+  static const uint32_t rates[] = { 0, 20, 50, 100 };
+  uint32_t previous = 20000;
+
+  for ( uint32_t permille : rates )
+    {
+      uint32_t tolerant, exact;
+      replayTrainingErrors(permille, tolerant, exact);
+      printf("  %2u.%u%% training bit errors: %5u good frames, %5u with the exact 4 bit match\n",
+          permille / 10, permille % 10, tolerant, exact);
+
+      CHECK(tolerant >= exact);
+      CHECK(tolerant <= previous);
+      previous = tolerant;
+    }
+
+  // Noise alone must not start frames much more often than before
+  uint32_t tolerant, exact;
+  replayTrainingErrors(0, tolerant, exact, true);
+  printf("  noise only: %u frame starts, %u with the exact 4 bit match\n", tolerant, exact);
+  CHECK(tolerant < exact + exact / 10);
+}
+
+/*
+ * Back-to-back 256 bit slots with one frame each, starting 8 bits into the slot give or take the sync jitter.
+ * A frame that overruns its slot is cut off. Returns the good frames with continuous RX, or with a restart
+ * after every frame that loses the given number of bits while the RFIC settles.
+ */
+static uint32_t replaySlots(uint16_t payloadBits, uint8_t jitter, int16_t lost)
+{
+  TestRandom rnd(23);
+  AISFrameStream stream(rnd);
+
+  for ( int s = 0; s < 20000; ++s )
+    {
+      size_t slot = stream.size();
+      stream.noise(8 + rnd.range(0, 2 * jitter) - jitter);
+      stream.frame(payloadBits);
+      if ( stream.size() - slot > 256 )
+        stream.truncate(slot + 256);
+      else
+        stream.noise(slot + 256 - stream.size());
+    }
+
+  std::vector<uint8_t> levels = stream.levels();
+  ReplayListener replay;
+  if ( lost < 0 )
+    {
+      replay.replay(AISFrameStream::pack(levels));
+      return replay.frames.size();
+    }
+
+  uint16_t drop = 0;
+  for ( size_t i = 0; i < levels.size(); i += 8 )
+    {
+      uint8_t byte = 0;
+      for ( uint8_t j = 0; j < 8; ++j )
+        {
+          uint8_t level = levels[i + j];
+          if ( drop )
+            {
+              level = rnd.next() & 1;
+              --drop;
+            }
+          byte = (byte << 1) | level;
+        }
+
+      replay.decode(byte);
+      if ( replay.restartPending )
+        {
+          replay.restart();
+          drop = lost;
+        }
+    }
+
+  return replay.frames.size();
+}
+
+static void testContinuousRX()
+{
+  static const struct {
+    uint16_t payloadBits;
+    uint8_t jitter;
+  } cases[] = { { 168, 3 }, { 184, 3 }, { 184, 8 } };
+
+  for ( auto &c : cases )
+    {
+      uint32_t continuous = replaySlots(c.payloadBits, c.jitter, -1);
+      printf("  %u bit payload, +-%u bits jitter: continuous %5u,", c.payloadBits, c.jitter, continuous);
+      for ( int16_t lost : { 0, 8, 16, 32 } )
+        {
+          uint32_t restarted = replaySlots(c.payloadBits, c.jitter, lost);
+          printf(" %u lost %5u%s", lost, restarted, lost < 32 ? "," : "\n");
+          CHECK(continuous >= restarted);
+        }
+
+      // Frames that fill their slot lose the next frame's training to a slow restart
+      if ( c.payloadBits >= 184 )
+        CHECK(continuous > replaySlots(c.payloadBits, c.jitter, 32));
+    }
+}
+
+static void benchDecoding()
+{
+  TestRandom rnd(3);
+  AISFrameStream stream(rnd);
+  for ( int i = 0; i < 20000; ++i )
+    {
+      stream.frame(168);
+      stream.noise(20);
+    }
+
+  std::vector<uint8_t> levels = stream.levels();
+  std::vector<uint8_t> bytes = AISFrameStream::pack(levels);
+
+  ReferenceDecoder reference;
+  uint64_t start = nowNs();
+  for ( uint8_t l : levels )
+    reference.level(l);
+  double perBit = (double)(nowNs() - start) / levels.size();
+
+  ReplayListener replay;
+  start = nowNs();
+  replay.replay(bytes);
+  double perByte = (double)(nowNs() - start) / levels.size();
+
+  CHECK_EQ(replay.frames.size(), 20000);
+  printf("  per-bit: %.2f ns/level, 8 levels at a time: %.2f ns/level\n", perBit, perByte);
+}
+
+int main()
+{
+  testMatchesPerBitDecoding();
+  testCleanFrames();
+  testOverlappingFrames();
+  testTrainingErrors();
+  testContinuousRX();
+  benchDecoding();
+  return testResult("test_hdlc_decoder");
+}
@@ -0,0 +1,290 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * HDLCEncoder against the encoder it replaced: random frames of random fields, built one bit per byte,
+ * then CRC, byte reversal, bit stuffing, framing and NRZI in separate passes. Both must produce the
+ * same levels, and the single pass encoder must be faster.
+ */
+
+#include "TestUtils.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "HDLCEncoder.hpp"
+#include "Utils.hpp"
+
+/*
+ * The multi pass encoder, as AISMessage had it
+ */
+class ReferenceEncoder
+{
+public:
+  ReferenceEncoder() : mSize(0) { }
+
+  void addBits(uint32_t value, uint8_t numBits)
+  {
+    for ( uint8_t bit = 0; bit < numBits; ++bit, value >>= 1 )
+      mPayload[mSize + numBits - bit - 1] = value & 1;
+
+    mSize += numBits;
+  }
+
+  void addString(const char *value, uint8_t maxChars)
+  {
+    char s[30];
+    memset(s, 0, sizeof s);
+    memcpy(s, value, strlen(value));
+
+    for ( uint8_t c = 0; c < maxChars; ++c )
+      addBits(s[c] >= 64 ? s[c] - 64 : s[c], 6);
+  }
+
+  void finish(TXPacket &packet)
+  {
+    uint8_t bytes[40];
+
+    payloadToBytes(bytes);
+    uint16_t crc = Utils::crc16(bytes, mSize / 8);
+    addBits(crc & 0x00ff, 8);
+    addBits((crc & 0xff00) >> 8, 8);
+
+    for ( uint16_t i = 0; i < mSize; i += 8 )
+      std::reverse(mPayload + i, mPayload + i + 8);
+
+    bitStuff();
+    frame();
+    nrziEncode(packet);
+    packet.pad();
+  }
+
+private:
+  void payloadToBytes(uint8_t *bytes)
+  {
+    for ( uint16_t i = 0; i < mSize; i += 8 )
+      {
+        uint8_t byte = 0;
+        for ( uint8_t b = 0; b < 8; ++b )
+          byte |= mPayload[i + b] << b;
+        bytes[i / 8] = byte;
+      }
+  }
+
+  void bitStuff()
+  {
+    uint16_t ones = 0;
+    for ( uint16_t i = 0; i < mSize; ++i )
+      {
+        if ( mPayload[i] == 0 )
+          {
+            ones = 0;
+          }
+        else if ( ++ones == 5 )
+          {
+            memmove(mPayload + i + 2, mPayload + i + 1, mSize - i - 1);
+            mPayload[i + 1] = 0;
+            ++mSize;
+          }
+      }
+  }
+
+  void putBits(uint8_t *buff, uint32_t value, uint8_t numBits)
+  {
+    for ( uint8_t bit = 0; bit < numBits; ++bit, value >>= 1 )
+      buff[bit] = value & 0x01;
+  }
+
+  void frame()
+  {
+    memmove(mPayload + 35, mPayload, mSize);
+    mSize += 35;
+    putBits(mPayload, 0xFF, 3);
+    putBits(mPayload + 3, 0b010101010101010101010101, 24);
+    putBits(mPayload + 27, 0x7e, 8);
+
+    addBits(0x7e, 8);
+    addBits(0x00, 3);
+  }
+
+  void nrziEncode(TXPacket &packet)
+  {
+    uint8_t prevBit = 1;
+    packet.addBit(prevBit);
+
+    for ( uint16_t i = 0; i < mSize; ++i )
+      {
+        if ( mPayload[i] == 0 )
+          prevBit = !prevBit;
+        packet.addBit(prevBit);
+      }
+  }
+
+  uint8_t mPayload[MAX_AIS_TX_PACKET_SIZE];
+  uint16_t mSize;
+};
+
+typedef struct
+{
+  uint32_t value;
+  uint8_t bits;
+  std::string text;         // A string field of bits / 6 characters if not empty
+} Field;
+
+// Up to 152 payload bits, so every frame fits in a TXPacket even if every 5th bit gets stuffed
+static std::vector<Field> randomFields(TestRandom &rnd)
+{
+  std::vector<Field> fields;
+  uint16_t target = rnd.range(1, 19) * 8;
+  uint16_t total = 0;
+
+  while ( total < target )
+    {
+      Field f;
+      f.bits = std::min<uint16_t>(rnd.range(1, 32), target - total);
+
+      // Long runs of ones need stuffing, so all-ones values are common
+      switch ( rnd.range(0, 2) ) {
+      case 0:
+        f.value = 0xffffffff;
+        break;
+      default:
+        f.value = rnd.next();
+        break;
+      }
+
+      if ( f.bits % 6 == 0 && rnd.range(0, 3) == 0 )
+        {
+          uint8_t len = rnd.range(0, f.bits / 6);
+          for ( uint8_t c = 0; c < len; ++c )
+            f.text += (char)rnd.range(32, 95);
+        }
+
+      fields.push_back(f);
+      total += f.bits;
+    }
+
+  return fields;
+}
+
+static void encode(HDLCEncoder &e, const std::vector<Field> &fields, size_t from = 0)
+{
+  for ( size_t i = from; i < fields.size(); ++i )
+    {
+      if ( fields[i].text.size() )
+        e.addString(fields[i].text.c_str(), fields[i].bits / 6);
+      else
+        e.addBits(fields[i].value, fields[i].bits);
+    }
+}
+
+static bool samePacket(TXPacket &a, TXPacket &b)
+{
+  return a.size() == b.size() && memcmp(a.data(), b.data(), (a.size() + 7) / 8) == 0;
+}
+
+static void testMatchesReference()
+{
+  TestRandom rnd(29);
+  uint32_t mismatches = 0;
+
+  for ( int iter = 0; iter < 100000; ++iter )
+    {
+      std::vector<Field> fields = randomFields(rnd);
+
+      TXPacket a, b;
+      ReferenceEncoder r;
+      for ( const Field &f : fields )
+        {
+          if ( f.text.size() )
+            r.addString(f.text.c_str(), f.bits / 6);
+          else
+            r.addBits(f.value, f.bits);
+        }
+      r.finish(a);
+
+      HDLCEncoder e(b);
+      encode(e, fields);
+      e.finish();
+
+      mismatches += !samePacket(a, b);
+
+      // The same frame again, carried on from a template holding the first field
+      TXPacket t, c;
+      HDLCEncoder prefix(t);
+      encode(prefix, std::vector<Field>(fields.begin(), fields.begin() + 1));
+      HDLCEncoder rest(c, prefix);
+      encode(rest, fields, 1);
+      rest.finish();
+
+      mismatches += !samePacket(a, c);
+    }
+
+  CHECK_EQ(mismatches, 0u);
+}
+
+// A 168 bit message of typical fields, the bulk of what gets transmitted
+static void benchEncoding()
+{
+  TestRandom rnd(31);
+  const int frames = 20000;
+  std::vector<std::vector<Field> > corpus;
+  for ( int i = 0; i < frames; ++i )
+    {
+      std::vector<Field> fields;
+      for ( uint8_t bits : { 6, 2, 30, 10, 1, 28, 27, 12, 9, 6, 8, 20, 9 } )
+        fields.push_back({ rnd.next(), bits, "" });
+      corpus.push_back(fields);
+    }
+
+  static TXPacket packets[2];
+  double reference = 1e9, single = 1e9;
+  for ( int run = 0; run < 5; ++run )
+    {
+      uint64_t start = nowNs();
+      for ( const std::vector<Field> &fields : corpus )
+        {
+          packets[0].reset();
+          ReferenceEncoder r;
+          for ( const Field &f : fields )
+            r.addBits(f.value, f.bits);
+          r.finish(packets[0]);
+        }
+      reference = std::min(reference, (double)(nowNs() - start) / frames);
+
+      start = nowNs();
+      for ( const std::vector<Field> &fields : corpus )
+        {
+          packets[1].reset();
+          HDLCEncoder e(packets[1]);
+          encode(e, fields);
+          e.finish();
+        }
+      single = std::min(single, (double)(nowNs() - start) / frames);
+    }
+
+  printf("  168 bit frame: %.0f ns in separate passes, %.0f ns in a single pass\n", reference, single);
+  CHECK(single < reference);
+}
+
+int main()
+{
+  testMatchesReference();
+  benchEncoding();
+  return testResult("test_hdlc_encoder");
+}
@@ -0,0 +1,300 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * NMEAEncoder against the encoder it replaced, which armored one 6-bit character at a time. Random packets of
+ * every length up to a full slot reservation, so every fill bit count and up to 2 sentences, must turn into the
+ * same !AIVDM sentences. The packet bits themselves are checked against the bits that went in, right up to
+ * and past the end of the packet.
+ */
+
+#include "TestUtils.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "NMEAEncoder.hpp"
+#include "AISChannels.h"
+
+/*
+ * The per-character encoder, as NMEAEncoder had it
+ */
+class ReferenceEncoder
+{
+public:
+  ReferenceEncoder() : mSequence(0) { }
+
+  void encode(RXPacket &packet, vector<string> &sentences)
+  {
+    static uint16_t MAX_SENTENCE_BYTES = 56;
+    static uint16_t MAX_SENTENCE_BITS = MAX_SENTENCE_BYTES * 6;
+
+    packet.discardCRC();
+
+    uint16_t numBits = packet.size();
+    uint16_t fillBits = 0;
+
+    if ( numBits % 6 )
+      {
+        fillBits = 6 - (numBits%6);
+        packet.addFillBits(fillBits);
+        numBits = packet.size();
+      }
+
+    uint16_t numSentences = 1;
+    while ( numBits > MAX_SENTENCE_BITS )
+      {
+        ++numSentences;
+        numBits -= MAX_SENTENCE_BITS;
+      }
+
+    numBits = packet.size();
+    if ( numSentences > 1 )
+      {
+        ++mSequence;
+
+        if ( mSequence > 9 )
+          mSequence = 0;
+      }
+
+    char sentence[85];
+    uint16_t pos = 0;
+
+    for ( uint16_t i = 1; i <= numSentences; ++i )
+      {
+        uint8_t k = 0;
+        if ( numSentences > 1 )
+          sprintf(sentence, "!AIVDM,%d,%d,%d,%c,", numSentences, i, mSequence, AIS_CHANNELS[packet.channel()].designation);
+        else
+          sprintf(sentence, "!AIVDM,%d,%d,,%c,", numSentences, i, AIS_CHANNELS[packet.channel()].designation);
+
+        k = strlen(sentence);
+        uint16_t sentenceBits = 0;
+
+        for ( ; pos < numBits && sentenceBits < MAX_SENTENCE_BITS; pos += 6, sentenceBits += 6 )
+          {
+            uint8_t nmeaByte = (uint8_t)packet.bits(pos, 6);
+            nmeaByte += (nmeaByte < 40) ? 48 : 56;
+            sentence[k++] = nmeaByte;
+          }
+
+        sentence[k++] = ',';
+        if ( numSentences > 1 )
+          {
+            if ( i == numSentences )
+              sentence[k++] = '0' + fillBits;
+            else
+              sentence[k++] = '0';
+          }
+        else
+          {
+            sentence[k++] = '0' + fillBits;
+          }
+
+        sentence[k++] = '*';
+        sprintf(sentence+k, "%.2X", nmeaCRC(sentence));
+        sentences.push_back(string(sentence));
+      }
+  }
+
+private:
+  uint8_t nmeaCRC(const char* buff)
+  {
+    uint8_t p = 1;
+    uint8_t crc = buff[p++];
+    while ( buff[p] != '*' )
+      crc ^= buff[p++];
+    return crc;
+  }
+
+  uint8_t mSequence;
+};
+
+static uint8_t reversed(uint8_t byte)
+{
+  uint8_t result = 0;
+  for ( uint8_t i = 0; i < 8; ++i )
+    result |= ((byte >> i) & 1) << (7 - i);
+  return result;
+}
+
+/*
+ * A received packet of whole bytes and an FCS, with some zero bits part way through to get message lengths
+ * that aren't a whole number of bytes. Returns the message bits in packet order.
+ */
+static std::vector<uint8_t> randomPacket(RXPacket &p, uint16_t bytes, uint8_t extraBits, TestRandom &rnd)
+{
+  std::vector<uint8_t> bits;
+  uint16_t extraAt = rnd.range(0, bytes);
+
+  p.reset();
+  p.setChannel(rnd.next() & 1 ? CH_88 : CH_87);
+  for ( uint16_t i = 0; i <= bytes + 2; ++i )
+    {
+      if ( i == extraAt )
+        {
+          p.addFillBits(extraBits);
+          bits.insert(bits.end(), extraBits, 0);
+        }
+
+      if ( i == bytes + 2 )
+        break;
+
+      // The last two are the FCS, which the encoders drop without checking
+      uint8_t byte = rnd.next();
+      p.addByte(reversed(byte));
+      if ( i < bytes )
+        for ( int8_t b = 7; b >= 0; --b )
+          bits.push_back((byte >> b) & 1);
+    }
+
+  return bits;
+}
+
+static uint32_t expectedBits(const std::vector<uint8_t> &bits, uint16_t pos, uint8_t count)
+{
+  uint32_t result = 0;
+  for ( uint16_t i = pos; i < pos + count; ++i )
+    result = (result << 1) | (i < bits.size() ? bits[i] : 0);
+  return result;
+}
+
+static void testMatchesReference()
+{
+  TestRandom rnd(61);
+  NMEAEncoder encoder;
+  ReferenceEncoder reference;
+  uint32_t mismatches = 0, badBits = 0;
+  uint32_t fills[6] = { 0 };
+  uint32_t multi = 0;
+
+  for ( int iter = 0; iter < 20000; ++iter )
+    {
+      RXPacket p, r;
+      uint16_t bytes = rnd.range(5, (MAX_AIS_RX_PACKET_SIZE - 16) / 8 - 1);
+      std::vector<uint8_t> bits = randomPacket(p, bytes, rnd.range(0, 7), rnd);
+      r = p;
+
+      std::vector<string> sentences, expected;
+      encoder.encode(p, sentences);
+      reference.encode(r, expected);
+
+      mismatches += sentences != expected;
+      ++fills[(6 - bits.size() % 6) % 6];
+      multi += expected.size() > 1;
+
+      // The fill bits are zeros, and so is everything past them
+      CHECK_EQ(p.size(), bits.size() + (6 - bits.size() % 6) % 6);
+      for ( uint16_t pos = 0; pos < p.size() + 8; ++pos )
+        badBits += p.bit(pos) != expectedBits(bits, pos, 1);
+
+      for ( uint16_t pos = p.size() > 40 ? p.size() - 40 : 0; pos < p.size() + 8; ++pos )
+        for ( uint8_t count = 1; count <= 32; ++count )
+          badBits += p.bits(pos, count) != expectedBits(bits, pos, count);
+    }
+
+  CHECK_EQ(mismatches, 0u);
+  CHECK_EQ(badBits, 0u);
+
+  for ( uint8_t f = 0; f < 6; ++f )
+    CHECK(fills[f] > 0);
+  CHECK(multi > 0);
+}
+
+// A known sentence, so both encoders can't be wrong the same way
+static void testKnownSentence()
+{
+  // Message 1 from MMSI 123456789 with all other fields 0
+  std::vector<uint8_t> bits;
+  auto put = [&bits](uint32_t value, uint8_t width) {
+    for ( int8_t i = width - 1; i >= 0; --i )
+      bits.push_back((value >> i) & 1);
+  };
+  put(1, 6);
+  put(0, 2);
+  put(123456789, 30);
+  for ( uint8_t i = 0; i < 5; ++i )
+    put(0, 26);
+
+  RXPacket p;
+  p.setChannel(CH_87);
+  for ( size_t i = 0; i < bits.size(); i += 8 )
+    {
+      uint8_t byte = 0;
+      for ( uint8_t b = 0; b < 8; ++b )
+        byte |= bits[i + b] << b;
+      p.addByte(byte);
+    }
+  p.addByte(0);
+  p.addByte(0);
+
+  NMEAEncoder encoder;
+  std::vector<string> sentences;
+  encoder.encode(p, sentences);
+
+  CHECK_EQ(sentences.size(), 1u);
+  CHECK(sentences.size() == 1 && sentences[0] == "!AIVDM,1,1,,A,11mg=5@000000000000000000000,0*54");
+}
+
+static void benchEncoding()
+{
+  const int packets = 5000;
+  TestRandom rnd(67);
+  std::vector<RXPacket> corpus(packets);
+  for ( RXPacket &p : corpus )
+    randomPacket(p, 21, 0, rnd);
+
+  NMEAEncoder encoder;
+  ReferenceEncoder reference;
+  std::vector<string> sentences;
+  sentences.reserve(4);
+  static RXPacket p;
+  double perChar = 1e9, bulk = 1e9;
+
+  for ( int run = 0; run < 5; ++run )
+    {
+      uint64_t start = nowNs();
+      for ( const RXPacket &packet : corpus )
+        {
+          p = packet;
+          sentences.clear();
+          reference.encode(p, sentences);
+        }
+      perChar = std::min(perChar, (double)(nowNs() - start) / packets);
+
+      start = nowNs();
+      for ( const RXPacket &packet : corpus )
+        {
+          p = packet;
+          sentences.clear();
+          encoder.encode(p, sentences);
+        }
+      bulk = std::min(bulk, (double)(nowNs() - start) / packets);
+    }
+
+  printf("  168 bit packet: %.0f ns per character, %.0f ns in 24 bit chunks\n", perChar, bulk);
+  CHECK(bulk < perChar);
+}
+
+int main()
+{
+  testKnownSentence();
+  testMatchesReference();
+  benchEncoding();
+  return testResult("test_nmea_encoder");
+}
@@ -0,0 +1,621 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * Bring-up of both RF ICs against a simulated pair of Si4463s on a simulated SPI bus. The RFIC and SPIBus code
+ * is the firmware's own; the chips model SDN, the POR signal on GPIO1, CTS and how long commands keep them busy.
+ * The concurrent bring-up follows the loop in RadioManager::init(), which pulls in too much of the radio stack
+ * to build here, and is compared with bringing up one chip after the other.
+ *
+ * Chip timings are assumptions, not measurements: a 5 ms POR, 15 ms for POWER_UP and 20 us for anything else.
+ *
+ * Built with FAST_RSSI and TX_FIFO_MODE, so the RSSI read and the TX FIFO commands are checked as well.
+ */
+
+#include "TestUtils.hpp"
+#include <vector>
+#include <string.h>
+#include "RFIC.hpp"
+#include "SPIBus.hpp"
+#include "EZRadioPRO.h"
+#include "Configuration.hpp"
+#include "TXPacket.hpp"
+#include "AISMessages.hpp"
+#include "AISChannels.h"
+#include "bsp/bsp.hpp"
+
+#define SIM_POR_NS                5000000ULL
+#define SIM_POWER_UP_NS           15000000ULL
+#define SIM_COMMAND_NS            20000ULL
+#define SIM_SPI_BYTE_NS           800ULL      // SPI1 at 10 MHz
+#define SIM_TRANSFER_NS           1000ULL     // Starting a DMA transfer and taking its interrupt
+#define SIM_LOOP_NS               1000ULL     // A pass through a polling loop that doesn't touch the bus
+
+static uint64_t gNow = 0;
+
+static GPIO_TypeDef gPorts[2];
+
+class SimChip
+{
+public:
+  SimChip(GPIO_TypeDef *port) : port(port) { }
+
+  void write(uint16_t pin, GPIO_PinState state)
+  {
+    if ( pin == SDN )
+      {
+        inReset = state == GPIO_PIN_SET;
+        if ( !inReset )
+          busyUntil = gNow + SIM_POR_NS;
+      }
+    else if ( pin == CS )
+      {
+        bool wasSelected = selected;
+        selected = state == GPIO_PIN_RESET;
+        if ( selected )
+          session.clear();
+        else if ( wasSelected )
+          endSession();
+      }
+  }
+
+  bool ready() const
+  {
+    return !inReset && !stuck && gNow >= busyUntil;
+  }
+
+  uint8_t transfer(uint8_t tx)
+  {
+    size_t pos = session.size();
+    session.push_back(tx);
+    if ( pos == 0 )
+      return 0;
+
+    // Fast response registers answer right away, busy or not
+    if ( session[0] == FRR_A_READ )
+      return pos == 1 ? frrA : 0;
+
+    if ( session[0] != READ_CMD_BUFFER )
+      return 0;
+
+    // CTS, then the response of the last command
+    if ( pos == 1 )
+      return ready() ? 0xFF : 0x00;
+    return pos - 2 < sizeof reply ? reply[pos - 2] : 0;
+  }
+
+  // Pins on this chip's port
+  static const uint16_t SDN  = 0x01;
+  static const uint16_t CS   = 0x02;
+  static const uint16_t DATA = 0x04;
+
+  GPIO_TypeDef *port;
+  bool inReset = true;
+  bool selected = false;
+  uint64_t busyUntil = 0;
+  bool stuck = false;                // Never reports CTS
+  uint32_t violations = 0;           // Commands that arrived before CTS
+  uint32_t ctsPolls = 0;
+  uint32_t frrReads = 0;
+  uint8_t frrA = 0;
+  std::vector<std::vector<uint8_t> > commands;
+
+private:
+  void endSession()
+  {
+    if ( session.empty() )
+      return;
+
+    if ( session[0] == READ_CMD_BUFFER )
+      {
+        ++ctsPolls;
+        return;
+      }
+
+    if ( session[0] == FRR_A_READ )
+      {
+        ++frrReads;
+        return;
+      }
+
+    // Writing the FIFO doesn't need CTS and doesn't keep the chip busy
+    commands.push_back(session);
+    if ( session[0] == WRITE_TX_FIFO )
+      return;
+
+    if ( !ready() )
+      ++violations;
+
+    memset(reply, 0, sizeof reply);
+    if ( session[0] == PART_INFO )
+      {
+        reply[1] = 0x44;
+        reply[2] = 0x63;
+      }
+
+    busyUntil = gNow + (session[0] == POWER_UP ? SIM_POWER_UP_NS : SIM_COMMAND_NS);
+  }
+
+  std::vector<uint8_t> session;
+  uint8_t reply[SPI_MAX_RESPONSE];
+};
+
+static SimChip gChips[2] = { SimChip(&gPorts[0]), SimChip(&gPorts[1]) };
+
+static SimChip &chipAt(GPIO_TypeDef *port)
+{
+  return gChips[port == &gPorts[1]];
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+  chipAt(port).write(pin, state);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin)
+{
+  gNow += SIM_LOOP_NS;
+
+  // GPIO1 is CTS after a power on reset
+  SimChip &chip = chipAt(port);
+  return pin == SimChip::DATA && chip.ready() ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/*
+ * The SPI engine runs at the highest priority, so on the host every transaction runs to completion inside
+ * bsp_trigger_spi(), one DMA transfer at a time.
+ */
+static irq_callback gTransferCallback = nullptr;
+static irq_callback gTriggerCallback = nullptr;
+static SimChip *gSelected = nullptr;
+static bool gTransferPending = false;
+
+bool bsp_start_spi_transfer(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+  gSelected = nullptr;
+  for ( SimChip &c : gChips )
+    if ( c.selected )
+      gSelected = &c;
+
+  for ( uint16_t i = 0; i < len; ++i )
+    {
+      uint8_t b = gSelected ? gSelected->transfer(tx[i]) : 0xff;
+      if ( rx )
+        rx[i] = b;
+    }
+
+  gNow += SIM_TRANSFER_NS + len * SIM_SPI_BYTE_NS;
+  gTransferPending = true;
+  return true;
+}
+
+void bsp_set_spi_transfer_callback(irq_callback cb)
+{
+  gTransferCallback = cb;
+}
+
+void bsp_set_spi_trigger_callback(irq_callback cb)
+{
+  gTriggerCallback = cb;
+}
+
+void bsp_trigger_spi()
+{
+  gTriggerCallback();
+  while ( gTransferPending )
+    {
+      gTransferPending = false;
+      gTransferCallback();
+    }
+}
+
+// Only RFIC::configure() reads the XO trim, and the tests run it untrimmed
+Configuration &Configuration::instance()
+{
+  alignas(Configuration) static char __storage[sizeof(Configuration)];
+  return *reinterpret_cast<Configuration*>(__storage);
+}
+
+bool Configuration::isXOTrimmed()
+{
+  return false;
+}
+
+uint8_t Configuration::getXOTrimValue()
+{
+  return 0;
+}
+
+class SimRFIC : public RFIC
+{
+public:
+  SimRFIC(uint8_t id)
+    : RFIC(&gPorts[id], SimChip::SDN, &gPorts[id], SimChip::CS, &gPorts[id], SimChip::DATA, &gPorts[id], 0, id)
+  {
+  }
+
+  using RFIC::configure;
+  using RFIC::readRSSI;
+  using RFIC::sendCmd;
+  using RFIC::sendCmdNoWait;
+#if TX_FIFO_MODE
+  using RFIC::loadTXFIFO;
+  using RFIC::startFIFOTX;
+#endif
+
+protected:
+  void configureGPIOsForRX() { }
+};
+
+static void reset()
+{
+  gNow = 0;
+  for ( SimChip &c : gChips )
+    {
+      c.inReset = true;
+      c.stuck = false;
+      c.busyUntil = 0;
+      c.violations = 0;
+      c.ctsPolls = 0;
+      c.frrReads = 0;
+      c.commands.clear();
+    }
+}
+
+static void delayMs(uint32_t ms)
+{
+  gNow += ms * 1000000ULL;
+}
+
+// One chip after the other, each with the same polling as the concurrent bring-up. Returns the time taken.
+static uint64_t bringUpSequentially(SimRFIC *ics[2])
+{
+  reset();
+  for ( uint8_t i = 0; i < 2; ++i )
+    {
+      ics[i]->holdInReset();
+      delayMs(1);
+      ics[i]->releaseReset();
+      while ( !ics[i]->checkPOR() )
+        ;
+
+      ics[i]->startConfiguration();
+      while ( !ics[i]->continueConfiguration() )
+        ;
+    }
+
+  return gNow;
+}
+
+// As in RadioManager::init()
+static uint64_t bringUpConcurrently(SimRFIC *ics[2], uint64_t &patched)
+{
+  reset();
+  for ( uint8_t i = 0; i < 2; ++i )
+    ics[i]->holdInReset();
+  delayMs(1);
+  for ( uint8_t i = 0; i < 2; ++i )
+    ics[i]->releaseReset();
+
+  while ( !(ics[0]->checkPOR() & ics[1]->checkPOR()) )
+    ;
+
+  bool done[2] = { false, false };
+  for ( uint8_t i = 0; i < 2; ++i )
+    ics[i]->startConfiguration();
+
+  patched = 0;
+  while ( !(done[0] && done[1]) )
+    {
+      for ( uint8_t i = 0; i < 2; ++i )
+        {
+          if ( !done[i] )
+            done[i] = ics[i]->continueConfiguration();
+        }
+
+      if ( !patched && (done[0] || ics[0]->poweredUp()) && (done[1] || ics[1]->poweredUp()) )
+        patched = gNow;
+    }
+
+  return gNow;
+}
+
+static void testBringUp()
+{
+  SimRFIC trx(0), rx(1);
+  SimRFIC *ics[2] = { &trx, &rx };
+
+  uint64_t sequential = bringUpSequentially(ics);
+  std::vector<std::vector<uint8_t> > expected[2] = { gChips[0].commands, gChips[1].commands };
+  CHECK_EQ(gChips[0].violations + gChips[1].violations, 0u);
+  CHECK_EQ(trx.partNumber(), 0x4463);
+
+  uint64_t patched;
+  uint64_t concurrent = bringUpConcurrently(ics, patched);
+
+  // Every command went to the right chip, in the same order, and never before the chip was ready for it
+  for ( uint8_t i = 0; i < 2; ++i )
+    {
+      CHECK(gChips[i].commands == expected[i]);
+      CHECK_EQ(gChips[i].violations, 0u);
+      CHECK(ics[i]->poweredUp());
+    }
+
+  printf("  %zu commands per chip: one after the other %.2f ms, concurrently %.2f ms (both powered up at %.2f ms)\n",
+      expected[0].size(), sequential / 1e6, concurrent / 1e6, patched / 1e6);
+
+  // POR and POWER_UP overlap, so the concurrent bring-up takes little more than one chip on its own
+  CHECK(concurrent < sequential * 6 / 10);
+}
+
+// Out of reset and through the configuration array, one chip on its own
+static void powerUp(SimRFIC &ic)
+{
+  reset();
+  ic.holdInReset();
+  delayMs(1);
+  ic.releaseReset();
+  while ( !ic.checkPOR() )
+    ;
+
+  ic.configure();
+}
+
+static size_t countCommands(const SimChip &chip, uint8_t cmd)
+{
+  size_t n = 0;
+  for ( const std::vector<uint8_t> &c : chip.commands )
+    n += c[0] == cmd;
+  return n;
+}
+
+/*
+ * After the concurrent bring-up, init() configures each chip without sending the array again. Any configure()
+ * after that sends the whole array, whether or not the chip has been reset in between.
+ */
+static void testReconfigure()
+{
+  SimRFIC trx(0), rx(1);
+  SimRFIC *ics[2] = { &trx, &rx };
+  uint64_t patched;
+  bringUpConcurrently(ics, patched);
+  SimChip &chip = gChips[0];
+  size_t arraySize = chip.commands.size();
+  CHECK_EQ(countCommands(chip, POWER_UP), 1u);
+
+  trx.configure();
+  CHECK_EQ(countCommands(chip, POWER_UP), 1u);
+  size_t extra = chip.commands.size() - arraySize;
+
+  chip.commands.clear();
+  trx.configure();
+  CHECK_EQ(chip.commands.size(), arraySize + extra);
+  CHECK_EQ(countCommands(chip, POWER_UP), 1u);
+
+  powerUp(trx);
+  CHECK_EQ(chip.commands.size(), arraySize + extra);
+  CHECK_EQ(countCommands(chip, POWER_UP), 1u);
+  CHECK_EQ(chip.violations, 0u);
+
+  // Calling it again once it's done sends nothing more
+  size_t n = chip.commands.size();
+  CHECK(trx.continueConfiguration());
+  CHECK_EQ(chip.commands.size(), n);
+}
+
+// A chip that stops reporting CTS fails the transaction after SPI_MAX_CTS_POLLS instead of holding the bus
+static void testCTSTimeout()
+{
+  SimRFIC trx(0), rx(1);
+  powerUp(trx);
+  SimChip &chip = gChips[0];
+  DEVICE_STATE state;
+
+  // Waiting for the response
+  chip.stuck = true;
+  chip.ctsPolls = 0;
+  uint64_t start = gNow;
+  CHECK(!trx.sendCmd(REQ_DEVICE_STATE, NULL, 0, &state, sizeof state));
+  CHECK_EQ(chip.ctsPolls, (uint32_t)SPI_MAX_CTS_POLLS);
+  printf("  No CTS: gave up after %u polls, %.2f ms\n", chip.ctsPolls, (gNow - start) / 1e6);
+  CHECK(gNow - start > 1000000 && gNow - start < 10000000);
+
+  // Waiting for a posted command to complete. The next command is never sent.
+  chip.stuck = false;
+  delayMs(1);
+  CHECK(trx.sendCmdNoWait(START_RX, NULL, 7));
+  size_t n = chip.commands.size();
+  chip.stuck = true;
+  chip.ctsPolls = 0;
+  CHECK(!trx.sendCmd(REQ_DEVICE_STATE, NULL, 0, &state, sizeof state));
+  CHECK_EQ(chip.ctsPolls, (uint32_t)SPI_MAX_CTS_POLLS);
+  CHECK_EQ(chip.commands.size(), n);
+
+  // The bus still works, for this chip once it recovers and for the other one
+  chip.stuck = false;
+  delayMs(1);
+  chip.violations = 0;
+  CHECK(trx.sendCmd(REQ_DEVICE_STATE, NULL, 0, &state, sizeof state));
+  CHECK_EQ(chip.commands.size(), n + 1);
+  gChips[1].inReset = false;
+  gChips[1].busyUntil = 0;
+  CHECK(rx.sendCmd(REQ_DEVICE_STATE, NULL, 0, &state, sizeof state));
+  CHECK_EQ(chip.violations + gChips[1].violations, 0u);
+}
+
+#if FAST_RSSI
+static void testFastRSSI()
+{
+  SimRFIC trx(0);
+  powerUp(trx);
+
+  // configure() sets up FRR_A after the configuration array
+  SimChip &chip = gChips[0];
+  size_t n = chip.commands.size();
+  CHECK(n > 2);
+  std::vector<uint8_t> rssiControl = { SET_PROPERTY, 0x20, 0x01, 0x4C, 0x08 };
+  std::vector<uint8_t> frrControl = { SET_PROPERTY, 0x02, 0x01, 0x00, 0x0A };
+  CHECK(n > 2 && chip.commands[n - 2] == rssiControl);
+  CHECK(n > 2 && chip.commands[n - 1] == frrControl);
+  CHECK_EQ(chip.violations, 0u);
+
+  // Even while the chip is busy with a command, the RSSI is one FRR_A_READ with no CTS poll
+  chip.busyUntil = gNow + SIM_POWER_UP_NS;
+  chip.ctsPolls = 0;
+  chip.frrReads = 0;
+  chip.frrA = 0x5A;
+  uint64_t start = gNow;
+  CHECK_EQ(trx.readRSSI(), 0x5A);
+  CHECK_EQ(chip.frrReads, 1u);
+  CHECK_EQ(chip.ctsPolls, 0u);
+  CHECK_EQ(chip.commands.size(), n);
+  CHECK_EQ(chip.violations, 0u);
+  printf("  readRSSI(): %.1f us on the bus\n", (gNow - start) / 1e3);
+}
+#endif
+
+#if TX_FIFO_MODE
+/*
+ * Loads the packet into the TX FIFO and starts it, as Transceiver does. Checks that the FIFO got exactly
+ * TXPacket::data() in WRITE_TX_FIFO commands of up to 15 bytes, and returns the PKT_TX_THRESHOLD that was
+ * set (-1 for none) and the START_TX command.
+ */
+static int loadAndStart(SimRFIC &trx, TXPacket &p, std::vector<uint8_t> &startTX)
+{
+  SimChip &chip = gChips[0];
+  chip.commands.clear();
+  trx.loadTXFIFO(&p);
+  trx.startFIFOTX(&p);
+  CHECK_EQ(chip.violations, 0u);
+
+  std::vector<std::vector<uint8_t> > &c = chip.commands;
+  std::vector<uint8_t> fifoReset = { FIFO_INFO, 0x01 };
+  CHECK(c.size() >= 3 && c[0] == fifoReset);
+
+  std::vector<uint8_t> fifo;
+  size_t i = 1;
+  for ( ; i < c.size() && c[i][0] == WRITE_TX_FIFO; ++i )
+    {
+      // Only the last one can be short
+      CHECK(c[i].size() <= SPI_MAX_COMMAND);
+      CHECK(c[i].size() == SPI_MAX_COMMAND || i + 1 == c.size() || c[i + 1][0] != WRITE_TX_FIFO);
+      fifo.insert(fifo.end(), c[i].begin() + 1, c[i].end());
+    }
+
+  CHECK_EQ(fifo.size(), p.dataSize());
+  CHECK(fifo.size() == p.dataSize() && memcmp(fifo.data(), p.data(), fifo.size()) == 0);
+
+  int threshold = -1;
+  if ( i < c.size() && c[i][0] == SET_PROPERTY )
+    {
+      std::vector<uint8_t> header(c[i].begin(), c[i].begin() + 4);
+      std::vector<uint8_t> txThreshold = { SET_PROPERTY, 0x12, 0x01, 0x0B };
+      CHECK(c[i].size() == 5 && header == txThreshold);
+      threshold = c[i][4];
+      ++i;
+    }
+
+  CHECK(i + 1 == c.size() && c[i][0] == START_TX && c[i].size() == 1 + sizeof(TX_OPTIONS));
+  startTX = i < c.size() ? c[i] : std::vector<uint8_t>();
+  return threshold;
+}
+
+static void testTXFIFO()
+{
+  SimRFIC trx(0);
+  powerUp(trx);
+
+  StationData station;
+  StationData ones;
+  ones.mmsi = 0x3FFFFFFF;     // Long runs of ones, so the frame gets stuffed
+  strcpy(ones.name, "???????????????");
+
+  AISMessage18 m18;
+  m18.latitude = 37.9;
+  m18.longitude = 23.7;
+  m18.sog = 5.5;
+  m18.cog = 270;
+  m18.utc = 59;
+  AISMessage24A m24a;
+  AISMessage24B m24b;
+  AISMessage *messages[] = { &m18, &m24a, &m24b };
+
+  for ( const StationData *s : { &station, &ones } )
+    for ( AISMessage *m : messages )
+      {
+        TXPacket p;
+        p.configure(CH_88);
+        m->encode(*s, p);
+
+        std::vector<uint8_t> startTX;
+        int threshold = loadAndStart(trx, p, startTX);
+
+        /*
+         * The FIFO starts with 64 - size free bytes and each byte leaves it as it starts going out. The almost
+         * empty threshold must be reached by the byte with the ramp down bit, not before it and not after.
+         */
+        uint8_t size = p.dataSize();
+        uint16_t rampDownByte = p.rampDownBit() / 8;
+        CHECK(threshold > 64 - size && threshold <= 64);
+        int reachedBy = -1;
+        for ( uint16_t b = 0, free = 64 - size; b < size && reachedBy < 0; ++b )
+          if ( ++free >= threshold )
+            reachedBy = b;
+        CHECK_EQ(reachedBy, rampDownByte);
+
+        // One frame, no repeats, on the packet's channel and back to RX afterwards
+        std::vector<uint8_t> expected = { START_TX, AIS_CHANNELS[CH_88].ordinal, 0x80, 0x00, size, 0x00, 0x00 };
+        CHECK(startTX == expected);
+
+        printf("  %-3s %3u bits, %2u bytes: ramp down in byte %2u, PKT_TX_THRESHOLD %u\n", p.messageType(),
+            p.size(), size, rampDownByte, threshold);
+      }
+
+  // Test packets set no threshold and repeat the FIFO contents for as many bits as they ask for
+  for ( uint16_t bits : { 100, 264, 265, 9600 } )
+    {
+      TXPacket p;
+      p.configureForTesting(CH_87, bits);
+
+      std::vector<uint8_t> startTX;
+      CHECK_EQ(loadAndStart(trx, p, startTX), -1);
+
+      uint8_t size = p.dataSize();
+      CHECK(startTX.size() == 7 && startTX[3] == 0 && startTX[4] == size);
+      uint8_t repeats = startTX.size() == 7 ? startTX[6] : 0;
+      CHECK((repeats + 1) * size * 8 >= bits);
+      CHECK(repeats * size * 8 < bits);
+      printf("  test packet %4u bits: %2u bytes, %2u repeats\n", bits, size, repeats);
+    }
+}
+#endif
+
+int main()
+{
+  testBringUp();
+  testReconfigure();
+  testCTSTimeout();
+#if FAST_RSSI
+  testFastRSSI();
+#endif
+#if TX_FIFO_MODE
+  testTXFIFO();
+#endif
+  return testResult("test_rfic_bringup");
+}
@@ -0,0 +1,278 @@
+/*
+  Copyright (c) 2016-2020 Peter Antypas
+
+  This file is part of the MAIANA™ transponder firmware.
+
+  The firmware is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>
+*/
+
+/*
+ * RXPacket against the packet it replaced, which stored one bit at a time and ran the CRC bit by bit.
+ * Random byte streams, with and without a valid FCS, with fill bits in the middle that leave addByte()
+ * unaligned and with the CRC discarded, must read back the same bits and fields from both.
+ * Also times addByte(), which runs once per received byte in the decoder.
+ */
+
+#include "TestUtils.hpp"
+#include <vector>
+#include <algorithm>
+#include "RXPacket.hpp"
+
+/*
+ * The per-bit packet, as RXPacket had it. discardCRC() tracks the discarded CRC with a flag, like RXPacket
+ * now does, instead of the 0xffff sentinel that could be mistaken for a live CRC register.
+ */
+class ReferencePacket
+{
+public:
+  ReferencePacket() : mSize(0), mCRC(0xffff), mCRCDiscarded(false), mType(0), mMMSI(0)
+  {
+    memset(mPacket, 0, sizeof mPacket);
+  }
+
+  void addBit(uint8_t bit)
+  {
+    uint16_t index = mSize / 8;
+    uint8_t offset = mSize % 8;
+
+    if ( bit )
+      mPacket[index] |= ( 1 << offset );
+    else
+      mPacket[index] &= ~( 1 << offset );
+
+    ++mSize;
+  }
+
+  uint8_t bit(uint16_t pos) const
+  {
+    if ( pos < mSize )
+      return (mPacket[pos / 8] & (1 << (pos % 8))) != 0;
+    else
+      return 0;
+  }
+
+  uint32_t bits(uint16_t pos, uint8_t count) const
+  {
+    uint32_t result = 0;
+    for ( uint16_t i = pos; i < pos + count; ++i )
+      {
+        result <<= 1;
+        result |= bit(i);
+      }
+
+    return result;
+  }
+
+  void addBitCRC(uint8_t data)
+  {
+    if ( (data ^ mCRC) & 0x0001 )
+      mCRC = (mCRC >> 1) ^ 0x8408;
+    else
+      mCRC >>= 1;
+  }
+
+  void addByte(uint8_t byte)
+  {
+    for ( uint8_t i = 0; i < 8; ++i )
+      addBit(byte & (1 << i));
+
+    for ( int8_t i = 7; i >= 0; --i )
+      addBitCRC((byte >> i) & 0x01);
+  }
+
+  void discardCRC()
+  {
+    if ( mCRCDiscarded || mSize < 16 )
+      return;
+
+    mSize -= 16;
+    mCRC = 0xffff;
+    mCRCDiscarded = true;
+    for ( uint8_t i = 0; i < 16; ++i )
+      addBit(0);
+    mSize -= 16;
+  }
+
+  void addFillBits(uint8_t numBits)
+  {
+    for ( uint8_t i = 0; i < numBits; ++i )
+      addBit(0);
+  }
+
+  bool checkCRC() const
+  {
+    return mCRC == 0xf0b8;
+  }
+
+  // Both are cached on first use, and 0 means not read yet
+  uint8_t messageType()
+  {
+    if ( !mType )
+      mType = bits(0, 6);
+    return mType;
+  }
+
+  uint32_t mmsi()
+  {
+    if ( !mMMSI )
+      mMMSI = bits(8, 30);
+    return mMMSI;
+  }
+
+  uint8_t mPacket[MAX_AIS_RX_PACKET_SIZE / 8 + 4];
+  uint16_t mSize;
+  uint16_t mCRC;
+  bool mCRCDiscarded;
+  uint8_t mType;
+  uint32_t mMMSI;
+};
+
+static uint8_t reversed(uint8_t byte)
+{
+  uint8_t result = 0;
+  for ( uint8_t i = 0; i < 8; ++i )
+    result |= ((byte >> i) & 1) << (7 - i);
+  return result;
+}
+
+static uint32_t compare(const RXPacket &p, ReferencePacket &r, TestRandom &rnd)
+{
+  uint32_t mismatches = 0;
+  mismatches += p.size() != r.mSize;
+  mismatches += p.crc() != r.mCRC;
+  mismatches += p.checkCRC() != r.checkCRC();
+  mismatches += p.messageType() != r.messageType();
+  mismatches += p.mmsi() != r.mmsi();
+
+  // Past the end reads as 0
+  for ( uint16_t i = 0; i < r.mSize + 16; ++i )
+    mismatches += p.bit(i) != r.bit(i);
+
+  for ( uint8_t i = 0; i < 64; ++i )
+    {
+      uint16_t pos = rnd.range(0, r.mSize + 16);
+      uint8_t count = rnd.range(1, 32);
+      mismatches += p.bits(pos, count) != r.bits(pos, count);
+    }
+
+  return mismatches;
+}
+
+static void testMatchesReference()
+{
+  TestRandom rnd(53);
+  uint32_t mismatches = 0, valid = 0;
+
+  for ( int iter = 0; iter < 50000; ++iter )
+    {
+      RXPacket p;
+      ReferencePacket r;
+
+      uint16_t bytes = rnd.range(1, MAX_AIS_RX_PACKET_SIZE / 8 - 4);
+      uint16_t fillAt = rnd.range(0, 3) == 0 ? rnd.range(0, bytes) : 0xffff;
+      uint8_t fill = rnd.range(1, 7);
+      for ( uint16_t i = 0; i < bytes; ++i )
+        {
+          if ( i == fillAt )
+            {
+              p.addFillBits(fill);
+              r.addFillBits(fill);
+            }
+
+          uint8_t byte = rnd.next();
+          p.addByte(byte);
+          r.addByte(byte);
+        }
+
+      // Half of the packets end in the right FCS, received like any other bytes
+      if ( rnd.next() & 1 )
+        {
+          uint16_t fcs = ~r.mCRC;
+          for ( uint8_t b : { (uint8_t)reversed(fcs & 0xff), (uint8_t)reversed(fcs >> 8) } )
+            {
+              p.addByte(b);
+              r.addByte(b);
+            }
+        }
+
+      valid += r.checkCRC();
+      mismatches += compare(p, r, rnd);
+
+      // As NMEAEncoder does it
+      if ( rnd.next() & 1 )
+        {
+          uint8_t pad = rnd.range(0, 5);
+          p.discardCRC();
+          r.discardCRC();
+          p.addFillBits(pad);
+          r.addFillBits(pad);
+          mismatches += compare(p, r, rnd);
+        }
+    }
+
+  CHECK_EQ(mismatches, 0u);
+
+  // Every other stream with an FCS, unless the fill bits broke it
+  CHECK(valid > 20000);
+}
+
+static volatile uint32_t gSink;
+
+// A 184 bit packet, message and FCS
+static void benchAddByte()
+{
+  const int packets = 20000;
+  const int bytes = 23;
+  TestRandom rnd(59);
+  std::vector<uint8_t> corpus(packets * bytes);
+  for ( uint8_t &b : corpus )
+    b = rnd.next();
+
+  static RXPacket p;
+  static ReferencePacket r;
+  double reference = 1e9, table = 1e9;
+  for ( int run = 0; run < 5; ++run )
+    {
+      uint64_t start = nowNs();
+      for ( int i = 0; i < packets; ++i )
+        {
+          r.mSize = 0;
+          r.mCRC = 0xffff;
+          for ( int j = 0; j < bytes; ++j )
+            r.addByte(corpus[i * bytes + j]);
+          gSink = r.mCRC;
+        }
+      reference = std::min(reference, (double)(nowNs() - start) / (packets * bytes));
+
+      start = nowNs();
+      for ( int i = 0; i < packets; ++i )
+        {
+          p.reset();
+          for ( int j = 0; j < bytes; ++j )
+            p.addByte(corpus[i * bytes + j]);
+          gSink = p.crc();
+        }
+      table = std::min(table, (double)(nowNs() - start) / (packets * bytes));
+    }
+
+  printf("  addByte: %.2f ns per byte bit by bit, %.2f ns per byte whole\n", reference, table);
+  CHECK(table < reference);
+}
+
+int main()
+{
+  testMatchesReference();
+  benchAddByte();
+  return testResult("test_rxpacket");
+}